@@ -0,0 +1,215 @@
+// Benchmark pętli sterującej na hoście (Linux).
+// Te same obiekty i ta sama kolejność etapów co loop() w src/main.cpp (bez
+// serwera WWW), z zamiennikami sprzętu z host/shim/: strefy na sterowniku
+// "mock", LittleFS w RAM, OWM z zapisanych odpowiedzi, broker MQTT w pamięci.
+// W trakcie pomiaru do kolejki MQTT trafiają komendy (start/stop stref,
+// odświeżenie snapshotów), a programy startują co minutę – pętla robi to
+// samo, co na urządzeniu, tylko bez opóźnień sieci i flasha.
+//
+// Użycie: loop_bench [sekundy=10] [komend_mqtt_na_s=20]
+// Wynik: percentyle czasu iteracji i etapów z LoopStats (jak /api/loop-stats).
+#include <Arduino.h>
+#include "FS.h"
+#include "LittleFS.h"
+#include <Preferences.h>
+#include <HTTPClient.h>
+#include <PubSubClient.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "Config.h"
+#include "Zones.h"
+#include "Programs.h"
+#include "Weather.h"
+#include "Logs.h"
+#include "HttpsPool.h"
+#include "PushoverClient.h"
+#include "MQTTClient.h"
+#include "LoopStats.h"
+
+// --- Obiekty globalne (jak w main.cpp) ---
+Config config;
+Zones zones;
+HttpsPool httpsPool;
+Weather weather(&httpsPool);
+Logs logs;
+PushoverClient pushover(config.getSettingsPtr(), &httpsPool);
+Programs programs;
+MQTTClient mqtt;
+LoopStats loopStats;
+volatile uint32_t heapAllocCount = 0;
+
+static const int ZONES = 8;
+
+// Odpowiedzi OWM w kształcie prawdziwych (pola, które filtruje Weather)
+static host::HttpReply owmReply(const String& method, const String& url, const String&) {
+  host::HttpReply r;
+  r.code = HTTP_CODE_OK;
+  if (url.indexOf("/geo/") >= 0) {
+    r.body = "[{\"name\":\"Szczecin\",\"lat\":53.4289,\"lon\":14.553,\"country\":\"PL\"}]";
+  } else if (url.indexOf("/data/2.5/weather") >= 0) {
+    r.body = "{\"weather\":[{\"id\":500,\"main\":\"Rain\",\"description\":\"lekki deszcz\",\"icon\":\"10d\"}],"
+             "\"main\":{\"temp\":14.2,\"feels_like\":13.6,\"temp_min\":12.9,\"temp_max\":15.1,\"pressure\":1012,\"humidity\":81},"
+             "\"visibility\":10000,\"wind\":{\"speed\":4.1,\"deg\":240},\"rain\":{\"1h\":0.31},\"clouds\":{\"all\":75},"
+             "\"dt\":" + std::to_string((long)time(nullptr)) + ",\"sys\":{\"sunrise\":1718332800,\"sunset\":1718393400}}";
+  } else if (url.indexOf("/data/2.5/forecast") >= 0) {
+    std::string b = "{\"cod\":\"200\",\"cnt\":40,\"list\":[";
+    const long t0 = (long)time(nullptr);
+    for (int i = 0; i < 40; i++) {
+      if (i) b += ',';
+      b += "{\"dt\":" + std::to_string(t0 + i * 10800L) +
+           ",\"main\":{\"temp\":13.0,\"temp_min\":" + std::to_string(9 + i % 5) +
+           ",\"temp_max\":" + std::to_string(16 + i % 7) + ",\"humidity\":" + std::to_string(60 + i % 30) +
+           "},\"weather\":[{\"id\":500,\"description\":\"deszcz\",\"icon\":\"10d\"}],\"rain\":{\"3h\":" +
+           std::to_string((i % 4) * 0.4) + "}}";
+    }
+    b += "]}";
+    r.body = b;
+  } else if (method == "POST") {
+    r.body = "{\"status\":1}"; // Pushover
+  } else {
+    r.code = 404;
+  }
+  return r;
+}
+
+// Programy co minutę przez najbliższą godzinę, strefy po kolei
+static void seedPrograms() {
+  JsonDocument doc;
+  JsonArray arr = doc.to<JsonArray>();
+  time_t now = time(nullptr);
+  for (int i = 1; i <= 60; i++) {
+    time_t at = now + i * 60;
+    struct tm t;
+    localtime_r(&at, &t);
+    char hhmm[6];
+    snprintf(hhmm, sizeof(hhmm), "%02d:%02d", t.tm_hour, t.tm_min);
+    JsonObject p = arr.add<JsonObject>();
+    p["zone"] = i % ZONES;
+    p["time"] = hhmm;
+    p["duration"] = 1;
+    p["active"] = true;
+  }
+  programs.importFromJson(doc);
+}
+
+static void seedSettings() {
+  Preferences p;
+  p.begin("ews", false);
+  p.putString("ssid", "bench");
+  p.putString("pass", "bench");
+  p.putString("owmApiKey", "bench");
+  p.putString("mqttServer", "localhost");
+  p.putString("mqttClientId", "loop-bench");
+  p.putString("mqttTopicBase", "bench");
+  p.putString("relayDriver", "mock");
+  p.putInt("zoneCount", ZONES);
+  p.putInt("maxZonesOn", 2);
+  p.putBool("enablePushover", false);
+  p.end();
+}
+
+// Komendy jak z backendu – trafiają do zadania "mqtt", wykonuje je mqtt.loop()
+static void injectCommand(uint32_t n) {
+  host::MqttBroker& b = host::mqttBroker();
+  const int zone = n % ZONES;
+  char topic[64];
+  switch (n % 4) {
+    case 0:
+      snprintf(topic, sizeof(topic), "bench/cmd/zones/%d/start", zone);
+      b.inject(topic, "2");
+      break;
+    case 1:
+      snprintf(topic, sizeof(topic), "bench/cmd/zones/%d/toggle", zone);
+      b.inject(topic, "");
+      break;
+    case 2:
+      snprintf(topic, sizeof(topic), "bench/cmd/zones/%d/stop", (zone + 3) % ZONES);
+      b.inject(topic, "");
+      break;
+    default:
+      b.inject("bench/global/refresh", "");
+      break;
+  }
+}
+
+static void printHist(const char* name, JsonObject h) {
+  printf("%-9s %9lu %8lu %8lu %8lu %8lu %9lu %9lu\n", name,
+         (unsigned long)(h["count"] | 0UL), (unsigned long)(h["avg_us"] | 0UL),
+         (unsigned long)(h["p50_us"] | 0UL), (unsigned long)(h["p90_us"] | 0UL),
+         (unsigned long)(h["p99_us"] | 0UL), (unsigned long)(h["p999_us"] | 0UL),
+         (unsigned long)(h["max_us"] | 0UL));
+}
+
+int main(int argc, char** argv) {
+  const unsigned long seconds = argc > 1 ? strtoul(argv[1], nullptr, 10) : 10;
+  const unsigned long cmdRate = argc > 2 ? strtoul(argv[2], nullptr, 10) : 20;
+
+  setenv("TZ", "CET-1CEST,M3.5.0,M10.5.0/3", 1);
+  tzset();
+  host::httpHandler = owmReply;
+  seedSettings();
+
+  // --- setup() jak w main.cpp ---
+  LittleFS.begin();
+  config.load();
+  config.initWiFi(&pushover);
+  zones.begin(createRelayDriver(config.getRelayDriver(), config.getRelayPins()), config.getZoneCount());
+  zones.setBudget(config.getMaxConcurrentZones(), config.getSupplyCapacity());
+  logs.begin();
+  weather.begin(config.getOwmApiKey(), config.getOwmLocation(), config.getEnableWeatherApi(),
+                config.getWeatherUpdateIntervalMin());
+  pushover.begin();
+  programs.begin(&zones, &weather, &logs, &pushover, &config);
+  seedPrograms();
+  mqtt.begin(&zones, &programs, &weather, &logs, &config);
+
+  printf("loop_bench: %lu s, %lu komend MQTT/s, %d stref\n", seconds, cmdRate, ZONES);
+
+  // Rozgrzewka: pierwsze pobranie OWM i publikacje snapshotów
+  const unsigned long warmupEnd = millis() + 1000;
+  while (millis() < warmupEnd) {
+    config.wifiLoop(); zones.loop(); programs.loop(); weather.loop(); mqtt.loop();
+    delay(1);
+  }
+  loopStats.reset();
+
+  const unsigned long t0 = millis();
+  const unsigned long cmdEveryUs = cmdRate ? 1000000UL / cmdRate : 0;
+  unsigned long nextCmdUs = micros();
+  uint32_t cmds = 0, iterations = 0;
+
+  while (millis() - t0 < seconds * 1000UL) {
+    if (cmdEveryUs && (long)(micros() - nextCmdUs) >= 0) {
+      injectCommand(cmds++);
+      nextCmdUs += cmdEveryUs;
+    }
+    // --- loop() jak w main.cpp ---
+    loopStats.beginIteration();
+    config.wifiLoop();  loopStats.mark(LoopStats::WIFI);
+    zones.loop();       loopStats.mark(LoopStats::ZONES);
+    programs.loop();    loopStats.mark(LoopStats::PROGRAMS);
+    weather.loop();     loopStats.mark(LoopStats::WEATHER);
+    mqtt.loop();        loopStats.mark(LoopStats::MQTT);
+    loopStats.endIteration();
+    iterations++;
+    yield(); // loopTask na ESP32 też oddaje rdzeń między iteracjami
+  }
+
+  JsonDocument doc;
+  loopStats.toJson(doc);
+  printf("\n%-9s %9s %8s %8s %8s %8s %9s %9s\n", "etap", "n", "avg_us", "p50_us", "p90_us", "p99_us", "p99.9_us", "max_us");
+  printHist("loop", doc["loop"]);
+  static const char* const stages[] = { "wifi", "zones", "programs", "weather", "mqtt" };
+  for (const char* s : stages) printHist(s, doc["stages"][s]);
+
+  JsonDocument ms;
+  mqtt.statsToJson(ms);
+  printf("\niteracje: %lu, komendy: %lu, publikacje MQTT: %lu (%lu B), wpisy dziennika: %lu\n",
+         (unsigned long)iterations, (unsigned long)cmds,
+         (unsigned long)(ms["publishes"] | 0UL), (unsigned long)(ms["bytes"] | 0UL),
+         (unsigned long)logs.getNextSeq());
+  fflush(stdout);
+  // Zadania (weather, mqtt, pushover, esp_timer) nie mają końca – jak na urządzeniu
+  _exit(0);
+}
@@ -0,0 +1,187 @@
+// Benchmark odbioru komend MQTT na hoście: N wiadomości <base>/cmd/...
+// przechodzi przez MQTTClient::onMessage() (dopasowanie tematu w tablicy
+// tras, kopia payloadu do kolejki) i mqtt.loop() w pętli głównej
+// (wykonanie komendy) – ta sama droga, co callback PubSubClient na urządzeniu.
+// Zadanie "mqtt" działa w tle i publikuje zmienione snapshoty jak zwykle.
+//
+// Wynik dla każdego rodzaju komendy: komendy/s oraz alokacje sterty na
+// komendę – w wątku pętli (odbiór + wykonanie) i łącznie we wszystkich
+// wątkach (także publikacje snapshotów po zmianie), z liczników host_heap.h.
+//
+// Użycie: mqtt_cmd_bench [komend_na_rodzaj=20000]
+#include <Arduino.h>
+#include "FS.h"
+#include "LittleFS.h"
+#include <Preferences.h>
+#include <PubSubClient.h>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+#include "host_heap.h"
+#include "Config.h"
+#include "Zones.h"
+#include "Programs.h"
+#include "Weather.h"
+#include "Logs.h"
+#include "HttpsPool.h"
+#include "PushoverClient.h"
+#include "MQTTClient.h"
+
+Config config;
+Zones zones;
+HttpsPool httpsPool;
+Weather weather(&httpsPool);
+Logs logs;
+PushoverClient pushover(config.getSettingsPtr(), &httpsPool);
+Programs programs;
+MQTTClient mqtt;
+volatile uint32_t heapAllocCount = 0;
+
+static const int ZONES = 8;
+
+// Ta sama furtka do prywatnego onMessage(), co w host/tests (friend struct HostTest)
+struct HostTest {
+  static void onMessage(MQTTClient& m, char* topic, byte* payload, unsigned int len) {
+    m.onMessage(topic, payload, len);
+  }
+};
+
+struct Msg {
+  std::string topic, payload;
+};
+
+struct Scenario {
+  const char* name;
+  std::vector<Msg> msgs;
+};
+
+static void seedSettings() {
+  Preferences p;
+  p.begin("ews", false);
+  p.putString("ssid", "bench");
+  p.putString("pass", "bench");
+  p.putString("mqttServer", "localhost");
+  p.putString("mqttClientId", "cmd-bench");
+  p.putString("mqttTopicBase", "bench");
+  p.putString("relayDriver", "mock");
+  p.putInt("zoneCount", ZONES);
+  p.putInt("maxZonesOn", 2);
+  p.putBool("enableWeatherApi", false);
+  p.putBool("enablePushover", false);
+  p.end();
+}
+
+// Wiadomości przygotowane przed pomiarem – liczymy tylko koszt klienta
+static Scenario makeScenario(const char* name, unsigned long n, int kind) {
+  Scenario s{ name, {} };
+  s.msgs.reserve(n);
+  char topic[64];
+  for (unsigned long i = 0; i < n; i++) {
+    const int zone = i % ZONES;
+    switch (kind) {
+      case 0: // start/stop na przemian
+        snprintf(topic, sizeof(topic), "bench/cmd/zones/%d/%s", zone, (i / ZONES) % 2 ? "stop" : "start");
+        s.msgs.push_back({ topic, (i / ZONES) % 2 ? "" : "120" });
+        break;
+      case 1:
+        snprintf(topic, sizeof(topic), "bench/cmd/zones/%d/toggle", zone);
+        s.msgs.push_back({ topic, "" });
+        break;
+      case 2: // nazwy stref – payload JSON
+        s.msgs.push_back({ "bench/cmd/zones-names/set",
+                           "[\"Trawnik\",\"Rabata\",\"Warzywnik\",\"Tuje\",\"Skarpa\",\"Taras\",\"Sad\",\"Kroplówka\"]" });
+        break;
+      default: // nieznany temat – odrzucony przy dopasowaniu
+        snprintf(topic, sizeof(topic), "bench/cmd/zones/%d/explode", zone);
+        s.msgs.push_back({ topic, "1" });
+        break;
+    }
+  }
+  return s;
+}
+
+// Rozpoznane komendy stref (liczniki z statsToJson()["commands"])
+static uint32_t commandsDone() {
+  static const char* const keys[] = { "zoneToggle", "zoneStart", "zoneStop", "zoneNames" };
+  JsonDocument doc;
+  mqtt.statsToJson(doc);
+  uint32_t n = 0;
+  for (const char* k : keys) n += doc["commands"][k] | 0UL;
+  return n;
+}
+
+int main(int argc, char** argv) {
+  const unsigned long n = argc > 1 ? strtoul(argv[1], nullptr, 10) : 20000;
+
+  setenv("TZ", "CET-1CEST,M3.5.0,M10.5.0/3", 1);
+  tzset();
+  seedSettings();
+
+  LittleFS.begin();
+  config.load();
+  config.initWiFi(&pushover);
+  zones.begin(createRelayDriver(config.getRelayDriver(), config.getRelayPins()), config.getZoneCount());
+  zones.setBudget(config.getMaxConcurrentZones(), config.getSupplyCapacity());
+  logs.begin();
+  weather.begin(config.getOwmApiKey(), config.getOwmLocation(), false, config.getWeatherUpdateIntervalMin());
+  programs.begin(&zones, &weather, &logs, &pushover, &config);
+  mqtt.begin(&zones, &programs, &weather, &logs, &config);
+
+  // Połączenie z brokerem w pamięci i pierwsze publikacje wszystkich snapshotów
+  const unsigned long waitEnd = millis() + 5000;
+  for (;;) {
+    JsonDocument st;
+    mqtt.statsToJson(st);
+    if (st["connected"] | false) break;
+    if (millis() > waitEnd) { fprintf(stderr, "mqtt_cmd_bench: brak połączenia z brokerem\n"); _exit(1); }
+    config.wifiLoop();
+    delay(10);
+  }
+  delay(500);
+
+  Scenario scenarios[] = {
+    makeScenario("start/stop", n, 0),
+    makeScenario("toggle", n, 1),
+    makeScenario("names-json", n, 2),
+    makeScenario("unknown", n, 3),
+  };
+
+  printf("mqtt_cmd_bench: %lu komend na rodzaj, %d stref\n\n", n, ZONES);
+  printf("%-11s %10s %12s %14s %14s\n", "komenda", "cmd/s", "avg_us", "alloc/cmd", "alloc/cmd_all");
+  bool ok = true;
+  for (Scenario& s : scenarios) {
+    const uint32_t doneBefore = commandsDone();
+    const uint64_t threadBefore = host::heapThreadAllocs();
+    const uint64_t allBefore = host::heapStats().allocs;
+    const unsigned long t0 = micros();
+    for (Msg& m : s.msgs) {
+      HostTest::onMessage(mqtt, &m.topic[0], (byte*)&m.payload[0], (unsigned int)m.payload.size());
+      mqtt.loop();
+    }
+    const unsigned long us = micros() - t0;
+    const uint64_t threadAllocs = host::heapThreadAllocs() - threadBefore;
+    delay(100); // zadanie MQTT kończy publikacje po ostatniej komendzie
+    const uint64_t allAllocs = host::heapStats().allocs - allBefore;
+    const uint32_t done = commandsDone() - doneBefore;
+
+    const double cmds = (double)s.msgs.size();
+    printf("%-11s %10.0f %12.2f %14.2f %14.2f\n", s.name, us ? cmds * 1e6 / us : 0.0, us / cmds,
+           threadAllocs / cmds, allAllocs / cmds);
+    // Rozpoznana (i bez zgubienia w kolejce wykonana) każda komenda poza nieznanymi tematami
+    if (strcmp(s.name, "unknown") != 0 && done != s.msgs.size()) {
+      printf("%s: wykonano %lu z %zu komend!\n", s.name, (unsigned long)done, s.msgs.size());
+      ok = false;
+    }
+    for (int z = 0; z < ZONES; z++) zones.stopZone(z);
+  }
+
+  JsonDocument ms;
+  mqtt.statsToJson(ms);
+  printf("\npublikacje MQTT: %lu, odrzucone komendy: %lu, nieznane tematy: %lu\n",
+         (unsigned long)(ms["publishes"] | 0UL), (unsigned long)(ms["commands"]["dropped"] | 0UL),
+         (unsigned long)(ms["commands"]["unknown"] | 0UL));
+  fflush(stdout);
+  // Zadania (mqtt, esp_timer) nie mają końca – jak na urządzeniu
+  _exit(ok ? 0 : 1);
+}
@@ -0,0 +1,154 @@
+// Benchmark parsowania odpowiedzi OpenWeatherMap na hoście.
+// Odpowiedzi /data/2.5/weather i /data/2.5/forecast z host/fixtures/ idą
+// przez HTTPClient z host/shim/ na dwa sposoby:
+//  - "string": całe body przez getString() i deserializeJson bez filtra
+//    (Weather przed parsowaniem strumieniowym),
+//  - "stream": deserializeJson prosto z HttpBodyStream z filtrem Weather
+//    (tak jak Weather::getJson()).
+// Dla każdej ścieżki: czas parsowania, szczyt sterty ponad stan sprzed
+// parsowania (host_heap.h) i liczba alokacji. Obie ścieżki muszą dać ten sam
+// snapshot (Weather::readCurrent/readForecast) – inaczej kod wyjścia 1.
+//
+// Użycie: owm_parse_bench [powtórzeń=200] [katalog_z_odpowiedziami]
+#include <Arduino.h>
+#include <HTTPClient.h>
+#include <ArduinoJson.h>
+#include <fstream>
+#include <sstream>
+#include <time.h>
+
+#include "host_heap.h"
+#include "HttpsPool.h"
+#include "Weather.h"
+
+#ifndef OWM_FIXTURES
+#define OWM_FIXTURES "fixtures"
+#endif
+
+enum Kind : uint8_t { CURRENT, FORECAST };
+enum Path : uint8_t { STRING_FULL, STREAM_FILTERED };
+
+struct Result {
+  uint64_t sumUs = 0;
+  uint32_t maxUs = 0;
+  int64_t  peak = 0;    // bajty ponad stan sprzed parsowania (maksimum z przebiegów)
+  uint64_t allocs = 0;  // łącznie
+  bool ok = true;
+  WeatherSnapshot snap;
+};
+
+static std::string fixtureBody;
+
+static bool readFile(const std::string& path, std::string& out) {
+  std::ifstream f(path, std::ios::binary);
+  if (!f) return false;
+  std::stringstream ss;
+  ss << f.rdbuf();
+  out = ss.str();
+  return true;
+}
+
+// Jutro względem pierwszego wpisu prognozy (jak ydayTomorrow() w chwili pobrania)
+static int targetYdayFor(const std::string& forecast) {
+  JsonDocument doc;
+  JsonDocument filter;
+  filter["list"][0]["dt"] = true;
+  deserializeJson(doc, forecast.c_str(), DeserializationOption::Filter(filter));
+  time_t ts = (time_t)(doc["list"][0]["dt"] | 0L) + 24 * 3600;
+  struct tm t;
+  localtime_r(&ts, &t);
+  return t.tm_yday;
+}
+
+static void runOnce(Kind kind, Path path, int targetYday, Result& r) {
+  WiFiClient client;
+  HTTPClient http;
+  http.begin(client, kind == CURRENT ? "https://api.openweathermap.org/data/2.5/weather"
+                                     : "https://api.openweathermap.org/data/2.5/forecast");
+  if (http.GET() != HTTP_CODE_OK) { r.ok = false; return; }
+
+  // Filtr buduje Weather przy każdym pobraniu – liczy się do kosztu
+  const host::HeapStats before = host::heapStats();
+  host::heapResetPeak();
+  const unsigned long t0 = micros();
+  JsonDocument doc;
+  DeserializationError err;
+  if (path == STRING_FULL) {
+    String body = http.getString();
+    err = deserializeJson(doc, body);
+  } else {
+    JsonDocument filter;
+    if (kind == CURRENT) Weather::currentFilter(filter);
+    else                 Weather::forecastFilter(filter);
+    HttpBodyStream body(http);
+    err = deserializeJson(doc, body, DeserializationOption::Filter(filter));
+  }
+  const uint32_t us = (uint32_t)(micros() - t0);
+  const host::HeapStats after = host::heapStats();
+
+  r.sumUs += us;
+  if (us > r.maxUs) r.maxUs = us;
+  if (after.peak - before.live > r.peak) r.peak = after.peak - before.live;
+  r.allocs += after.allocs - before.allocs;
+  if (err) { r.ok = false; return; }
+  if (kind == CURRENT) Weather::readCurrent(doc, r.snap);
+  else                 Weather::readForecast(doc, r.snap, targetYday);
+}
+
+static bool sameSnapshot(const WeatherSnapshot& a, const WeatherSnapshot& b) {
+  return a.temp == b.temp && a.feels_like == b.feels_like && a.temp_min == b.temp_min &&
+         a.temp_max == b.temp_max && a.humidity == b.humidity && a.pressure == b.pressure &&
+         a.wind == b.wind && a.wind_deg == b.wind_deg && a.clouds == b.clouds &&
+         a.visibility == b.visibility && a.rain == b.rain &&
+         !strcmp(a.weather_desc, b.weather_desc) && !strcmp(a.icon, b.icon) &&
+         !strcmp(a.sunrise, b.sunrise) && !strcmp(a.sunset, b.sunset) &&
+         a.rain_1h_forecast == b.rain_1h_forecast && a.rain_6h_forecast == b.rain_6h_forecast &&
+         a.temp_min_tomorrow == b.temp_min_tomorrow && a.temp_max_tomorrow == b.temp_max_tomorrow &&
+         a.humidity_tomorrow_max == b.humidity_tomorrow_max;
+}
+
+int main(int argc, char** argv) {
+  const unsigned long reps = argc > 1 ? strtoul(argv[1], nullptr, 10) : 200;
+  const std::string dir = argc > 2 ? argv[2] : OWM_FIXTURES;
+
+  setenv("TZ", "CET-1CEST,M3.5.0,M10.5.0/3", 1);
+  tzset();
+
+  static const char* const files[] = { "owm-weather.json", "owm-forecast.json" };
+  static const char* const paths[] = { "string", "stream" };
+  std::string bodies[2];
+  for (int k = 0; k < 2; k++) {
+    if (!readFile(dir + "/" + files[k], bodies[k])) {
+      fprintf(stderr, "owm_parse_bench: brak %s/%s\n", dir.c_str(), files[k]);
+      return 1;
+    }
+  }
+  const int targetYday = targetYdayFor(bodies[FORECAST]);
+  host::httpHandler = [](const String&, const String&, const String&) {
+    host::HttpReply r;
+    r.code = HTTP_CODE_OK;
+    r.body = fixtureBody;
+    return r;
+  };
+
+  printf("owm_parse_bench: %lu powtórzeń\n\n", reps);
+  printf("%-9s %-7s %8s %8s %8s %10s %10s\n", "odpowiedź", "parser", "body_B", "avg_us", "max_us", "peak_heap", "alloc/op");
+  bool ok = true;
+  for (int k = 0; k < 2; k++) {
+    fixtureBody = bodies[k];
+    Result res[2];
+    for (int p = 0; p < 2; p++) {
+      for (unsigned long i = 0; i < reps; i++) runOnce((Kind)k, (Path)p, targetYday, res[p]);
+      printf("%-9s %-7s %8zu %8lu %8lu %10lld %10.1f\n", k == CURRENT ? "weather" : "forecast", paths[p],
+             fixtureBody.size(), reps ? (unsigned long)(res[p].sumUs / reps) : 0UL, (unsigned long)res[p].maxUs,
+             (long long)res[p].peak, reps ? (double)res[p].allocs / reps : 0.0);
+      ok = ok && res[p].ok;
+    }
+    if (!sameSnapshot(res[STRING_FULL].snap, res[STREAM_FILTERED].snap)) {
+      printf("%s: różne wyniki parserów!\n", files[k]);
+      ok = false;
+    }
+  }
+  printf("\nwyniki zgodne: %s\n", ok ? "tak" : "NIE");
+  return ok ? 0 : 1;
+}
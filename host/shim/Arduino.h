@@ -0,0 +1,400 @@
+#pragma once
+// Zamiennik rdzenia Arduino-ESP32 dla kompilacji na hoście (Linux).
+// Tylko to, czego używają moduły z src/: String, Print/Stream, Serial,
+// czas (millis/micros), GPIO w pamięci i kilka funkcji pomocniczych.
+#ifndef ARDUINO
+#define ARDUINO 10819 // jak rdzeń ESP32 – ArduinoJson włącza obsługę String/Print/Stream
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <math.h>
+#include <time.h>
+#include <ctype.h>
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <type_traits>
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+// --- Czas ---
+namespace host {
+  inline std::chrono::steady_clock::time_point bootTime() {
+    static const auto t0 = std::chrono::steady_clock::now();
+    return t0;
+  }
+}
+
+inline unsigned long micros() {
+  return (unsigned long)std::chrono::duration_cast<std::chrono::microseconds>(
+    std::chrono::steady_clock::now() - host::bootTime()).count();
+}
+inline unsigned long millis() {
+  return (unsigned long)std::chrono::duration_cast<std::chrono::milliseconds>(
+    std::chrono::steady_clock::now() - host::bootTime()).count();
+}
+inline void delay(unsigned long ms) { std::this_thread::sleep_for(std::chrono::milliseconds(ms)); }
+inline void delayMicroseconds(unsigned int us) { std::this_thread::sleep_for(std::chrono::microseconds(us)); }
+inline void yield() { std::this_thread::yield(); }
+
+// NTP na hoście: zegar systemowy jest już ustawiony
+inline void configTime(long, int, const char*, const char* = nullptr, const char* = nullptr) {}
+
+// --- Pomocnicze jak w rdzeniu ---
+// Przez wartość (nie std::min) – argumentem bywa "static const int" bez definicji
+template <typename A, typename B>
+inline typename std::common_type<A, B>::type min(A a, B b) { return a < b ? a : b; }
+template <typename A, typename B>
+inline typename std::common_type<A, B>::type max(A a, B b) { return a > b ? a : b; }
+#ifndef constrain
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+#endif
+
+inline bool isDigit(int c) { return isdigit(c) != 0; }
+inline bool isSpace(int c) { return isspace(c) != 0; }
+inline bool isAlpha(int c) { return isalpha(c) != 0; }
+
+#if !defined(__GLIBC__) || __GLIBC__ < 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ < 38)
+inline size_t strlcpy(char* dst, const char* src, size_t cap) {
+  const size_t n = strlen(src);
+  if (cap) {
+    const size_t c = n < cap - 1 ? n : cap - 1;
+    memcpy(dst, src, c);
+    dst[c] = '\0';
+  }
+  return n;
+}
+#endif
+
+// --- GPIO: stan pinów w pamięci ---
+#define LOW    0x0
+#define HIGH   0x1
+#define INPUT  0x01
+#define OUTPUT 0x03
+#define MSBFIRST 1
+#define LSBFIRST 0
+
+namespace host {
+  struct Gpio {
+    uint8_t mode[64] = {0};
+    uint8_t level[64] = {0};
+    uint32_t writes = 0;
+  };
+  inline Gpio& gpio() { static Gpio g; return g; }
+}
+
+inline void pinMode(uint8_t pin, uint8_t mode) { if (pin < 64) host::gpio().mode[pin] = mode; }
+inline void digitalWrite(uint8_t pin, uint8_t val) {
+  if (pin < 64) host::gpio().level[pin] = val;
+  host::gpio().writes++;
+}
+inline int digitalRead(uint8_t pin) { return pin < 64 ? host::gpio().level[pin] : LOW; }
+
+// --- String (podzbiór WString z rdzenia) ---
+class String {
+  std::string s;
+
+public:
+  String() {}
+  String(const char* c) : s(c ? c : "") {}
+  String(const char* c, unsigned int len) : s(c ? std::string(c, len) : std::string()) {}
+  String(const std::string& x) : s(x) {}
+  String(const String&) = default;
+  String(String&&) = default;
+  explicit String(char c) : s(1, c) {}
+  explicit String(unsigned char v, unsigned char base = 10) : String((unsigned long)v, base) {}
+  explicit String(int v, unsigned char base = 10) : String((long)v, base) {}
+  explicit String(unsigned int v, unsigned char base = 10) : String((unsigned long)v, base) {}
+  explicit String(long v, unsigned char base = 10) {
+    char b[34];
+    if (base == 10) snprintf(b, sizeof(b), "%ld", v);
+    else ltoa(v, b, base);
+    s = b;
+  }
+  explicit String(unsigned long v, unsigned char base = 10) {
+    char b[34];
+    if (base == 10) snprintf(b, sizeof(b), "%lu", v);
+    else ultoa(v, b, base);
+    s = b;
+  }
+  explicit String(long long v) : s(std::to_string(v)) {}
+  explicit String(unsigned long long v) : s(std::to_string(v)) {}
+  explicit String(float v, unsigned int decimals = 2) : String((double)v, decimals) {}
+  explicit String(double v, unsigned int decimals = 2) {
+    char b[48];
+    snprintf(b, sizeof(b), "%.*f", (int)decimals, v);
+    s = b;
+  }
+
+  String& operator=(const String&) = default;
+  String& operator=(String&&) = default;
+  String& operator=(const char* c) { s = c ? c : ""; return *this; }
+
+  const char* c_str() const { return s.c_str(); }
+  unsigned int length() const { return (unsigned int)s.size(); }
+  bool isEmpty() const { return s.empty(); }
+  bool reserve(unsigned int n) { s.reserve(n); return true; }
+
+  char charAt(unsigned int i) const { return i < s.size() ? s[i] : 0; }
+  void setCharAt(unsigned int i, char c) { if (i < s.size()) s[i] = c; }
+  char operator[](unsigned int i) const { return charAt(i); }
+  char& operator[](unsigned int i) { return s[i]; }
+
+  bool concat(const String& o) { s += o.s; return true; }
+  bool concat(const char* c) { if (!c) return false; s += c; return true; }
+  bool concat(const char* c, unsigned int n) { if (!c) return false; s.append(c, n); return true; }
+  bool concat(char c) { s += c; return true; }
+  bool concat(unsigned char v) { return concat(String(v)); }
+  bool concat(int v) { return concat(String(v)); }
+  bool concat(unsigned int v) { return concat(String(v)); }
+  bool concat(long v) { return concat(String(v)); }
+  bool concat(unsigned long v) { return concat(String(v)); }
+  bool concat(float v) { return concat(String(v)); }
+  bool concat(double v) { return concat(String(v)); }
+
+  template <typename T> String& operator+=(const T& v) { concat(v); return *this; }
+
+  bool equals(const String& o) const { return s == o.s; }
+  bool equals(const char* c) const { return s == (c ? c : ""); }
+  bool equalsIgnoreCase(const String& o) const {
+    if (s.size() != o.s.size()) return false;
+    for (size_t i = 0; i < s.size(); i++) if (tolower((unsigned char)s[i]) != tolower((unsigned char)o.s[i])) return false;
+    return true;
+  }
+  int compareTo(const String& o) const { return s.compare(o.s); }
+  bool operator==(const String& o) const { return s == o.s; }
+  bool operator==(const char* c) const { return equals(c); }
+  bool operator!=(const String& o) const { return s != o.s; }
+  bool operator!=(const char* c) const { return !equals(c); }
+  bool operator<(const String& o) const { return s < o.s; }
+
+  bool startsWith(const String& p) const { return s.compare(0, p.s.size(), p.s) == 0; }
+  bool startsWith(const String& p, unsigned int off) const { return off <= s.size() && s.compare(off, p.s.size(), p.s) == 0; }
+  bool endsWith(const String& p) const { return s.size() >= p.s.size() && s.compare(s.size() - p.s.size(), p.s.size(), p.s) == 0; }
+
+  int indexOf(char c, unsigned int from = 0) const { size_t p = s.find(c, from); return p == std::string::npos ? -1 : (int)p; }
+  int indexOf(const String& x, unsigned int from = 0) const { size_t p = s.find(x.s, from); return p == std::string::npos ? -1 : (int)p; }
+  int lastIndexOf(char c) const { size_t p = s.rfind(c); return p == std::string::npos ? -1 : (int)p; }
+  int lastIndexOf(const String& x) const { size_t p = s.rfind(x.s); return p == std::string::npos ? -1 : (int)p; }
+
+  String substring(unsigned int from) const { return from >= s.size() ? String() : String(s.substr(from)); }
+  String substring(unsigned int from, unsigned int to) const {
+    if (from > to) std::swap(from, to);
+    if (from >= s.size()) return String();
+    return String(s.substr(from, std::min<size_t>(to, s.size()) - from));
+  }
+
+  void replace(const String& a, const String& b) {
+    if (a.s.empty()) return;
+    for (size_t p = 0; (p = s.find(a.s, p)) != std::string::npos; p += b.s.size()) s.replace(p, a.s.size(), b.s);
+  }
+  void remove(unsigned int index) { if (index < s.size()) s.erase(index); }
+  void remove(unsigned int index, unsigned int count) { if (index < s.size()) s.erase(index, count); }
+  void toLowerCase() { for (auto& c : s) c = (char)tolower((unsigned char)c); }
+  void toUpperCase() { for (auto& c : s) c = (char)toupper((unsigned char)c); }
+  void trim() {
+    size_t a = 0, b = s.size();
+    while (a < b && isspace((unsigned char)s[a])) a++;
+    while (b > a && isspace((unsigned char)s[b - 1])) b--;
+    s = s.substr(a, b - a);
+  }
+
+  long toInt() const { return strtol(s.c_str(), nullptr, 10); }
+  float toFloat() const { return strtof(s.c_str(), nullptr); }
+  double toDouble() const { return strtod(s.c_str(), nullptr); }
+
+  void getBytes(unsigned char* buf, unsigned int cap, unsigned int from = 0) const {
+    if (!cap) return;
+    strlcpy((char*)buf, from < s.size() ? s.c_str() + from : "", cap);
+  }
+  void toCharArray(char* buf, unsigned int cap, unsigned int from = 0) const { getBytes((unsigned char*)buf, cap, from); }
+
+  friend String operator+(const String& a, const String& b) { String r(a); r.s += b.s; return r; }
+  friend String operator+(const String& a, const char* b) { String r(a); r.concat(b); return r; }
+  friend String operator+(const char* a, const String& b) { String r(a); r.s += b.s; return r; }
+  friend String operator+(const String& a, char c) { String r(a); r.s += c; return r; }
+  friend String operator+(const String& a, int v) { return a + String(v); }
+  friend String operator+(const String& a, unsigned int v) { return a + String(v); }
+  friend String operator+(const String& a, long v) { return a + String(v); }
+  friend String operator+(const String& a, unsigned long v) { return a + String(v); }
+  friend String operator+(const String& a, float v) { return a + String(v); }
+  friend String operator+(const String& a, double v) { return a + String(v); }
+  friend bool operator==(const char* a, const String& b) { return b.equals(a); }
+  friend bool operator!=(const char* a, const String& b) { return !b.equals(a); }
+
+private:
+  static void ltoa(long v, char* b, int base) {
+    if (v < 0) { *b++ = '-'; v = -v; }
+    ultoa((unsigned long)v, b, base);
+  }
+  static void ultoa(unsigned long v, char* b, int base) {
+    char t[34]; int n = 0;
+    do { int d = (int)(v % base); t[n++] = (char)(d < 10 ? '0' + d : 'a' + d - 10); v /= base; } while (v);
+    while (n) *b++ = t[--n];
+    *b = 0;
+  }
+};
+
+// Wynik operatora + w rdzeniu; ArduinoJson rozpoznaje go jak String
+class StringSumHelper : public String {
+public:
+  using String::String;
+};
+
+// --- Print / Stream ---
+class Print;
+class Printable {
+public:
+  virtual ~Printable() {}
+  virtual size_t printTo(Print& p) const = 0;
+};
+
+class Print {
+public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t) = 0;
+  virtual size_t write(const uint8_t* buf, size_t n) {
+    size_t w = 0;
+    while (n--) w += write(*buf++);
+    return w;
+  }
+  size_t write(const char* s) { return s ? write((const uint8_t*)s, strlen(s)) : 0; }
+  size_t write(const char* s, size_t n) { return write((const uint8_t*)s, n); }
+  virtual void flush() {}
+
+  size_t printf(const char* fmt, ...) __attribute__((format(printf, 2, 3))) {
+    char small[256];
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(small, sizeof(small), fmt, ap);
+    va_end(ap);
+    if (n < 0) return 0;
+    if ((size_t)n < sizeof(small)) return write((const uint8_t*)small, n);
+    std::string big(n + 1, '\0');
+    va_start(ap, fmt);
+    vsnprintf(&big[0], big.size(), fmt, ap);
+    va_end(ap);
+    return write((const uint8_t*)big.data(), n);
+  }
+
+  size_t print(const char* s) { return write(s); }
+  size_t print(const String& s) { return write((const uint8_t*)s.c_str(), s.length()); }
+  size_t print(const Printable& x) { return x.printTo(*this); }
+  size_t print(char c) { return write((uint8_t)c); }
+  size_t print(int v) { return printf("%d", v); }
+  size_t print(unsigned int v) { return printf("%u", v); }
+  size_t print(long v) { return printf("%ld", v); }
+  size_t print(unsigned long v) { return printf("%lu", v); }
+  size_t print(long long v) { return printf("%lld", v); }
+  size_t print(unsigned long long v) { return printf("%llu", v); }
+  size_t print(double v, int digits = 2) { return printf("%.*f", digits, v); }
+
+  size_t println() { return write("\r\n"); }
+  template <typename T> size_t println(const T& v) { size_t n = print(v); return n + println(); }
+};
+
+class Stream : public Print {
+protected:
+  unsigned long _timeout = 1000;
+
+  int timedRead() {
+    const unsigned long t0 = millis();
+    do {
+      int c = read();
+      if (c >= 0) return c;
+      yield();
+    } while (millis() - t0 < _timeout);
+    return -1;
+  }
+
+public:
+  virtual int available() = 0;
+  virtual int read() = 0;
+  virtual int peek() = 0;
+
+  void setTimeout(unsigned long ms) { _timeout = ms; }
+  unsigned long getTimeout() const { return _timeout; }
+
+  size_t readBytes(char* buf, size_t n) {
+    size_t got = 0;
+    while (got < n) {
+      int c = timedRead();
+      if (c < 0) break;
+      buf[got++] = (char)c;
+    }
+    return got;
+  }
+  size_t readBytes(uint8_t* buf, size_t n) { return readBytes((char*)buf, n); }
+
+  size_t readBytesUntil(char term, char* buf, size_t n) {
+    size_t got = 0;
+    while (got < n) {
+      int c = timedRead();
+      if (c < 0 || c == term) break;
+      buf[got++] = (char)c;
+    }
+    return got;
+  }
+
+  String readStringUntil(char term) {
+    String r;
+    int c;
+    while ((c = timedRead()) >= 0 && c != term) r += (char)c;
+    return r;
+  }
+
+  String readString() {
+    String r;
+    int c;
+    while ((c = timedRead()) >= 0) r += (char)c;
+    return r;
+  }
+};
+
+// Serial: na stdout tylko z HOST_SERIAL=1 (benchmark i testy są ciche)
+class HardwareSerial : public Stream {
+  bool echo;
+
+public:
+  HardwareSerial() : echo(getenv("HOST_SERIAL") && atoi(getenv("HOST_SERIAL"))) {}
+  void begin(unsigned long) {}
+  size_t write(uint8_t c) override { if (echo) fputc(c, stdout); return 1; }
+  size_t write(const uint8_t* b, size_t n) override { if (echo) fwrite(b, 1, n, stdout); return n; }
+  using Print::write;
+  int available() override { return 0; }
+  int read() override { return -1; }
+  int peek() override { return -1; }
+};
+inline HardwareSerial Serial;
+
+// --- ESP ---
+class EspClass {
+public:
+  uint32_t getFreeHeap() { return 200 * 1024; }
+  uint32_t getMinFreeHeap() { return 180 * 1024; }
+  void restart() { exit(0); }
+};
+inline EspClass ESP;
+
+// --- IPAddress (tylko do wypisania) ---
+class IPAddress {
+  uint8_t b[4];
+
+public:
+  IPAddress(uint8_t a = 0, uint8_t c = 0, uint8_t d = 0, uint8_t e = 0) : b{a, c, d, e} {}
+  String toString() const {
+    char s[16];
+    snprintf(s, sizeof(s), "%u.%u.%u.%u", b[0], b[1], b[2], b[3]);
+    return String(s);
+  }
+};
+
+// Rdzeń ESP32 dołącza esp_system.h (esp_random) w Arduino.h
+#include <esp_random.h>
@@ -0,0 +1,209 @@
+#pragma once
+// System plików w pamięci RAM (zamiast LittleFS na flashu). Pliki to wektory
+// bajtów współdzielone przez otwarte uchwyty; tryby jak w LittleFS:
+// "r", "w" (obcina), "a" (dopisuje), "r+" (czyta i pisze, plik musi istnieć).
+#include <Arduino.h>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+enum SeekMode { SeekSet = 0, SeekCur = 1, SeekEnd = 2 };
+
+namespace host {
+  struct FsNode {
+    std::vector<uint8_t> data;
+    time_t mtime = 0;
+  };
+
+  struct FsState {
+    std::mutex m; // zadania (weather, mqtt) i pętla mogą pisać jednocześnie
+    std::map<std::string, std::shared_ptr<FsNode>> files;
+  };
+  inline FsState& fs() { static FsState* s = new FsState; return *s; } // zadania mogą pisać jeszcze przy exit()
+}
+
+namespace fs {
+
+class File : public Stream {
+  std::shared_ptr<host::FsNode> node;
+  std::string fpath;
+  size_t pos = 0;
+  bool canRead = false, canWrite = false, append = false;
+  bool dir = false;
+  std::vector<std::string> entries; // dla katalogu: kolejne openNextFile()
+  size_t nextEntry = 0;
+
+public:
+  File() {}
+  File(std::shared_ptr<host::FsNode> n, const std::string& p, const char* mode)
+    : node(std::move(n)), fpath(p) {
+    canRead = mode[0] == 'r' || mode[1] == '+';
+    canWrite = mode[0] != 'r' || mode[1] == '+';
+    append = mode[0] == 'a';
+    if (append) pos = node->data.size();
+  }
+  static File directory(const std::string& p, std::vector<std::string> names) {
+    File f;
+    f.fpath = p;
+    f.dir = true;
+    f.entries = std::move(names);
+    return f;
+  }
+
+  explicit operator bool() const { return node != nullptr || dir; }
+
+  size_t write(uint8_t c) override { return write(&c, 1); }
+  size_t write(const uint8_t* buf, size_t n) override {
+    if (!node || !canWrite) return 0;
+    std::lock_guard<std::mutex> l(host::fs().m);
+    if (append) pos = node->data.size();
+    if (pos + n > node->data.size()) node->data.resize(pos + n);
+    memcpy(node->data.data() + pos, buf, n);
+    pos += n;
+    node->mtime = time(nullptr);
+    return n;
+  }
+  using Print::write;
+
+  int available() override {
+    if (!node || !canRead) return 0;
+    std::lock_guard<std::mutex> l(host::fs().m);
+    return pos < node->data.size() ? (int)(node->data.size() - pos) : 0;
+  }
+  int read() override {
+    uint8_t c;
+    return read(&c, 1) == 1 ? c : -1;
+  }
+  int peek() override {
+    if (!node || !canRead) return -1;
+    std::lock_guard<std::mutex> l(host::fs().m);
+    return pos < node->data.size() ? node->data[pos] : -1;
+  }
+  size_t read(uint8_t* buf, size_t n) {
+    if (!node || !canRead) return 0;
+    std::lock_guard<std::mutex> l(host::fs().m);
+    if (pos >= node->data.size()) return 0;
+    if (n > node->data.size() - pos) n = node->data.size() - pos;
+    memcpy(buf, node->data.data() + pos, n);
+    pos += n;
+    return n;
+  }
+  // Bez czekania na timeout jak w Stream – plik nie "dosyła" danych
+  size_t readBytes(char* buf, size_t n) { return read((uint8_t*)buf, n); }
+  size_t readBytes(uint8_t* buf, size_t n) { return read(buf, n); }
+
+  bool seek(uint32_t off, SeekMode mode = SeekSet) {
+    if (!node) return false;
+    std::lock_guard<std::mutex> l(host::fs().m);
+    size_t base = mode == SeekSet ? 0 : mode == SeekCur ? pos : node->data.size();
+    if (base + off > node->data.size()) return false;
+    pos = base + off;
+    return true;
+  }
+  size_t position() const { return pos; }
+  size_t size() const {
+    if (!node) return 0;
+    std::lock_guard<std::mutex> l(host::fs().m);
+    return node->data.size();
+  }
+  void flush() override {}
+  void close() { node.reset(); dir = false; }
+
+  time_t getLastWrite() { return node ? node->mtime : 0; }
+  const char* name() const {
+    size_t s = fpath.rfind('/');
+    return s == std::string::npos ? fpath.c_str() : fpath.c_str() + s + 1;
+  }
+  const char* path() const { return fpath.c_str(); }
+  bool isDirectory() const { return dir; }
+
+  File openNextFile(const char* = "r");
+};
+
+class FS {
+  static std::string norm(const char* p) {
+    std::string s = p ? p : "";
+    if (s.empty() || s[0] != '/') s = "/" + s;
+    return s;
+  }
+
+public:
+  bool begin(bool = false, const char* = "/littlefs", uint8_t = 10, const char* = nullptr) { return true; }
+  void end() {}
+  bool format() {
+    std::lock_guard<std::mutex> l(host::fs().m);
+    host::fs().files.clear();
+    return true;
+  }
+
+  File open(const char* path, const char* mode = "r", bool = false) {
+    const std::string p = norm(path);
+    std::lock_guard<std::mutex> l(host::fs().m);
+    auto& files = host::fs().files;
+    if (p == "/") {
+      std::vector<std::string> names;
+      for (auto& kv : files) names.push_back(kv.first);
+      return File::directory(p, std::move(names));
+    }
+    auto it = files.find(p);
+    if (mode[0] == 'r') {
+      if (it == files.end()) return File();
+      return File(it->second, p, mode);
+    }
+    if (it == files.end()) it = files.emplace(p, std::make_shared<host::FsNode>()).first;
+    if (mode[0] == 'w') {
+      // Nowy węzeł: uchwyty otwarte wcześniej widzą starą treść, jak po unlink
+      it->second = std::make_shared<host::FsNode>();
+      it->second->mtime = time(nullptr);
+    }
+    return File(it->second, p, mode);
+  }
+  File open(const String& path, const char* mode = "r") { return open(path.c_str(), mode); }
+
+  bool exists(const char* path) {
+    std::lock_guard<std::mutex> l(host::fs().m);
+    return host::fs().files.count(norm(path)) != 0;
+  }
+  bool exists(const String& path) { return exists(path.c_str()); }
+
+  bool remove(const char* path) {
+    std::lock_guard<std::mutex> l(host::fs().m);
+    return host::fs().files.erase(norm(path)) != 0;
+  }
+  bool remove(const String& path) { return remove(path.c_str()); }
+
+  bool rename(const char* from, const char* to) {
+    std::lock_guard<std::mutex> l(host::fs().m);
+    auto& files = host::fs().files;
+    auto it = files.find(norm(from));
+    if (it == files.end()) return false;
+    files[norm(to)] = it->second;
+    files.erase(it);
+    return true;
+  }
+
+  size_t totalBytes() { return 1536 * 1024; }
+  size_t usedBytes() {
+    std::lock_guard<std::mutex> l(host::fs().m);
+    size_t n = 0;
+    for (auto& kv : host::fs().files) n += kv.second->data.size();
+    return n;
+  }
+};
+
+inline File File::openNextFile(const char*) {
+  while (dir && nextEntry < entries.size()) {
+    const std::string p = entries[nextEntry++];
+    std::lock_guard<std::mutex> l(host::fs().m);
+    auto it = host::fs().files.find(p);
+    if (it != host::fs().files.end()) return File(it->second, p, "r");
+  }
+  return File();
+}
+
+} // namespace fs
+
+using fs::File;
+using fs::FS;
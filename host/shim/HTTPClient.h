@@ -0,0 +1,81 @@
+#pragma once
+// HTTPClient na hoście: żądania obsługuje host::httpHandler (np. zapisane
+// odpowiedzi OpenWeatherMap w benchmarku). Bez handlera – błąd połączenia.
+#include <Arduino.h>
+#include <WiFiClientSecure.h>
+#include <functional>
+#include <map>
+
+#define HTTPC_ERROR_CONNECTION_REFUSED (-1)
+#define HTTPC_ERROR_SEND_HEADER_FAILED (-2)
+#define HTTPC_ERROR_CONNECTION_LOST    (-5)
+#define HTTPC_ERROR_READ_TIMEOUT       (-11)
+
+typedef enum {
+  HTTP_CODE_OK = 200,
+  HTTP_CODE_NO_CONTENT = 204,
+  HTTP_CODE_BAD_REQUEST = 400,
+  HTTP_CODE_UNAUTHORIZED = 401,
+  HTTP_CODE_NOT_FOUND = 404,
+  HTTP_CODE_TOO_MANY_REQUESTS = 429,
+  HTTP_CODE_INTERNAL_SERVER_ERROR = 500,
+} t_http_codes;
+
+namespace host {
+  struct HttpReply {
+    int code = HTTPC_ERROR_CONNECTION_REFUSED;
+    std::string body;
+  };
+  // (metoda, URL, body żądania) -> odpowiedź; wołane z zadania, które wysyła
+  inline std::function<HttpReply(const String&, const String&, const String&)> httpHandler;
+}
+
+class HTTPClient {
+  WiFiClient* client = nullptr;
+  String url;
+  long size = -1;
+  std::map<std::string, std::string> reqHeaders;
+
+public:
+  void setReuse(bool) {}
+  void setTimeout(uint16_t) {}
+  void setConnectTimeout(int32_t) {}
+
+  bool begin(WiFiClient& c, const String& u) {
+    client = &c;
+    url = u;
+    size = -1;
+    reqHeaders.clear();
+    return true;
+  }
+  bool begin(const String& u) { static WiFiClient plain; return begin(plain, u); }
+  void end() {}
+
+  void collectHeaders(const char* [], size_t) {}
+  void addHeader(const String& name, const String& value) { reqHeaders[name.c_str()] = value.c_str(); }
+  String header(const char*) { return String(); } // zawsze Content-Length
+
+  int sendRequest(const char* method, const String& body = String()) {
+    if (!client) return HTTPC_ERROR_CONNECTION_REFUSED;
+    host::HttpReply r;
+    if (host::httpHandler) r = host::httpHandler(String(method), url, body);
+    if (r.code <= 0) return r.code;
+    client->feed(r.body);
+    size = (long)r.body.size();
+    return r.code;
+  }
+  int GET() { return sendRequest("GET"); }
+  int POST(const String& body) { return sendRequest("POST", body); }
+
+  int getSize() { return (int)size; }
+  WiFiClient* getStreamPtr() { return client; }
+  WiFiClient& getStream() { return *client; }
+  // Jak w arduino-esp32: bufor rezerwowany z Content-Length, potem całe body
+  String getString() {
+    String s;
+    if (size > 0) s.reserve((unsigned int)size);
+    int c;
+    while ((c = client->read()) >= 0) s += (char)c;
+    return s;
+  }
+};
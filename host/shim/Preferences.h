@@ -0,0 +1,59 @@
+#pragma once
+// NVS na hoście: przestrzenie nazw w pamięci, wartości jako tekst
+#include <Arduino.h>
+#include <map>
+#include <string>
+
+namespace host {
+  inline std::map<std::string, std::map<std::string, std::string>>& nvs() {
+    static std::map<std::string, std::map<std::string, std::string>> m;
+    return m;
+  }
+}
+
+class Preferences {
+  std::map<std::string, std::string>* ns = nullptr;
+  bool ro = false;
+
+  const std::string* find(const char* key) const {
+    if (!ns) return nullptr;
+    auto it = ns->find(key);
+    return it == ns->end() ? nullptr : &it->second;
+  }
+  size_t put(const char* key, const std::string& v) {
+    if (!ns || ro) return 0;
+    (*ns)[key] = v;
+    return v.size() ? v.size() : 1;
+  }
+
+public:
+  bool begin(const char* name, bool readOnly = false) {
+    ns = &host::nvs()[name];
+    ro = readOnly;
+    return true;
+  }
+  void end() { ns = nullptr; }
+  bool clear() { if (!ns || ro) return false; ns->clear(); return true; }
+  bool remove(const char* key) { return ns && !ro && ns->erase(key) != 0; }
+  bool isKey(const char* key) { return find(key) != nullptr; }
+
+  String getString(const char* key, const String& def = String()) {
+    const std::string* v = find(key);
+    return v ? String(v->c_str()) : def;
+  }
+  int32_t getInt(const char* key, int32_t def = 0) { const std::string* v = find(key); return v ? (int32_t)strtol(v->c_str(), nullptr, 10) : def; }
+  uint32_t getUInt(const char* key, uint32_t def = 0) { const std::string* v = find(key); return v ? (uint32_t)strtoul(v->c_str(), nullptr, 10) : def; }
+  bool getBool(const char* key, bool def = false) { const std::string* v = find(key); return v ? *v == "1" : def; }
+  float getFloat(const char* key, float def = 0) { const std::string* v = find(key); return v ? strtof(v->c_str(), nullptr) : def; }
+
+  size_t putString(const char* key, const String& v) { return put(key, v.c_str()); }
+  size_t putString(const char* key, const char* v) { return put(key, v ? v : ""); }
+  size_t putInt(const char* key, int32_t v) { return put(key, std::to_string(v)); }
+  size_t putUInt(const char* key, uint32_t v) { return put(key, std::to_string(v)); }
+  size_t putBool(const char* key, bool v) { return put(key, v ? "1" : "0"); }
+  size_t putFloat(const char* key, float v) {
+    char b[32];
+    snprintf(b, sizeof(b), "%.9g", v);
+    return put(key, b);
+  }
+};
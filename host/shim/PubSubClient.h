@@ -0,0 +1,109 @@
+#pragma once
+// PubSubClient na hoście: broker w pamięci. Publikacje trafiają do
+// host::mqttBroker().retained, komendy wstrzykuje się przez inject() –
+// dostarcza je loop() klienta, czyli zadanie "mqtt", jak na urządzeniu.
+#include <Arduino.h>
+#include <WiFi.h>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+
+#define MQTT_CALLBACK_SIGNATURE_ARG std::function<void(char*, uint8_t*, unsigned int)>
+#define MQTT_CALLBACK_SIGNATURE MQTT_CALLBACK_SIGNATURE_ARG callback
+
+namespace host {
+  struct MqttBroker {
+    std::mutex m;
+    bool up = true;            // false = connect() się nie udaje
+    bool failPublish = false;  // true = publish()/endPublish() zwraca false
+    std::map<std::string, std::string> retained;
+    std::deque<std::pair<std::string, std::string>> inbox;
+    uint32_t publishes = 0, bytes = 0, failed = 0;
+
+    void inject(const std::string& topic, const std::string& payload) {
+      std::lock_guard<std::mutex> l(m);
+      inbox.emplace_back(topic, payload);
+    }
+  };
+  inline MqttBroker& mqttBroker() { static MqttBroker* b = new MqttBroker; return *b; }
+}
+
+class PubSubClient {
+  bool conn = false;
+  MQTT_CALLBACK_SIGNATURE;
+  std::string pubTopic, pubPayload;
+  size_t pubLen = 0;
+
+  bool store(const std::string& topic, const std::string& payload) {
+    host::MqttBroker& b = host::mqttBroker();
+    std::lock_guard<std::mutex> l(b.m);
+    if (!conn || b.failPublish) { b.failed++; return false; }
+    b.retained[topic] = payload;
+    b.publishes++;
+    b.bytes += payload.size();
+    return true;
+  }
+
+public:
+  explicit PubSubClient(Client&) {}
+
+  PubSubClient& setServer(const char*, uint16_t) { return *this; }
+  PubSubClient& setCallback(MQTT_CALLBACK_SIGNATURE_ARG cb) { callback = cb; return *this; }
+  bool setBufferSize(uint16_t) { return true; }
+  PubSubClient& setKeepAlive(uint16_t) { return *this; }
+  PubSubClient& setSocketTimeout(uint16_t) { return *this; }
+
+  bool connect(const char*) { return connect(nullptr, nullptr, nullptr); }
+  bool connect(const char*, const char*, const char*) {
+    std::lock_guard<std::mutex> l(host::mqttBroker().m);
+    conn = host::mqttBroker().up;
+    return conn;
+  }
+  void disconnect() { conn = false; }
+  bool connected() {
+    std::lock_guard<std::mutex> l(host::mqttBroker().m);
+    if (!host::mqttBroker().up) conn = false;
+    return conn;
+  }
+  int state() { return conn ? 0 : -1; }
+
+  bool subscribe(const char*, uint8_t = 0) { return conn; }
+  bool unsubscribe(const char*) { return conn; }
+
+  bool publish(const char* topic, const char* payload, bool = false) {
+    return store(topic, payload ? payload : "");
+  }
+  bool publish(const char* topic, const uint8_t* payload, unsigned int len, bool = false) {
+    return store(topic, std::string((const char*)payload, len));
+  }
+
+  bool beginPublish(const char* topic, unsigned int len, bool) {
+    if (!conn) return false;
+    pubTopic = topic;
+    pubPayload.clear();
+    pubLen = len;
+    return true;
+  }
+  size_t write(const uint8_t* buf, size_t n) { pubPayload.append((const char*)buf, n); return n; }
+  size_t write(uint8_t c) { pubPayload += (char)c; return 1; }
+  int endPublish() { return pubPayload.size() == pubLen && store(pubTopic, pubPayload) ? 1 : 0; }
+
+  bool loop() {
+    if (!connected()) return false;
+    for (;;) {
+      std::pair<std::string, std::string> msg;
+      {
+        host::MqttBroker& b = host::mqttBroker();
+        std::lock_guard<std::mutex> l(b.m);
+        if (b.inbox.empty()) break;
+        msg = std::move(b.inbox.front());
+        b.inbox.pop_front();
+      }
+      if (callback) callback(&msg.first[0], (uint8_t*)&msg.second[0], (unsigned int)msg.second.size());
+    }
+    return true;
+  }
+};
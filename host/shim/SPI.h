@@ -0,0 +1,18 @@
+#pragma once
+#include <Arduino.h>
+
+#define SPI_MODE0 0
+
+struct SPISettings {
+  SPISettings(uint32_t, uint8_t, uint8_t) {}
+};
+
+class SPIClass {
+public:
+  uint32_t bytesOut = 0;
+  void begin(int8_t = -1, int8_t = -1, int8_t = -1, int8_t = -1) {}
+  void beginTransaction(SPISettings) {}
+  void transferBytes(const uint8_t*, uint8_t*, uint32_t n) { bytesOut += n; }
+  void endTransaction() {}
+};
+inline SPIClass SPI;
@@ -0,0 +1,53 @@
+#pragma once
+// WiFi na hoście: zawsze "połączone" (albo rozłączone przez host::wifiUp = false)
+#include <Arduino.h>
+
+typedef enum { WL_IDLE_STATUS = 0, WL_NO_SSID_AVAIL = 1, WL_CONNECTED = 3, WL_CONNECT_FAILED = 4, WL_DISCONNECTED = 6 } wl_status_t;
+typedef enum { WIFI_OFF = 0, WIFI_STA = 1, WIFI_AP = 2, WIFI_AP_STA = 3 } wifi_mode_t;
+
+namespace host {
+  inline bool wifiUp = true;
+}
+
+class WiFiClass {
+public:
+  bool mode(wifi_mode_t) { return true; }
+  wl_status_t begin(const char*, const char* = nullptr) { return status(); }
+  wl_status_t status() { return host::wifiUp ? WL_CONNECTED : WL_DISCONNECTED; }
+  bool disconnect(bool = false) { return true; }
+  bool reconnect() { return true; }
+  bool softAP(const char*, const char* = nullptr) { return true; }
+  IPAddress localIP() { return IPAddress(127, 0, 0, 1); }
+  IPAddress softAPIP() { return IPAddress(192, 168, 4, 1); }
+  int8_t RSSI() { return -50; }
+};
+inline WiFiClass WiFi;
+
+// Gniazdo: odpowiedź HTTPClient albo nic (MQTT ma własny zamiennik klienta)
+class Client : public Stream {};
+
+class WiFiClient : public Client {
+protected:
+  std::string rx;
+  size_t rxPos = 0;
+  bool open = false;
+
+public:
+  virtual ~WiFiClient() {}
+  virtual int connect(const char*, uint16_t) { open = true; return 1; }
+  virtual void stop() { open = false; rx.clear(); rxPos = 0; }
+  virtual uint8_t connected() { return open || rxPos < rx.size(); }
+  explicit operator bool() { return connected(); }
+
+  void setTimeout(uint32_t ms) { Stream::setTimeout(ms); }
+
+  int available() override { return (int)(rx.size() - rxPos); }
+  int read() override { return rxPos < rx.size() ? (uint8_t)rx[rxPos++] : -1; }
+  int peek() override { return rxPos < rx.size() ? (uint8_t)rx[rxPos] : -1; }
+  size_t write(uint8_t) override { return open ? 1 : 0; }
+  size_t write(const uint8_t*, size_t n) override { return open ? n : 0; }
+  using Print::write;
+
+  // Dla HTTPClient: treść, którą "przysłał serwer"
+  void feed(const std::string& data) { rx = data; rxPos = 0; }
+};
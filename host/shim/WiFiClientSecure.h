@@ -0,0 +1,10 @@
+#pragma once
+#include <WiFi.h>
+
+class WiFiClientSecure : public WiFiClient {
+public:
+  void setInsecure() {}
+  void setCACert(const char*) {}
+  void setCACertBundle(const uint8_t*) {}
+  void setHandshakeTimeout(unsigned long) {}
+};
@@ -0,0 +1,19 @@
+#pragma once
+// I2C na hoście: każdy adres odpowiada ACK, chyba że jest w host::i2cNack
+#include <Arduino.h>
+#include <set>
+
+namespace host {
+  inline std::set<uint8_t> i2cNack; // adresy "odłączonych" układów
+}
+
+class TwoWire {
+  uint8_t addr = 0;
+
+public:
+  bool begin(int = -1, int = -1, uint32_t = 0) { return true; }
+  void beginTransmission(uint8_t a) { addr = a; }
+  size_t write(uint8_t) { return 1; }
+  uint8_t endTransmission(bool = true) { return host::i2cNack.count(addr) ? 2 : 0; }
+};
+inline TwoWire Wire;
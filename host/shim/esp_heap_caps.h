@@ -0,0 +1,8 @@
+#pragma once
+#include <Arduino.h>
+
+#define MALLOC_CAP_DEFAULT (1 << 12)
+
+inline size_t heap_caps_get_minimum_free_size(uint32_t) { return ESP.getMinFreeHeap(); }
+inline size_t heap_caps_get_free_size(uint32_t) { return ESP.getFreeHeap(); }
+inline size_t heap_caps_get_largest_free_block(uint32_t) { return ESP.getFreeHeap(); }
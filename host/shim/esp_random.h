@@ -0,0 +1,8 @@
+#pragma once
+#include <stdint.h>
+#include <random>
+
+inline uint32_t esp_random() {
+  static std::mt19937 rng{std::random_device{}()};
+  return rng();
+}
@@ -0,0 +1,92 @@
+#pragma once
+// esp_timer na hoście: jeden wątek "esp_timer" woła callbacki jednorazowych
+// timerów po kolei, jak zadanie esp_timer z dispatch_method = ESP_TIMER_TASK.
+#include <stdint.h>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <Arduino.h>
+
+typedef int esp_err_t;
+#define ESP_OK   0
+#define ESP_FAIL (-1)
+#define ESP_ERR_INVALID_STATE 0x103
+
+typedef void (*esp_timer_cb_t)(void* arg);
+typedef enum { ESP_TIMER_TASK, ESP_TIMER_ISR } esp_timer_dispatch_t;
+
+typedef struct {
+  esp_timer_cb_t callback;
+  void* arg;
+  esp_timer_dispatch_t dispatch_method;
+  const char* name;
+  bool skip_unhandled_events;
+} esp_timer_create_args_t;
+
+struct esp_timer {
+  esp_timer_cb_t cb;
+  void* arg;
+  int64_t dueUs = -1; // -1 = nieuzbrojony
+};
+typedef esp_timer* esp_timer_handle_t;
+
+inline int64_t esp_timer_get_time() { return (int64_t)micros(); }
+
+namespace host {
+  struct TimerService {
+    static const int MAX = 64;
+    std::mutex m;
+    std::condition_variable cv;
+    esp_timer* items[MAX] = {nullptr};
+    int count = 0;
+
+    TimerService() { std::thread([this] { run(); }).detach(); }
+
+    void run() {
+      std::unique_lock<std::mutex> l(m);
+      for (;;) {
+        esp_timer* next = nullptr;
+        for (int i = 0; i < count; i++)
+          if (items[i]->dueUs >= 0 && (!next || items[i]->dueUs < next->dueUs)) next = items[i];
+        if (!next) { cv.wait(l); continue; }
+        const int64_t wait = next->dueUs - esp_timer_get_time();
+        if (wait > 0) { cv.wait_for(l, std::chrono::microseconds(wait)); continue; }
+        next->dueUs = -1;
+        esp_timer_cb_t cb = next->cb;
+        void* arg = next->arg;
+        l.unlock();
+        cb(arg);
+        l.lock();
+      }
+    }
+  };
+  inline TimerService& timers() { static TimerService* s = new TimerService; return *s; } // bez destruktora: wątek żyje do końca procesu
+}
+
+inline esp_err_t esp_timer_create(const esp_timer_create_args_t* args, esp_timer_handle_t* out) {
+  host::TimerService& s = host::timers();
+  std::lock_guard<std::mutex> l(s.m);
+  if (s.count >= host::TimerService::MAX) return ESP_FAIL;
+  esp_timer* t = new esp_timer{args->callback, args->arg};
+  s.items[s.count++] = t;
+  *out = t;
+  return ESP_OK;
+}
+
+inline esp_err_t esp_timer_start_once(esp_timer_handle_t t, uint64_t us) {
+  host::TimerService& s = host::timers();
+  std::lock_guard<std::mutex> l(s.m);
+  if (t->dueUs >= 0) return ESP_ERR_INVALID_STATE;
+  t->dueUs = esp_timer_get_time() + (int64_t)us;
+  s.cv.notify_one();
+  return ESP_OK;
+}
+
+inline esp_err_t esp_timer_stop(esp_timer_handle_t t) {
+  host::TimerService& s = host::timers();
+  std::lock_guard<std::mutex> l(s.m);
+  if (t->dueUs < 0) return ESP_ERR_INVALID_STATE;
+  t->dueUs = -1;
+  return ESP_OK;
+}
@@ -0,0 +1,45 @@
+#pragma once
+// FreeRTOS na hoście: zadania to wątki std::thread, 1 tick = 1 ms.
+// Semafory i kolejki na std::mutex + std::condition_variable; sekcja
+// krytyczna (portMUX) to spinlock, jak na dwurdzeniowym ESP32.
+#include <stdint.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+typedef int32_t BaseType_t;
+typedef uint32_t UBaseType_t;
+typedef uint32_t TickType_t;
+
+#define pdTRUE  ((BaseType_t)1)
+#define pdFALSE ((BaseType_t)0)
+#define pdPASS  pdTRUE
+#define pdFAIL  pdFALSE
+#define errQUEUE_FULL ((BaseType_t)0)
+#define portMAX_DELAY ((TickType_t)0xffffffffUL)
+#define portTICK_PERIOD_MS 1
+#define configTICK_RATE_HZ 1000
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+#define tskNO_AFFINITY 0x7fffffff
+
+struct portMUX_TYPE {
+  std::atomic<bool> locked{false};
+};
+#define portMUX_INITIALIZER_UNLOCKED portMUX_TYPE{}
+
+inline void portENTER_CRITICAL(portMUX_TYPE* m) {
+  while (m->locked.exchange(true, std::memory_order_acquire)) std::this_thread::yield();
+}
+inline void portEXIT_CRITICAL(portMUX_TYPE* m) { m->locked.store(false, std::memory_order_release); }
+
+namespace host {
+  // Czekanie z limitem w tickach (portMAX_DELAY = bez limitu)
+  template <typename Lock, typename Pred>
+  inline bool waitTicks(std::condition_variable& cv, Lock& l, TickType_t ticks, Pred ready) {
+    if (ticks == 0) return ready(); // xQueueReceive(q, &x, 0) itp. – bez czekania
+    if (ticks == portMAX_DELAY) { cv.wait(l, ready); return true; }
+    return cv.wait_for(l, std::chrono::milliseconds(ticks), ready);
+  }
+}
@@ -0,0 +1,50 @@
+#pragma once
+#include "FreeRTOS.h"
+#include <string.h>
+#include <deque>
+#include <vector>
+
+// Kolejka kopiuje elementy po wartości, jak xQueueSend w FreeRTOS
+struct HostQueue {
+  std::mutex m;
+  std::condition_variable cv;
+  std::deque<std::vector<uint8_t>> items;
+  UBaseType_t length;
+  UBaseType_t itemSize;
+};
+typedef HostQueue* QueueHandle_t;
+
+inline QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize) {
+  HostQueue* q = new HostQueue();
+  q->length = length;
+  q->itemSize = itemSize;
+  return q;
+}
+
+inline BaseType_t xQueueSend(QueueHandle_t q, const void* item, TickType_t ticks) {
+  {
+    std::unique_lock<std::mutex> l(q->m);
+    if (!host::waitTicks(q->cv, l, ticks, [q] { return q->items.size() < q->length; })) return errQUEUE_FULL;
+    const uint8_t* p = (const uint8_t*)item;
+    q->items.emplace_back(p, p + q->itemSize);
+  }
+  q->cv.notify_all();
+  return pdTRUE;
+}
+#define xQueueSendToBack xQueueSend
+
+inline BaseType_t xQueueReceive(QueueHandle_t q, void* out, TickType_t ticks) {
+  {
+    std::unique_lock<std::mutex> l(q->m);
+    if (!host::waitTicks(q->cv, l, ticks, [q] { return !q->items.empty(); })) return pdFALSE;
+    memcpy(out, q->items.front().data(), q->itemSize);
+    q->items.pop_front();
+  }
+  q->cv.notify_all();
+  return pdTRUE;
+}
+
+inline UBaseType_t uxQueueMessagesWaiting(QueueHandle_t q) {
+  std::lock_guard<std::mutex> l(q->m);
+  return (UBaseType_t)q->items.size();
+}
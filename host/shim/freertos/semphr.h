@@ -0,0 +1,56 @@
+#pragma once
+#include "FreeRTOS.h"
+
+// Mutex jak w FreeRTOS może oddać inne zadanie niż to, które go wzięło
+// (HttpsPool::Lease), więc to semafor binarny, nie std::mutex.
+struct HostSemaphore {
+  std::mutex m;
+  std::condition_variable cv;
+  bool recursive = false;
+  int count = 1;             // 1 = wolny
+  std::thread::id owner;     // tylko rekurencyjny
+  int depth = 0;
+};
+typedef HostSemaphore* SemaphoreHandle_t;
+
+inline SemaphoreHandle_t xSemaphoreCreateMutex() { return new HostSemaphore(); }
+inline SemaphoreHandle_t xSemaphoreCreateBinary() { HostSemaphore* s = new HostSemaphore(); s->count = 0; return s; }
+inline SemaphoreHandle_t xSemaphoreCreateRecursiveMutex() { HostSemaphore* s = new HostSemaphore(); s->recursive = true; return s; }
+inline void vSemaphoreDelete(SemaphoreHandle_t s) { delete s; }
+
+inline BaseType_t xSemaphoreTake(SemaphoreHandle_t s, TickType_t ticks) {
+  std::unique_lock<std::mutex> l(s->m);
+  if (!host::waitTicks(s->cv, l, ticks, [s] { return s->count > 0; })) return pdFALSE;
+  s->count--;
+  return pdTRUE;
+}
+
+inline BaseType_t xSemaphoreGive(SemaphoreHandle_t s) {
+  {
+    std::lock_guard<std::mutex> l(s->m);
+    if (s->count > 0) return pdFALSE;
+    s->count++;
+  }
+  s->cv.notify_one();
+  return pdTRUE;
+}
+
+inline BaseType_t xSemaphoreTakeRecursive(SemaphoreHandle_t s, TickType_t ticks) {
+  const std::thread::id me = std::this_thread::get_id();
+  std::unique_lock<std::mutex> l(s->m);
+  if (s->depth > 0 && s->owner == me) { s->depth++; return pdTRUE; }
+  if (!host::waitTicks(s->cv, l, ticks, [s] { return s->depth == 0; })) return pdFALSE;
+  s->owner = me;
+  s->depth = 1;
+  return pdTRUE;
+}
+
+inline BaseType_t xSemaphoreGiveRecursive(SemaphoreHandle_t s) {
+  {
+    std::lock_guard<std::mutex> l(s->m);
+    if (s->depth == 0 || s->owner != std::this_thread::get_id()) return pdFALSE;
+    if (--s->depth > 0) return pdTRUE;
+  }
+  s->cv.notify_one();
+  return pdTRUE;
+}
@@ -0,0 +1,62 @@
+#pragma once
+#include "FreeRTOS.h"
+
+typedef void (*TaskFunction_t)(void*);
+
+struct HostTask {
+  std::mutex m;
+  std::condition_variable cv;
+  uint32_t notify = 0;
+  const char* name;
+};
+typedef HostTask* TaskHandle_t;
+
+namespace host {
+  inline thread_local HostTask* currentTask = nullptr;
+  // Pętla główna (loopTask) też jest zadaniem – może czekać na powiadomienie
+  inline HostTask* selfTask() {
+    if (!currentTask) currentTask = new HostTask{{}, {}, 0, "loopTask"};
+    return currentTask;
+  }
+}
+
+inline BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char* name, uint32_t, void* arg,
+                                          UBaseType_t, TaskHandle_t* out, BaseType_t) {
+  HostTask* t = new HostTask{{}, {}, 0, name};
+  if (out) *out = t;
+  std::thread([t, fn, arg] {
+    host::currentTask = t;
+    fn(arg);
+  }).detach();
+  return pdPASS;
+}
+inline BaseType_t xTaskCreate(TaskFunction_t fn, const char* name, uint32_t stack, void* arg,
+                              UBaseType_t prio, TaskHandle_t* out) {
+  return xTaskCreatePinnedToCore(fn, name, stack, arg, prio, out, tskNO_AFFINITY);
+}
+
+inline void vTaskDelay(TickType_t ticks) { std::this_thread::sleep_for(std::chrono::milliseconds(ticks)); }
+inline void vTaskDelete(TaskHandle_t) {} // zadania na hoście kończą się razem z procesem
+inline TaskHandle_t xTaskGetCurrentTaskHandle() { return host::selfTask(); }
+inline TickType_t xTaskGetTickCount() {
+  static const auto t0 = std::chrono::steady_clock::now();
+  return (TickType_t)std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - t0).count();
+}
+
+inline BaseType_t xTaskNotifyGive(TaskHandle_t t) {
+  {
+    std::lock_guard<std::mutex> l(t->m);
+    t->notify++;
+  }
+  t->cv.notify_one();
+  return pdPASS;
+}
+
+inline uint32_t ulTaskNotifyTake(BaseType_t clearOnExit, TickType_t ticks) {
+  HostTask* t = host::selfTask();
+  std::unique_lock<std::mutex> l(t->m);
+  host::waitTicks(t->cv, l, ticks, [t] { return t->notify > 0; });
+  const uint32_t v = t->notify;
+  if (v) t->notify = clearOnExit ? 0 : v - 1;
+  return v;
+}
@@ -0,0 +1,105 @@
+// Podmiana malloc/free glibc z licznikami (host_heap.h). Własne symbole
+// w pliku wykonywalnym mają pierwszeństwo przed libc, a do właściwej
+// alokacji wołamy __libc_*. Poza glibc liczniki zostają zerowe.
+#include "host_heap.h"
+#include <atomic>
+
+#if defined(__GLIBC__)
+#include <errno.h>
+#include <malloc.h>
+
+extern "C" {
+void* __libc_malloc(size_t);
+void* __libc_calloc(size_t, size_t);
+void* __libc_realloc(void*, size_t);
+void  __libc_free(void*);
+void* __libc_memalign(size_t, size_t);
+}
+
+namespace {
+std::atomic<uint64_t> allocs{0};
+std::atomic<int64_t>  live{0};
+std::atomic<int64_t>  peak{0};
+thread_local uint64_t threadAllocs = 0; // statyczny TLS pliku wykonywalnego – bez malloc
+
+void onAlloc(void* p) {
+  if (!p) return;
+  allocs.fetch_add(1, std::memory_order_relaxed);
+  threadAllocs++;
+  const int64_t n = (int64_t)malloc_usable_size(p);
+  const int64_t now = live.fetch_add(n, std::memory_order_relaxed) + n;
+  int64_t pk = peak.load(std::memory_order_relaxed);
+  while (now > pk && !peak.compare_exchange_weak(pk, now, std::memory_order_relaxed)) {}
+}
+
+void onFree(void* p) {
+  if (p) live.fetch_sub((int64_t)malloc_usable_size(p), std::memory_order_relaxed);
+}
+} // namespace
+
+extern "C" {
+void* malloc(size_t n) {
+  void* p = __libc_malloc(n);
+  onAlloc(p);
+  return p;
+}
+
+void* calloc(size_t c, size_t n) {
+  void* p = __libc_calloc(c, n);
+  onAlloc(p);
+  return p;
+}
+
+void* realloc(void* old, size_t n) {
+  const int64_t was = old ? (int64_t)malloc_usable_size(old) : 0;
+  void* p = __libc_realloc(old, n);
+  if (p) {
+    live.fetch_sub(was, std::memory_order_relaxed);
+    onAlloc(p);
+  } else if (old && n == 0) {
+    live.fetch_sub(was, std::memory_order_relaxed); // realloc(p, 0) zwalnia
+  }
+  return p;
+}
+
+void free(void* p) {
+  onFree(p);
+  __libc_free(p);
+}
+
+void* memalign(size_t align, size_t n) {
+  void* p = __libc_memalign(align, n);
+  onAlloc(p);
+  return p;
+}
+
+void* aligned_alloc(size_t align, size_t n) { return memalign(align, n); }
+
+int posix_memalign(void** out, size_t align, size_t n) {
+  if (align < sizeof(void*) || (align & (align - 1))) return EINVAL;
+  void* p = memalign(align, n);
+  if (!p) return ENOMEM;
+  *out = p;
+  return 0;
+}
+} // extern "C"
+
+namespace host {
+HeapStats heapStats() {
+  return { allocs.load(std::memory_order_relaxed), live.load(std::memory_order_relaxed),
+           peak.load(std::memory_order_relaxed) };
+}
+
+void heapResetPeak() { peak.store(live.load(std::memory_order_relaxed), std::memory_order_relaxed); }
+uint64_t heapThreadAllocs() { return threadAllocs; }
+} // namespace host
+
+#else
+
+namespace host {
+HeapStats heapStats() { return { 0, 0, 0 }; }
+void heapResetPeak() {}
+uint64_t heapThreadAllocs() { return 0; }
+} // namespace host
+
+#endif
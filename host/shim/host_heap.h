@@ -0,0 +1,18 @@
+#pragma once
+// Liczniki sterty na hoście (host_heap.cpp): każdy malloc/free procesu –
+// a przez nie new/delete, String i JsonDocument – przechodzi przez liczniki.
+// Odpowiednik statystyk heap_caps na ESP32 dla benchmarków.
+#include <stddef.h>
+#include <stdint.h>
+
+namespace host {
+  struct HeapStats {
+    uint64_t allocs; // malloc/calloc/realloc od startu procesu
+    int64_t  live;   // zajęte bajty (malloc_usable_size)
+    int64_t  peak;   // maksimum live od ostatniego heapResetPeak()
+  };
+
+  HeapStats heapStats();
+  void heapResetPeak(); // peak = bieżące live
+  uint64_t heapThreadAllocs(); // alokacje wykonane przez bieżący wątek
+}
@@ -0,0 +1,48 @@
+#pragma once
+// Dostęp testów do prywatnych funkcji pomocniczych modułów z src/.
+// Klasy deklarują `friend struct HostTest;` – jedna definicja dla wszystkich
+// plików testów (ODR), więc każdy test dołącza ten nagłówek.
+#include <Arduino.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "Programs.h"
+#include "LoopStats.h"
+#include "MQTTClient.h"
+
+struct HostTest {
+  // Strefa jak na urządzeniu (Config: Europe/Warsaw)
+  static void warsawTz() {
+    setenv("TZ", "CET-1CEST,M3.5.0,M10.5.0/3", 1);
+    tzset();
+  }
+
+  // Czas lokalny -> time_t (DST rozstrzyga mktime)
+  static time_t local(int y, int mon, int d, int h, int mi, int s = 0) {
+    struct tm t = {};
+    t.tm_year = y - 1900; t.tm_mon = mon - 1; t.tm_mday = d;
+    t.tm_hour = h; t.tm_min = mi; t.tm_sec = s;
+    t.tm_isdst = -1;
+    return mktime(&t);
+  }
+
+  // --- Programs ---
+  static uint16_t parseTime(const char* s) { return Programs::parseTime(s); }
+  static time_t nextFire(const Program& p, time_t from) { return Programs::nextFire(p, from); }
+
+  // --- LoopStats ---
+  static constexpr int BUCKETS = LoopStats::BUCKETS;
+  static int bucketOf(uint32_t us) { return LoopStats::bucketOf(us); }
+  static uint32_t bucketUpper(int b) { return LoopStats::bucketUpper(b); }
+  static void record(LoopStats& ls, uint32_t us) { ls.record(ls.total, us); }
+  static uint32_t percentile(const LoopStats& ls, float p) { return LoopStats::percentile(ls.total, p); }
+
+  // --- MQTTClient ---
+  static bool matchRoute(const char* pattern, const char* topic, int& arg) {
+    return MQTTClient::matchRoute(pattern, topic, arg);
+  }
+  static bool parseInt(const char* s, int& out) { return parseInt(s, strlen(s), out); }
+  static bool parseInt(const char* s, unsigned len, int& out) {
+    return MQTTClient::parseIntSafe((const byte*)s, len, out);
+  }
+};
@@ -0,0 +1,147 @@
+// ChartWriter: downsampling LTTB/MINMAX i składanie JSON porcjami.
+#include <gtest/gtest.h>
+#include <math.h>
+#include <string>
+#include <vector>
+#include "Chart.h"
+
+namespace {
+
+const uint32_t T0 = 1718000000;
+const uint32_t STEP = 3600;
+
+// Seria w pamięci; NAN = luka
+class VecSource : public ChartSource {
+public:
+  explicit VecSource(std::vector<float> v) : vals(std::move(v)) {}
+  int32_t count() override { return (int32_t)vals.size(); }
+  bool at(int32_t i, uint32_t& t, float& v) override {
+    if (i < 0 || i >= (int32_t)vals.size() || isnan(vals[i])) return false;
+    t = T0 + (uint32_t)i * STEP;
+    v = vals[i];
+    return true;
+  }
+private:
+  std::vector<float> vals;
+};
+
+struct Point {
+  int32_t idx;
+  float v;
+};
+
+struct Chart {
+  std::string json;
+  std::string mode;
+  std::vector<Point> points;
+};
+
+// Całą odpowiedź składamy małymi porcjami, jak AsyncWebServer przy wolnym kliencie
+Chart render(std::vector<float> vals, ChartWriter::Mode mode, int32_t points, size_t chunk = 7) {
+  ChartWriter w(new VecSource(std::move(vals)), mode, points, "{\"metric\":\"rain\"");
+  Chart c;
+  std::vector<uint8_t> buf(chunk);
+  size_t n;
+  while ((n = w.fill(buf.data(), buf.size())) > 0) c.json.append((const char*)buf.data(), n);
+
+  const size_t m = c.json.find("\"mode\":\"");
+  if (m != std::string::npos) c.mode = c.json.substr(m + 8, c.json.find('"', m + 8) - m - 8);
+  size_t p = c.json.find("\"points\":[");
+  if (p == std::string::npos) return c;
+  p += 10;
+  unsigned long t; float v; int len;
+  while (sscanf(c.json.c_str() + p, "[%lu,%f]%n", &t, &v, &len) == 2) {
+    c.points.push_back({ (int32_t)((t - T0) / STEP), v });
+    p += len;
+    if (c.json[p] == ',') p++;
+  }
+  return c;
+}
+
+std::vector<float> wave(int n) {
+  std::vector<float> v(n);
+  for (int i = 0; i < n; i++) v[i] = 10.0f + 5.0f * sinf(i * 0.05f);
+  return v;
+}
+
+bool hasIdx(const Chart& c, int32_t idx) {
+  for (const Point& p : c.points) if (p.idx == idx) return true;
+  return false;
+}
+
+void expectIncreasing(const Chart& c) {
+  for (size_t i = 1; i < c.points.size(); i++) EXPECT_LT(c.points[i - 1].idx, c.points[i].idx) << i;
+}
+
+TEST(ChartWriter, EmptySeries) {
+  const Chart c = render({}, ChartWriter::LTTB, 100);
+  EXPECT_EQ(c.json, "{\"metric\":\"rain\",\"mode\":\"raw\",\"points\":[]}");
+}
+
+TEST(ChartWriter, ShortSeriesGoesRaw) {
+  const Chart c = render({ 1.0f, NAN, 2.5f, 3.25f }, ChartWriter::LTTB, 10);
+  EXPECT_EQ(c.mode, "raw");
+  EXPECT_EQ(c.json, "{\"metric\":\"rain\",\"mode\":\"raw\",\"points\":[[1718000000,1.00],[1718007200,2.50],[1718010800,3.25]]}");
+}
+
+TEST(ChartWriter, TrimsLeadingAndTrailingGaps) {
+  std::vector<float> v(500, NAN);
+  for (int i = 100; i < 400; i++) v[i] = (float)i;
+  const Chart c = render(v, ChartWriter::LTTB, 50);
+  EXPECT_EQ(c.mode, "lttb");
+  ASSERT_FALSE(c.points.empty());
+  EXPECT_EQ(c.points.front().idx, 100);
+  EXPECT_EQ(c.points.back().idx, 399);
+}
+
+TEST(ChartWriter, LttbKeepsEndpointsAndPointCount) {
+  const Chart c = render(wave(1000), ChartWriter::LTTB, 50);
+  EXPECT_EQ(c.mode, "lttb");
+  ASSERT_EQ(c.points.size(), 50u);
+  EXPECT_EQ(c.points.front().idx, 0);
+  EXPECT_EQ(c.points.back().idx, 999);
+  expectIncreasing(c);
+}
+
+TEST(ChartWriter, LttbKeepsSpike) {
+  std::vector<float> v = wave(2000);
+  v[1234] = 100.0f;
+  const Chart c = render(v, ChartWriter::LTTB, 80);
+  EXPECT_TRUE(hasIdx(c, 1234));
+  EXPECT_LE(c.points.size(), 80u);
+}
+
+TEST(ChartWriter, LttbSkipsGapsInside) {
+  std::vector<float> v = wave(1000);
+  for (int i = 300; i < 600; i++) v[i] = NAN;
+  const Chart c = render(v, ChartWriter::LTTB, 40);
+  for (const Point& p : c.points) EXPECT_TRUE(p.idx < 300 || p.idx >= 600) << p.idx;
+  EXPECT_LT(c.points.size(), 40u); // puste kubełki nic nie wydają
+  expectIncreasing(c);
+}
+
+TEST(ChartWriter, MinMaxKeepsExtremesOfEveryBucket) {
+  std::vector<float> v(1000, 0.0f);
+  v[17] = 4.0f;   // pojedyncze opady – LTTB mógłby je wygładzić
+  v[503] = 12.5f;
+  v[998] = -1.0f;
+  const Chart c = render(v, ChartWriter::MINMAX, 40);
+  EXPECT_EQ(c.mode, "minmax");
+  EXPECT_LE(c.points.size(), 40u);
+  EXPECT_TRUE(hasIdx(c, 17));
+  EXPECT_TRUE(hasIdx(c, 503));
+  EXPECT_TRUE(hasIdx(c, 998));
+  expectIncreasing(c);
+  float maxV = -1e9f;
+  for (const Point& p : c.points) maxV = fmaxf(maxV, p.v);
+  EXPECT_FLOAT_EQ(maxV, 12.5f);
+}
+
+TEST(ChartWriter, OutputDoesNotDependOnChunkSize) {
+  const std::vector<float> v = wave(3000);
+  const Chart small = render(v, ChartWriter::LTTB, 120, 1);
+  const Chart large = render(v, ChartWriter::LTTB, 120, 4096);
+  EXPECT_EQ(small.json, large.json);
+}
+
+} // namespace
@@ -0,0 +1,94 @@
+// LoopStats: kubełki histogramu (2 na oktawę) i percentyle.
+#include <gtest/gtest.h>
+#include "HostTest.h"
+
+namespace {
+
+TEST(LoopStatsBuckets, SmallValues) {
+  EXPECT_EQ(HostTest::bucketOf(0), 0);
+  EXPECT_EQ(HostTest::bucketOf(1), 1);
+  EXPECT_EQ(HostTest::bucketOf(2), 3);
+  EXPECT_EQ(HostTest::bucketOf(3), 4);
+  EXPECT_EQ(HostTest::bucketOf(4), 5);
+  EXPECT_EQ(HostTest::bucketOf(5), 5);
+  EXPECT_EQ(HostTest::bucketOf(6), 6);
+  EXPECT_EQ(HostTest::bucketOf(7), 6);
+  EXPECT_EQ(HostTest::bucketOf(8), 7);
+  EXPECT_EQ(HostTest::bucketUpper(0), 0u);
+  EXPECT_EQ(HostTest::bucketUpper(1), 1u);
+  EXPECT_EQ(HostTest::bucketUpper(5), 5u);
+  EXPECT_EQ(HostTest::bucketUpper(6), 7u);
+}
+
+TEST(LoopStatsBuckets, LargeValuesSaturate) {
+  EXPECT_EQ(HostTest::bucketOf(UINT32_MAX), HostTest::BUCKETS - 1);
+  EXPECT_EQ(HostTest::bucketOf(1u << 30), HostTest::BUCKETS - 1);
+  EXPECT_LT(HostTest::bucketOf(8u * 1000 * 1000), HostTest::BUCKETS - 1); // 8 s jeszcze w skali
+}
+
+// Każda wartość leży w swoim kubełku, górna granica zawyża najwyżej o połowę oktawy
+TEST(LoopStatsBuckets, UpperBoundCoversValue) {
+  int prev = 0;
+  for (uint32_t us = 1; us < (1u << 23); us += 1 + us / 64) {
+    const int b = HostTest::bucketOf(us);
+    ASSERT_GE(b, prev) << us;
+    ASSERT_GE(HostTest::bucketUpper(b), us) << us;
+    ASSERT_LT(HostTest::bucketUpper(b), us + us / 2 + 1) << us;
+    prev = b;
+  }
+}
+
+TEST(LoopStatsPercentile, EmptyIsZero) {
+  LoopStats ls;
+  EXPECT_EQ(HostTest::percentile(ls, 0.5f), 0u);
+  EXPECT_EQ(HostTest::percentile(ls, 0.99f), 0u);
+}
+
+TEST(LoopStatsPercentile, UniformSamples) {
+  LoopStats ls;
+  for (uint32_t us = 1; us <= 1000; us++) HostTest::record(ls, us);
+  const uint32_t p50 = HostTest::percentile(ls, 0.50f);
+  const uint32_t p90 = HostTest::percentile(ls, 0.90f);
+  const uint32_t p99 = HostTest::percentile(ls, 0.99f);
+  EXPECT_GE(p50, 500u);
+  EXPECT_LE(p50, 750u);
+  EXPECT_GE(p90, 900u);
+  EXPECT_LE(p99, 1000u); // nie ponad maksimum
+  EXPECT_LE(p50, p90);
+  EXPECT_LE(p90, p99);
+  EXPECT_EQ(HostTest::percentile(ls, 1.0f), 1000u);
+}
+
+TEST(LoopStatsPercentile, TailSpikeShowsInP99) {
+  LoopStats ls;
+  for (int i = 0; i < 990; i++) HostTest::record(ls, 10);
+  for (int i = 0; i < 10; i++) HostTest::record(ls, 50000);
+  EXPECT_LE(HostTest::percentile(ls, 0.50f), 11u);
+  EXPECT_EQ(HostTest::percentile(ls, 0.999f), 50000u);
+}
+
+TEST(LoopStatsJson, ReportsRecordedIterations) {
+  LoopStats ls;
+  for (int i = 0; i < 3; i++) {
+    ls.beginIteration();
+    ls.mark(LoopStats::WIFI);
+    ls.mark(LoopStats::MQTT);
+    ls.endIteration();
+  }
+  JsonDocument doc;
+  ls.toJson(doc);
+  EXPECT_EQ(doc["loop"]["count"].as<uint32_t>(), 3u);
+  EXPECT_EQ(doc["stages"]["wifi"]["count"].as<uint32_t>(), 3u);
+  EXPECT_EQ(doc["stages"]["mqtt"]["count"].as<uint32_t>(), 3u);
+  EXPECT_EQ(doc["stages"]["zones"]["count"].as<uint32_t>(), 0u);
+
+  ls.reset(); // kasowanie wykonuje dopiero następna iteracja
+  ls.beginIteration();
+  ls.endIteration();
+  JsonDocument after;
+  ls.toJson(after);
+  EXPECT_EQ(after["loop"]["count"].as<uint32_t>(), 1u);
+  EXPECT_EQ(after["stages"]["wifi"]["count"].as<uint32_t>(), 0u);
+}
+
+} // namespace
@@ -0,0 +1,89 @@
+// MQTTClient: dopasowanie tematów komend (matchRoute) i liczby z payloadu (parseIntSafe).
+#include <gtest/gtest.h>
+#include "HostTest.h"
+
+volatile uint32_t heapAllocCount = 0; // w firmware z main.cpp
+
+namespace {
+
+TEST(MqttMatchRoute, ExactTopics) {
+  int arg = 7;
+  EXPECT_TRUE(HostTest::matchRoute("logs/clear", "logs/clear", arg));
+  EXPECT_EQ(arg, -1);
+  EXPECT_FALSE(HostTest::matchRoute("logs/clear", "logs/clea", arg));
+  EXPECT_FALSE(HostTest::matchRoute("logs/clear", "logs/clear/now", arg));
+  EXPECT_FALSE(HostTest::matchRoute("logs/clear", "", arg));
+}
+
+TEST(MqttMatchRoute, NumericWildcard) {
+  int arg = -1;
+  EXPECT_TRUE(HostTest::matchRoute("zones/+/start", "zones/0/start", arg));
+  EXPECT_EQ(arg, 0);
+  EXPECT_TRUE(HostTest::matchRoute("zones/+/start", "zones/12/start", arg));
+  EXPECT_EQ(arg, 12);
+  EXPECT_TRUE(HostTest::matchRoute("zones/+/start", "zones/999999/start", arg));
+  EXPECT_EQ(arg, 999999);
+  EXPECT_TRUE(HostTest::matchRoute("programs/edit/+", "programs/edit/5", arg));
+  EXPECT_EQ(arg, 5);
+}
+
+TEST(MqttMatchRoute, RejectsMalformedArgument) {
+  int arg;
+  EXPECT_FALSE(HostTest::matchRoute("zones/+/start", "zones//start", arg));
+  EXPECT_FALSE(HostTest::matchRoute("zones/+/start", "zones/a/start", arg));
+  EXPECT_FALSE(HostTest::matchRoute("zones/+/start", "zones/12x/start", arg));
+  EXPECT_FALSE(HostTest::matchRoute("zones/+/start", "zones/-1/start", arg));
+  EXPECT_FALSE(HostTest::matchRoute("zones/+/start", "zones/1234567/start", arg)); // najwyżej 6 cyfr
+  EXPECT_FALSE(HostTest::matchRoute("programs/edit/+", "programs/edit/", arg));
+}
+
+TEST(MqttMatchRoute, RejectsWrongSuffix) {
+  int arg;
+  EXPECT_FALSE(HostTest::matchRoute("zones/+/start", "zones/1/stop", arg));
+  EXPECT_FALSE(HostTest::matchRoute("zones/+/start", "zones/1/sta", arg));
+  EXPECT_FALSE(HostTest::matchRoute("zones/+/start", "zones/1/start/x", arg));
+  EXPECT_FALSE(HostTest::matchRoute("zones/+/start", "zones/1", arg));
+  EXPECT_FALSE(HostTest::matchRoute("programs/delete/+", "programs/delete/3/x", arg));
+}
+
+TEST(MqttParseInt, AcceptsSignedDecimal) {
+  int v = 0;
+  EXPECT_TRUE(HostTest::parseInt("42", v));
+  EXPECT_EQ(v, 42);
+  EXPECT_TRUE(HostTest::parseInt("0", v));
+  EXPECT_EQ(v, 0);
+  EXPECT_TRUE(HostTest::parseInt("-7", v));
+  EXPECT_EQ(v, -7);
+  EXPECT_TRUE(HostTest::parseInt("007", v));
+  EXPECT_EQ(v, 7);
+  EXPECT_TRUE(HostTest::parseInt("123456789", v));
+  EXPECT_EQ(v, 123456789);
+  EXPECT_TRUE(HostTest::parseInt("-12345678", v));
+  EXPECT_EQ(v, -12345678);
+}
+
+TEST(MqttParseInt, RejectsGarbageAndLeavesOutUntouched) {
+  int v = 55;
+  EXPECT_FALSE(HostTest::parseInt("", v));
+  EXPECT_FALSE(HostTest::parseInt("-", v));
+  EXPECT_FALSE(HostTest::parseInt("+5", v));
+  EXPECT_FALSE(HostTest::parseInt(" 5", v));
+  EXPECT_FALSE(HostTest::parseInt("5 ", v));
+  EXPECT_FALSE(HostTest::parseInt("4a", v));
+  EXPECT_FALSE(HostTest::parseInt("1.5", v));
+  EXPECT_FALSE(HostTest::parseInt("--1", v));
+  EXPECT_FALSE(HostTest::parseInt("1234567890", v)); // ponad 9 znaków – bez przepełnienia int
+  EXPECT_EQ(v, 55);
+}
+
+// Payload MQTT nie jest zakończony zerem – liczy się tylko length
+TEST(MqttParseInt, UsesPayloadLengthOnly) {
+  int v = 0;
+  EXPECT_TRUE(HostTest::parseInt("12345", 2, v));
+  EXPECT_EQ(v, 12);
+  EXPECT_TRUE(HostTest::parseInt("3}garbage", 1, v));
+  EXPECT_EQ(v, 3);
+  EXPECT_FALSE(HostTest::parseInt("-9", 1, v));
+}
+
+} // namespace
@@ -0,0 +1,95 @@
+// Programs: godzina startu z "HH:MM" i najbliższe uruchomienie (nextFire).
+#include <gtest/gtest.h>
+#include "HostTest.h"
+
+namespace {
+
+class NextFire : public ::testing::Test {
+protected:
+  void SetUp() override { HostTest::warsawTz(); }
+
+  static Program daily(int h, int m, uint8_t days = 0x7F) {
+    Program p;
+    p.start = h * 60 + m;
+    p.days = days;
+    p.active = true;
+    return p;
+  }
+};
+
+TEST(ProgramsParseTime, ParsesAndClamps) {
+  EXPECT_EQ(HostTest::parseTime("07:30"), 7 * 60 + 30);
+  EXPECT_EQ(HostTest::parseTime("00:00"), 0);
+  EXPECT_EQ(HostTest::parseTime("23:59"), 23 * 60 + 59);
+  EXPECT_EQ(HostTest::parseTime("5"), 5 * 60);
+  EXPECT_EQ(HostTest::parseTime("25:99"), 23 * 60 + 59);
+  EXPECT_EQ(HostTest::parseTime("-3:10"), 10);
+  EXPECT_EQ(HostTest::parseTime("xx"), 6 * 60);
+  EXPECT_EQ(HostTest::parseTime(nullptr), 6 * 60);
+}
+
+TEST_F(NextFire, LaterTheSameDay) {
+  const Program p = daily(6, 0);
+  EXPECT_EQ(HostTest::nextFire(p, HostTest::local(2024, 6, 10, 5, 0)), HostTest::local(2024, 6, 10, 6, 0));
+}
+
+TEST_F(NextFire, FromIsInclusive) {
+  const Program p = daily(6, 0);
+  const time_t at = HostTest::local(2024, 6, 10, 6, 0);
+  EXPECT_EQ(HostTest::nextFire(p, at), at);
+  EXPECT_EQ(HostTest::nextFire(p, at + 1), HostTest::local(2024, 6, 11, 6, 0));
+}
+
+TEST_F(NextFire, HonoursDayMask) {
+  // 2024-06-10 to poniedziałek; tylko niedziela (bit 0)
+  const Program sun = daily(6, 0, 1 << 0);
+  EXPECT_EQ(HostTest::nextFire(sun, HostTest::local(2024, 6, 10, 7, 0)), HostTest::local(2024, 6, 16, 6, 0));
+  // Tylko poniedziałek, już po godzinie startu -> za tydzień
+  const Program mon = daily(6, 0, 1 << 1);
+  EXPECT_EQ(HostTest::nextFire(mon, HostTest::local(2024, 6, 10, 7, 0)), HostTest::local(2024, 6, 17, 6, 0));
+  // Środa i piątek
+  const Program wedFri = daily(21, 15, (1 << 3) | (1 << 5));
+  EXPECT_EQ(HostTest::nextFire(wedFri, HostTest::local(2024, 6, 12, 21, 16)), HostTest::local(2024, 6, 14, 21, 15));
+}
+
+TEST_F(NextFire, CrossesMonthAndYear) {
+  const Program p = daily(5, 30);
+  EXPECT_EQ(HostTest::nextFire(p, HostTest::local(2024, 12, 31, 23, 0)), HostTest::local(2025, 1, 1, 5, 30));
+  EXPECT_EQ(HostTest::nextFire(p, HostTest::local(2024, 2, 28, 6, 0)), HostTest::local(2024, 2, 29, 5, 30));
+}
+
+TEST_F(NextFire, InactiveOrNoDaysNeverFires) {
+  Program p = daily(6, 0);
+  p.active = false;
+  EXPECT_EQ(HostTest::nextFire(p, HostTest::local(2024, 6, 10, 5, 0)), 0);
+  p = daily(6, 0, 0);
+  EXPECT_EQ(HostTest::nextFire(p, HostTest::local(2024, 6, 10, 5, 0)), 0);
+}
+
+TEST_F(NextFire, DstChangesKeepWallClockTime) {
+  const Program p = daily(6, 0);
+  // Zmiana na czas letni 31.03.2024: doba ma 23 h
+  const time_t before = HostTest::nextFire(p, HostTest::local(2024, 3, 30, 7, 0));
+  EXPECT_EQ(before, HostTest::local(2024, 3, 31, 6, 0));
+  EXPECT_EQ(before - HostTest::nextFire(p, HostTest::local(2024, 3, 30, 5, 0)), 23 * 3600);
+  // Zmiana na czas zimowy 27.10.2024: doba ma 25 h
+  const time_t a = HostTest::nextFire(p, HostTest::local(2024, 10, 26, 5, 0));
+  const time_t b = HostTest::nextFire(p, a + 60);
+  EXPECT_EQ(b - a, 25 * 3600);
+  struct tm t;
+  localtime_r(&b, &t);
+  EXPECT_EQ(t.tm_hour, 6);
+  EXPECT_EQ(t.tm_min, 0);
+}
+
+TEST_F(NextFire, NonexistentLocalTimeStillFiresThatDay) {
+  // 02:30 nie istnieje 31.03.2024 – start tego dnia, zaraz po przestawieniu zegara
+  const Program p = daily(2, 30);
+  const time_t from = HostTest::local(2024, 3, 31, 0, 0);
+  const time_t at = HostTest::nextFire(p, from);
+  EXPECT_GT(at, from);
+  EXPECT_LT(at, HostTest::local(2024, 3, 31, 4, 0));
+  EXPECT_EQ(HostTest::nextFire(p, at + 60), HostTest::local(2024, 4, 1, 2, 30));
+}
+
+} // namespace
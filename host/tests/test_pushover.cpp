@@ -0,0 +1,155 @@
+// PushoverClient: kolejka o stałym rozmiarze, liczniki i przycinanie pól (transport podmieniony przez setTransport).
+#include <gtest/gtest.h>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include "PushoverClient.h"
+
+namespace {
+
+const int QUEUE_LEN = 8;
+const size_t CRED_MAX = 48;
+const size_t TEXT_MAX = 256;
+
+// Transport testowy: zapamiętuje ostatnią wiadomość, zwraca zadany kod
+// i na życzenie wstrzymuje zadanie wysyłki, żeby kolejka mogła się zapełnić.
+struct MockTransport {
+  std::mutex m;
+  std::condition_variable cv;
+  int code = 200;
+  bool hold = false;
+  int calls = 0;
+  std::string token, user, text;
+
+  static int send(const char* token, const char* user, const char* msg, void* ctx) {
+    MockTransport* self = static_cast<MockTransport*>(ctx);
+    std::unique_lock<std::mutex> l(self->m);
+    self->token = token;
+    self->user = user;
+    self->text = msg;
+    self->calls++;
+    self->cv.notify_all();
+    self->cv.wait(l, [self] { return !self->hold; });
+    return self->code;
+  }
+
+  bool waitCalls(int n) {
+    std::unique_lock<std::mutex> l(m);
+    return cv.wait_for(l, std::chrono::seconds(5), [&] { return calls >= n; });
+  }
+
+  void release() {
+    { std::lock_guard<std::mutex> l(m); hold = false; }
+    cv.notify_all();
+  }
+};
+
+void configure(Settings& s, const std::string& token, const std::string& user) {
+  JsonDocument doc;
+  doc["pushoverToken"] = token.c_str();
+  doc["pushoverUser"] = user.c_str();
+  doc["enablePushover"] = true;
+  s.saveFromJson(doc);
+}
+
+// Każdy test ma własnego klienta (i zadanie wysyłki) – liczniki startują od zera
+struct Env {
+  Settings settings;
+  MockTransport mock;
+  PushoverClient client{&settings};
+};
+
+uint32_t counter(const PushoverClient& p, const char* key) {
+  JsonDocument doc;
+  p.toJson(doc);
+  return doc[key].as<uint32_t>();
+}
+
+bool waitCounter(const PushoverClient& p, const char* key, uint32_t want) {
+  for (int i = 0; i < 500; i++) {
+    if (counter(p, key) >= want) return true;
+    vTaskDelay(10);
+  }
+  return false;
+}
+
+TEST(Pushover, FullQueueDropsWithoutBlocking) {
+  Env& e = *new Env(); // zadanie wysyłki żyje do końca procesu – nie zwalniamy
+  Settings& settings = e.settings;
+  MockTransport& mock = e.mock;
+  PushoverClient& client = e.client;
+  configure(settings, "token", "user");
+  mock.hold = true;
+  client.setTransport(MockTransport::send, &mock);
+  client.begin();
+
+  // Pierwsza wiadomość trafia do transportu i go blokuje – kolejne czekają w kolejce
+  client.send("w drodze");
+  ASSERT_TRUE(mock.waitCalls(1));
+  for (int i = 0; i < QUEUE_LEN; i++) client.send("w kolejce");
+  for (int i = 0; i < 3; i++) client.send("nadmiar");
+
+  EXPECT_EQ(counter(client, "queue_len"), (uint32_t)QUEUE_LEN);
+  EXPECT_EQ(counter(client, "queued"), (uint32_t)QUEUE_LEN);
+  EXPECT_EQ(counter(client, "enqueued"), (uint32_t)QUEUE_LEN + 1);
+  EXPECT_EQ(counter(client, "dropped"), 3u);
+
+  mock.release();
+  ASSERT_TRUE(waitCounter(client, "sent", QUEUE_LEN + 1));
+  EXPECT_EQ(counter(client, "queued"), 0u);
+  EXPECT_EQ(counter(client, "failed"), 0u);
+  EXPECT_EQ(counter(client, "dropped"), 3u);
+}
+
+TEST(Pushover, FailingTransportCountsFailures) {
+  Env& e = *new Env(); // zadanie wysyłki żyje do końca procesu – nie zwalniamy
+  Settings& settings = e.settings;
+  MockTransport& mock = e.mock;
+  PushoverClient& client = e.client;
+  configure(settings, "token", "user");
+  mock.code = 500;
+  client.setTransport(MockTransport::send, &mock);
+
+  for (int i = 0; i < 3; i++) client.send("błąd");
+  ASSERT_TRUE(waitCounter(client, "failed", 3));
+  EXPECT_EQ(counter(client, "sent"), 0u);
+  EXPECT_EQ(counter(client, "enqueued"), 3u);
+
+  mock.code = 200;
+  client.send("ok");
+  ASSERT_TRUE(waitCounter(client, "sent", 1));
+  EXPECT_EQ(counter(client, "failed"), 3u);
+}
+
+TEST(Pushover, LongFieldsAreTruncated) {
+  Env& e = *new Env(); // zadanie wysyłki żyje do końca procesu – nie zwalniamy
+  Settings& settings = e.settings;
+  MockTransport& mock = e.mock;
+  PushoverClient& client = e.client;
+  const std::string token(100, 't'), user(CRED_MAX, 'u'), text(3 * TEXT_MAX, 'x');
+  configure(settings, token, user);
+  client.setTransport(MockTransport::send, &mock);
+
+  client.send(text.c_str());
+  ASSERT_TRUE(waitCounter(client, "sent", 1));
+  {
+    std::lock_guard<std::mutex> l(mock.m);
+    EXPECT_EQ(mock.token, token.substr(0, CRED_MAX - 1));
+    EXPECT_EQ(mock.user, user.substr(0, CRED_MAX - 1));
+    EXPECT_EQ(mock.text, text.substr(0, TEXT_MAX - 1));
+  }
+  EXPECT_EQ(counter(client, "truncated"), 1u);
+
+  // Tekst mieszczący się w buforze przechodzi bez zmian
+  const std::string fits(TEXT_MAX - 1, 'y');
+  client.send(fits.c_str());
+  ASSERT_TRUE(waitCounter(client, "sent", 2));
+  {
+    std::lock_guard<std::mutex> l(mock.m);
+    EXPECT_EQ(mock.text, fits);
+  }
+  EXPECT_EQ(counter(client, "truncated"), 1u);
+}
+
+}  // namespace
@@ -0,0 +1,149 @@
+// WeatherHistory: sumy i średnie z okien godzinowych/dobowych (sumy narastające)
+// porównane z liczeniem wprost, zapis i odczyt wx-history.bin.
+#include <gtest/gtest.h>
+#include <map>
+#include <random>
+#include "HostTest.h"
+#include "WeatherHistory.h"
+
+namespace {
+
+const time_t T0 = 1718002800; // 2024-06-10 07:00 UTC, pełna godzina
+constexpr int HOURS = WeatherHistory::HOURS;
+
+class WeatherHistoryTest : public ::testing::Test {
+protected:
+  void SetUp() override {
+    HostTest::warsawTz();
+    LittleFS.format();
+    LittleFS.begin();
+  }
+};
+
+TEST_F(WeatherHistoryTest, EmptyHistory) {
+  WeatherHistory h;
+  EXPECT_FALSE(h.begin()); // brak pliku
+  EXPECT_EQ(h.hoursStored(), 0);
+  EXPECT_FLOAT_EQ(h.rainLastHours(24, T0), 0.0f);
+  EXPECT_FLOAT_EQ(h.rainLastDays(7, T0), 0.0f);
+  EXPECT_TRUE(isnan(h.tempAvgLastHours(24, T0)));
+  EXPECT_TRUE(isnan(h.humidityAvgLastHours(24, T0)));
+}
+
+TEST_F(WeatherHistoryTest, RainSumsOverHourWindows) {
+  WeatherHistory h;
+  h.begin();
+  h.addRain(T0 + 60, 1.0f);
+  h.addRain(T0 + 3600 + 60, 2.0f);
+  h.addRain(T0 + 3600 + 1800, 0.5f); // ta sama godzina – sumuje się
+  h.addRain(T0 + 10 * 3600 + 5, 1.2f); // po przerwie
+  const time_t now = T0 + 10 * 3600 + 600;
+
+  EXPECT_EQ(h.hoursStored(), 11);
+  EXPECT_NEAR(h.rainLastHours(1, now), 1.2f, 1e-4);
+  EXPECT_NEAR(h.rainLastHours(6, now), 1.2f, 1e-4);
+  EXPECT_NEAR(h.rainLastHours(10, now), 3.7f, 1e-4);
+  EXPECT_NEAR(h.rainLastHours(11, now), 4.7f, 1e-4);
+  EXPECT_NEAR(h.rainLastHours(24 * 30, now), 4.7f, 1e-4);
+  // Okno wcześniej niż ostatni pomiar
+  EXPECT_NEAR(h.rainLastHours(1, T0 + 3600), 2.5f, 1e-4);
+  EXPECT_NEAR(h.rainLastHours(2, T0 + 3600), 3.5f, 1e-4);
+  // Okno w całości po ostatnim pomiarze
+  EXPECT_FLOAT_EQ(h.rainLastHours(3, T0 + 20 * 3600), 0.0f);
+  EXPECT_NEAR(h.rainLastHours(12, T0 + 20 * 3600), 1.2f, 1e-4);
+}
+
+TEST_F(WeatherHistoryTest, IgnoresClockGoingBackAndUnsyncedTime) {
+  WeatherHistory h;
+  h.begin();
+  h.addRain(T0 + 5 * 3600, 1.0f);
+  h.addRain(T0, 3.0f);        // godzina wcześniej niż ostatnia – pomijana
+  h.addRain(1000, 3.0f);      // przed synchronizacją NTP
+  EXPECT_NEAR(h.rainLastHours(24, T0 + 5 * 3600), 1.0f, 1e-4);
+  EXPECT_EQ(h.hoursStored(), 1);
+}
+
+TEST_F(WeatherHistoryTest, TemperatureAndHumidityAverageHourlyMeans) {
+  WeatherHistory h;
+  h.begin();
+  h.add(T0 + 60, 0, 20.0f, 50, 3.0f);
+  h.add(T0 + 120, 0, 22.0f, 70, 5.0f);  // średnia godziny: 21.0 / 60
+  h.add(T0 + 2 * 3600, 0, 10.0f, 90, 1.0f); // godzina pomiędzy bez danych
+  const time_t now = T0 + 2 * 3600 + 60;
+
+  EXPECT_NEAR(h.tempAvgLastHours(1, now), 10.0f, 1e-4);
+  EXPECT_NEAR(h.tempAvgLastHours(3, now), 15.5f, 1e-4);  // (21 + 10) / 2, pusta godzina pominięta
+  EXPECT_NEAR(h.humidityAvgLastHours(3, now), 75.0f, 1e-4);
+  EXPECT_TRUE(isnan(h.tempAvgLastHours(1, now - 3600))); // sama pusta godzina
+
+  float rain, temp, hum, wind;
+  ASSERT_TRUE(h.hourAt(WeatherHistory::keyOf(false, T0), rain, temp, hum, wind));
+  EXPECT_NEAR(temp, 21.0f, 1e-4);
+  EXPECT_NEAR(wind, 4.0f, 1e-4);
+}
+
+// Losowe pomiary przez 40 dni: okna O(1) muszą się zgadzać z sumą wprost
+TEST_F(WeatherHistoryTest, WindowsMatchBruteForce) {
+  WeatherHistory h;
+  h.begin();
+  std::mt19937 rng(12345);
+  std::map<int32_t, int> hourly; // godzina -> opad w 0,1 mm
+  std::map<int32_t, int> daily;  // doba lokalna -> opad w 0,1 mm
+
+  time_t ts = T0;
+  const time_t end = T0 + 40 * 24 * 3600;
+  while (ts < end) {
+    ts += 300 + rng() % 7200;
+    const int r = rng() % 4 == 0 ? (int)(rng() % 50) : 0;
+    h.addRain(ts, r / 10.0f, false);
+    hourly[WeatherHistory::keyOf(false, ts)] += r;
+    daily[WeatherHistory::keyOf(true, ts)] += r;
+  }
+  const int32_t nowH = WeatherHistory::keyOf(false, ts);
+  const int32_t today = WeatherHistory::keyOf(true, ts);
+  EXPECT_EQ(h.hoursStored(), HOURS);
+
+  for (int n : { 1, 2, 6, 24, 48, 72, 24 * 7, 24 * 31, HOURS }) {
+    int expect = 0;
+    for (const auto& kv : hourly)
+      if (kv.first > nowH - n && kv.first <= nowH && kv.first > nowH - HOURS) expect += kv.second;
+    EXPECT_NEAR(h.rainLastHours(n, ts), expect / 10.0f, 1e-3) << "n=" << n;
+  }
+  for (int n : { 1, 2, 3, 7, 14, 30, 40, 60 }) {
+    int expect = 0;
+    for (const auto& kv : daily)
+      if (kv.first > today - n && kv.first <= today) expect += kv.second;
+    EXPECT_NEAR(h.rainLastDays(n, ts), expect / 10.0f, 1e-3) << "n=" << n;
+  }
+}
+
+TEST_F(WeatherHistoryTest, PersistsAcrossRestart) {
+  {
+    WeatherHistory h;
+    h.begin();
+    for (int i = 0; i < 50; i++) h.add(T0 + i * 3600, 0.1f * (i % 3), 15.0f + i % 5, 60, 2.0f, false);
+    h.flush();
+  }
+  const time_t now = T0 + 49 * 3600;
+  WeatherHistory h;
+  ASSERT_TRUE(h.begin());
+  EXPECT_EQ(h.hoursStored(), 50);
+  EXPECT_NEAR(h.rainLastHours(24, now), 2.4f, 1e-3); // 8 × (0 + 0,1 + 0,2)
+  EXPECT_NEAR(h.rainLastHours(50, now), 4.9f, 1e-3);
+  EXPECT_NEAR(h.tempAvgLastHours(5, now), 17.0f, 1e-3);
+
+  // Dalsze pomiary po restarcie doliczane do odtworzonych sum
+  h.addRain(now + 3600, 1.0f);
+  EXPECT_NEAR(h.rainLastHours(2, now + 3600), 1.0f + 0.1f, 1e-3);
+}
+
+TEST_F(WeatherHistoryTest, RejectsCorruptFile) {
+  File f = LittleFS.open("/wx-history.bin", "w");
+  f.print("not a history file");
+  f.close();
+  WeatherHistory h;
+  EXPECT_FALSE(h.begin());
+  EXPECT_EQ(h.hoursStored(), 0);
+}
+
+} // namespace
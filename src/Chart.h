@@ -0,0 +1,186 @@
+#pragma once
+#include <Arduino.h>
+#include <math.h>
+
+// Seria punktów do wykresu: indeksy 0..count()-1 rosnąco w czasie, w równych
+// odstępach. at() = false oznacza lukę (brak pomiaru w tym punkcie).
+class ChartSource {
+public:
+  virtual ~ChartSource() {}
+  virtual int32_t count() = 0;
+  virtual bool at(int32_t i, uint32_t& t, float& v) = 0;
+};
+
+// Downsampling serii do ~points punktów, wydawany porcjami JSON
+// (AsyncWebServer::beginChunkedResponse). Punkty liczone są w locie przy
+// jednym przejściu po źródle, więc pamięć i rozmiar odpowiedzi zależą od
+// points, a nie od długości zakresu.
+//  - LTTB (Largest-Triangle-Three-Buckets): zachowuje kształt krzywej,
+//  - MINMAX: min i max z każdego kubełka (nie gubi szczytów opadu).
+// Seria krótsza niż points idzie bez zmian.
+class ChartWriter {
+public:
+  enum Mode : uint8_t { LTTB, MINMAX };
+
+private:
+  enum Stage : uint8_t { HEAD, FIRST, BODY, LAST, TAIL, DONE };
+
+  ChartSource* src;      // własność writera
+  Mode mode;
+  int32_t n = 0;         // punktów w źródle
+  int32_t lo = 0, hi = -1; // pierwszy/ostatni punkt z danymi
+  int32_t points;
+  bool raw = false;
+
+  Stage stage = HEAD;
+  int32_t bucket = 0, buckets = 0;
+  int32_t cursor = 0;    // tryb raw
+  double every = 0;
+  int32_t prevIdx = 0;   // LTTB: ostatnio wybrany punkt
+  float prevV = 0;
+  bool firstPoint = true;
+  int32_t pendingIdx = -1; // MINMAX: drugi punkt kubełka do wydania
+
+  char head[160];
+  char pend[48];
+  const char* pendPtr = pend; // head albo pend
+  size_t pendLen = 0, pendOff = 0;
+
+  bool value(int32_t i, float& v) { uint32_t t; return src->at(i, t, v); }
+
+  void emitPoint(int32_t i) {
+    uint32_t t; float v;
+    if (!src->at(i, t, v)) return;
+    pendLen = snprintf(pend, sizeof(pend), "%s[%lu,%.2f]", firstPoint ? "" : ",", (unsigned long)t, v);
+    firstPoint = false;
+  }
+
+  // LTTB: wybór punktu w kubełku `bucket` (skrajne punkty lo/hi idą osobno)
+  void lttbStep() {
+    const int32_t span = hi - lo + 1;
+    const int32_t rs = lo + (int32_t)floor(bucket * every) + 1;
+    int32_t re = lo + (int32_t)floor((bucket + 1) * every) + 1;
+    int32_t as = re;
+    int32_t ae = lo + (int32_t)floor((bucket + 2) * every) + 1;
+    if (ae > lo + span) ae = lo + span;
+    if (re > hi) re = hi;
+
+    // Średnia następnego kubełka (dla ostatniego: punkt końcowy)
+    double avgX = 0, avgY = 0; int cnt = 0; float v;
+    for (int32_t i = as; i < ae; i++) if (value(i, v)) { avgX += i; avgY += v; cnt++; }
+    if (cnt) { avgX /= cnt; avgY /= cnt; }
+    else if (value(hi, v)) { avgX = hi; avgY = v; }
+    else { avgX = prevIdx; avgY = prevV; }
+
+    double best = -1; int32_t bestIdx = -1; float bestV = 0;
+    for (int32_t i = rs; i < re; i++) {
+      if (!value(i, v)) continue;
+      const double area = fabs((prevIdx - avgX) * (v - prevV) - (prevIdx - i) * (avgY - prevV));
+      if (area > best) { best = area; bestIdx = i; bestV = v; }
+    }
+    if (bestIdx >= 0) {
+      emitPoint(bestIdx);
+      prevIdx = bestIdx;
+      prevV = bestV;
+    }
+  }
+
+  void minmaxStep() {
+    if (pendingIdx >= 0) { emitPoint(pendingIdx); pendingIdx = -1; bucket++; return; }
+    const int32_t span = hi - lo + 1;
+    const int32_t bs = lo + (int32_t)((int64_t)bucket * span / buckets);
+    const int32_t be = lo + (int32_t)((int64_t)(bucket + 1) * span / buckets);
+    int32_t minI = -1, maxI = -1; float minV = 0, maxV = 0, v;
+    for (int32_t i = bs; i < be; i++) {
+      if (!value(i, v)) continue;
+      if (minI < 0 || v < minV) { minI = i; minV = v; }
+      if (maxI < 0 || v > maxV) { maxI = i; maxV = v; }
+    }
+    if (minI < 0) { bucket++; return; }
+    const int32_t a = min(minI, maxI), b = max(minI, maxI);
+    emitPoint(a);
+    if (b != a) pendingIdx = b; else bucket++;
+  }
+
+  bool next() {
+    pendOff = 0;
+    pendLen = 0;
+    pendPtr = pend;
+    switch (stage) {
+      case HEAD:
+        pendPtr = head;
+        pendLen = strlen(head);
+        stage = hi < lo ? TAIL : (raw ? BODY : (mode == LTTB ? FIRST : BODY));
+        return true;
+      case FIRST: {
+        emitPoint(lo);
+        value(lo, prevV);
+        prevIdx = lo;
+        stage = BODY;
+        return true;
+      }
+      case BODY:
+        if (raw) {
+          if (cursor > hi) { stage = TAIL; return next(); }
+          emitPoint(cursor++);
+          return true;
+        }
+        if (bucket >= buckets) { stage = mode == LTTB ? LAST : TAIL; return next(); }
+        if (mode == LTTB) { lttbStep(); bucket++; }
+        else minmaxStep();
+        return true;
+      case LAST:
+        if (hi != prevIdx) emitPoint(hi);
+        stage = TAIL;
+        return true;
+      case TAIL:
+        pend[0] = ']'; pend[1] = '}';
+        pendLen = 2;
+        stage = DONE;
+        return true;
+      default:
+        return false;
+    }
+  }
+
+public:
+  // src przechodzi na własność writera; headJson to początek obiektu bez
+  // tablicy punktów, np. {"metric":"rain","res":"hour"
+  ChartWriter(ChartSource* s, Mode m, int32_t targetPoints, const char* headJson)
+    : src(s), mode(m), points(targetPoints) {
+    n = src->count();
+    float v;
+    while (lo < n && !value(lo, v)) lo++;
+    hi = n - 1;
+    while (hi >= lo && !value(hi, v)) hi--;
+    if (points < 3) points = 3;
+    const int32_t span = hi - lo + 1;
+    raw = span <= points;
+    cursor = lo;
+    if (!raw) {
+      if (mode == LTTB) { buckets = points - 2; every = (double)(span - 2) / buckets; }
+      else buckets = points / 2;
+    }
+    snprintf(head, sizeof(head), "%s,\"mode\":\"%s\",\"points\":[", headJson,
+             raw ? "raw" : (mode == LTTB ? "lttb" : "minmax"));
+  }
+  ~ChartWriter() { delete src; }
+  ChartWriter(const ChartWriter&) = delete;
+  ChartWriter& operator=(const ChartWriter&) = delete;
+
+  // Wypełnia buf (najwyżej maxLen bajtów); 0 = koniec odpowiedzi
+  size_t fill(uint8_t* buf, size_t maxLen) {
+    size_t out = 0;
+    while (out < maxLen) {
+      if (pendOff < pendLen) {
+        size_t k = min(pendLen - pendOff, maxLen - out);
+        memcpy(buf + out, pendPtr + pendOff, k);
+        out += k;
+        pendOff += k;
+        continue;
+      }
+      if (!next()) break;
+    }
+    return out;
+  }
+};
@@ -43,6 +43,14 @@ public:
 
   // Automatyka
   bool   getAutoMode() { return settings.getAutoMode(); }
+  int    getScheduleGraceMin() { return settings.getScheduleGraceMin(); }
+  int    getMaxConcurrentZones() { return settings.getMaxConcurrentZones(); }
+  float  getSupplyCapacity() { return settings.getSupplyCapacity(); }
+
+  // Wyjścia stref
+  int    getZoneCount()   { return settings.getZoneCount(); }
+  String getRelayDriver() { return settings.getRelayDriver(); }
+  String getRelayPins()   { return settings.getRelayPins(); }
 
   // TZ
   String getTimezone() { return settings.getTimezone(); }
@@ -53,6 +61,7 @@ public:
   int  getWeatherUpdateIntervalMin() { return settings.getWeatherUpdateIntervalMin(); }
 
   void saveFromJson(JsonDocument& doc) { settings.saveFromJson(doc); }
+  uint32_t getVersion() { return settings.getVersion(); }
   void toJson(JsonDocument& doc) { settings.toJson(doc); }
 
   // WiFi init
@@ -0,0 +1,300 @@
+#pragma once
+#include <Arduino.h>
+#include <WiFiClientSecure.h>
+#include <HTTPClient.h>
+#include <ArduinoJson.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
+// Wspólna pula połączeń HTTPS (Weather, Pushover).
+// Jedno połączenie keep-alive na host: kolejne żądania do tego samego hosta
+// (np. /weather + /forecast do api.openweathermap.org) idą po już zestawionym
+// TLS, bez nowego handshake'u. Połączenie nieużywane dłużej niż idleTimeoutMs
+// jest zamykane, żeby nie trzymać ~40 KB sterty mbedTLS.
+// Z gniazda korzysta naraz tylko jeden wątek (mutex na host).
+class HttpsPool {
+public:
+  static const int    MAX_HOSTS = 4;
+  static const size_t HOST_MAX  = 64;
+
+private:
+  struct Slot {
+    char host[HOST_MAX] = "";
+    WiFiClientSecure* client = nullptr;
+    HTTPClient*       http   = nullptr; // trwały – destruktor HTTPClient zamyka gniazdo
+    SemaphoreHandle_t mtx = nullptr;
+    unsigned long lastUseMs = 0;
+
+    uint32_t requests = 0, handshakes = 0, reused = 0, failures = 0;
+    uint32_t handshakeMsTotal = 0, lastHandshakeMs = 0, maxHandshakeMs = 0;
+  };
+
+  Slot slots[MAX_HOSTS];
+  SemaphoreHandle_t tableLock = nullptr;
+  unsigned long idleTimeoutMs = 15000;
+  const uint8_t* caBundle = nullptr;
+
+  Slot* findOrAdd(const char* host) {
+    if (!tableLock) tableLock = xSemaphoreCreateMutex();
+    xSemaphoreTake(tableLock, portMAX_DELAY);
+    Slot* found = nullptr;
+    for (int i = 0; i < MAX_HOSTS && !found; i++) {
+      if (slots[i].host[0] && strcmp(slots[i].host, host) == 0) found = &slots[i];
+    }
+    for (int i = 0; i < MAX_HOSTS && !found; i++) {
+      if (!slots[i].host[0]) {
+        strlcpy(slots[i].host, host, HOST_MAX);
+        slots[i].mtx = xSemaphoreCreateMutex();
+        found = &slots[i];
+      }
+    }
+    xSemaphoreGive(tableLock);
+    return found;
+  }
+
+  void configureClient(WiFiClientSecure* c) {
+    if (caBundle) c->setCACertBundle(caBundle);
+    else c->setInsecure();
+  }
+
+  // Wywoływane z zablokowanym slotem
+  bool connectSlot(Slot& s) {
+    if (!s.client) {
+      s.client = new WiFiClientSecure();
+      configureClient(s.client);
+      s.http = new HTTPClient();
+      s.http->setReuse(true);
+    }
+    if (s.client->connected() && millis() - s.lastUseMs < idleTimeoutMs) {
+      s.reused++;
+      return true;
+    }
+    s.client->stop();
+    const unsigned long t0 = millis();
+    if (!s.client->connect(s.host, 443)) {
+      s.failures++;
+      Serial.printf("[HTTPS] Błąd połączenia z %s\n", s.host);
+      return false;
+    }
+    const uint32_t dt = (uint32_t)(millis() - t0);
+    s.handshakes++;
+    s.handshakeMsTotal += dt;
+    s.lastHandshakeMs = dt;
+    if (dt > s.maxHandshakeMs) s.maxHandshakeMs = dt;
+    return true;
+  }
+
+public:
+  // Wyłączne prawo do połączenia z hostem na czas jednego (lub kilku) żądań
+  class Lease {
+    friend class HttpsPool;
+    Slot* slot = nullptr;
+    bool  fresh = false; // połączenie zestawione w tej dzierżawie
+
+  public:
+    Lease() {}
+    Lease(const Lease&) = delete;
+    Lease& operator=(const Lease&) = delete;
+    ~Lease() { release(); }
+
+    explicit operator bool() const { return slot && slot->client; }
+    WiFiClientSecure& client() { return *slot->client; }
+    HTTPClient& http() { return *slot->http; }
+
+    void release() {
+      if (!slot) return;
+      slot->lastUseMs = millis();
+      xSemaphoreGive(slot->mtx);
+      slot = nullptr;
+    }
+
+    // Zerwane/niespójne połączenie – następne żądanie zestawi nowe
+    void invalidate() {
+      if (slot && slot->client) slot->client->stop();
+    }
+  };
+
+  void setIdleTimeout(unsigned long ms) { idleTimeoutMs = ms; }
+
+  // Weryfikacja serwera względem paczki CA (np. x509_crt_bundle osadzonej w FW);
+  // nullptr = bez weryfikacji, jak dotąd. Dotyczy nowo tworzonych połączeń.
+  void setCaBundle(const uint8_t* bundle) { caBundle = bundle; }
+
+  bool lease(const char* host, Lease& out) {
+    out.release();
+    Slot* s = findOrAdd(host);
+    if (!s) {
+      Serial.printf("[HTTPS] Brak wolnego slotu dla %s\n", host);
+      return false;
+    }
+    xSemaphoreTake(s->mtx, portMAX_DELAY);
+    out.slot = s;
+    const uint32_t before = s->handshakes;
+    if (!connectSlot(*s)) {
+      out.release();
+      return false;
+    }
+    out.fresh = s->handshakes != before;
+    return true;
+  }
+
+  // Wysyła żądanie po połączeniu z dzierżawy. Jeśli połączenie było użyte
+  // ponownie i okazało się zerwane przez serwer, zestawia nowe i ponawia raz.
+  // Po udanym wywołaniu odpowiedź czyta się z l.http() (getStream/getString),
+  // a l.http().end() pozostawia połączenie otwarte do kolejnego żądania.
+  int send(Lease& l, const String& url,
+           const char* method = "GET", const String& body = String(),
+           const char* contentType = nullptr) {
+    static const char* collect[] = { "Transfer-Encoding" };
+    for (int attempt = 0; attempt < 2; attempt++) {
+      if (!l) return HTTPC_ERROR_CONNECTION_REFUSED;
+      HTTPClient& http = l.http();
+      l.slot->requests++;
+      if (!http.begin(l.client(), url)) return HTTPC_ERROR_CONNECTION_REFUSED;
+      http.collectHeaders(collect, 1);
+      if (contentType) http.addHeader("Content-Type", contentType);
+      int code = http.sendRequest(method, body);
+      if (code > 0 || l.fresh || attempt > 0) return code;
+
+      http.end();
+      l.invalidate();
+      const uint32_t before = l.slot->handshakes;
+      if (!connectSlot(*l.slot)) return code;
+      l.fresh = l.slot->handshakes != before;
+    }
+    return HTTPC_ERROR_CONNECTION_LOST;
+  }
+
+  static bool isChunked(HTTPClient& http) {
+    return http.header("Transfer-Encoding").equalsIgnoreCase("chunked");
+  }
+
+  // Zamyka połączenia bezczynne dłużej niż idleTimeoutMs (nie czeka na zajęte)
+  void closeIdle() {
+    for (int i = 0; i < MAX_HOSTS; i++) {
+      Slot& s = slots[i];
+      if (!s.mtx || !s.client) continue;
+      if (xSemaphoreTake(s.mtx, 0) != pdTRUE) continue;
+      if (s.client->connected() && millis() - s.lastUseMs >= idleTimeoutMs) s.client->stop();
+      xSemaphoreGive(s.mtx);
+    }
+  }
+
+  void toJson(JsonDocument& doc) {
+    doc["idle_timeout_ms"] = idleTimeoutMs;
+    doc["ca_bundle"] = caBundle != nullptr;
+    JsonArray arr = doc["hosts"].to<JsonArray>();
+    for (int i = 0; i < MAX_HOSTS; i++) {
+      const Slot& s = slots[i];
+      if (!s.host[0]) continue;
+      JsonObject o = arr.add<JsonObject>();
+      o["host"] = s.host;
+      o["requests"] = s.requests;
+      o["handshakes"] = s.handshakes;
+      o["reused"] = s.reused;
+      o["failures"] = s.failures;
+      o["handshake_ms_total"] = s.handshakeMsTotal;
+      o["handshake_ms_last"] = s.lastHandshakeMs;
+      o["handshake_ms_max"] = s.maxHandshakeMs;
+      o["handshake_ms_avg"] = s.handshakes ? s.handshakeMsTotal / s.handshakes : 0;
+    }
+  }
+};
+
+// Body odpowiedzi HTTP jako strumień dla ArduinoJson: dekoduje
+// "Transfer-Encoding: chunked" (HTTP/1.1 keep-alive) i pilnuje Content-Length.
+// drain() doczytuje resztę body, żeby następne żądanie na tym samym
+// połączeniu zaczynało się od czystego bufora; reusable() mówi, czy koniec
+// body został jednoznacznie wyznaczony (inaczej połączenie trzeba zamknąć).
+class HttpBodyStream : public Stream {
+  WiFiClient& src;
+  const bool chunked;
+  long left;          // bajty do końca chunka / body; -1 = do zamknięcia połączenia
+  bool eof = false;
+  bool clean = false; // koniec body wyznaczony przez protokół
+  int  peeked = -1;
+
+  int rawRead() {
+    const unsigned long t0 = millis();
+    do {
+      int c = src.read();
+      if (c >= 0) return c;
+      if (!src.connected()) return -1;
+      delay(1);
+    } while (millis() - t0 < _timeout);
+    return -1;
+  }
+
+  static int hexVal(int c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+  }
+
+  bool fillChunk() {
+    if (left > 0) return true;
+    // Nagłówek chunka: rozmiar hex [;rozszerzenia] CRLF
+    long n = 0; bool any = false, ext = false; int c;
+    while ((c = rawRead()) >= 0 && c != '\n') {
+      if (ext || c == '\r') continue;
+      if (c == ';') { ext = true; continue; }
+      int v = hexVal(c);
+      if (v < 0) continue;
+      n = n * 16 + v; any = true;
+    }
+    if (c < 0 || !any) { eof = true; return false; }
+    if (n == 0) {
+      // Ostatni chunk: pomiń ewentualne trailery aż do pustej linii
+      int lineLen = 0;
+      while ((c = rawRead()) >= 0) {
+        if (c == '\n') { if (lineLen == 0) { clean = true; break; } lineLen = 0; }
+        else if (c != '\r') lineLen++;
+      }
+      eof = true;
+      return false;
+    }
+    left = n;
+    return true;
+  }
+
+public:
+  explicit HttpBodyStream(HTTPClient& http)
+    : src(*http.getStreamPtr()),
+      chunked(HttpsPool::isChunked(http)),
+      left(chunked ? 0 : http.getSize()) {
+    setTimeout(5000);
+    if (!chunked && left == 0) { eof = true; clean = true; }
+  }
+
+  int available() override {
+    if (peeked >= 0) return 1;
+    if (eof) return 0;
+    if (chunked) return fillChunk() ? 1 : 0;
+    return src.available();
+  }
+
+  int read() override {
+    if (peeked >= 0) { int c = peeked; peeked = -1; return c; }
+    if (eof) return -1;
+    if (chunked && !fillChunk()) return -1;
+    int c = rawRead();
+    if (c < 0) { eof = true; return -1; }
+    if (chunked) {
+      if (--left == 0) { rawRead(); rawRead(); } // CRLF po danych chunka
+    } else if (left > 0 && --left == 0) {
+      eof = true; clean = true;
+    }
+    return c;
+  }
+
+  int peek() override {
+    if (peeked < 0) peeked = read();
+    return peeked;
+  }
+
+  size_t write(uint8_t) override { return 0; }
+
+  void drain() { while (read() >= 0) {} }
+  bool reusable() const { return clean; }
+};
@@ -0,0 +1,217 @@
+#pragma once
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <ESPAsyncWebServer.h>
+#include <time.h>
+#include <atomic>
+#include <memory>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "Zones.h"
+#include "Weather.h"
+#include "Logs.h"
+
+// Kanał push dla PWA i panelu awaryjnego: /api/events (Server-Sent Events).
+// Zdarzenia:
+//   "zone"    {"id","active","end","remaining","queued"} – end = czas wyłączenia (epoch s),
+//             klient sam odlicza, więc nie trzeba co sekundę odpytywać /api/zones
+//   "log"     {"seq","text"} – nowy wpis dziennika
+//   "weather" – ten sam JSON co /api/weather, po każdej nowej migawce
+// loop() woła pętla główna; zmiany wykrywa po licznikach wersji modułów, więc
+// bez podłączonych klientów i bez zmian kosztuje kilka porównań.
+// Pętla tylko dopisuje gotowe zdarzenia do bufora pierścieniowego (pod blokadą).
+// Do klientów wysyła je async_tcp: każdy klient to odpowiedź chunked, której
+// callback (jak w LogJsonWriter) czyta bufor od własnego kursora – listą
+// połączeń zarządza wyłącznie biblioteka, pętla jej nie dotyka.
+class LiveEvents {
+  static const int LOG_BURST = 16;          // maks. wpisów dziennika na jedno loop()
+  static const uint32_t KEEPALIVE_MS = 30000;
+  static const int RETRY_MS = 3000;          // po ilu ms przeglądarka łączy się ponownie
+  static const uint32_t RING_BYTES = 8192;   // zaległe zdarzenia dla wszystkich klientów
+  static const uint32_t MAX_EVENT = RING_BYTES / 2;
+
+  struct ZoneSent {
+    bool active = false;
+    int8_t queued = 0;
+    uint32_t end = 0;
+  };
+
+  // Stan jednego połączenia – żyje tyle, co odpowiedź (zwalnia go biblioteka)
+  struct Client {
+    LiveEvents* owner;
+    uint32_t cursor;   // pozycja w strumieniu bajtów bufora
+    bool hello = false;
+    Client(LiveEvents* o, uint32_t c) : owner(o), cursor(c) { owner->clients++; }
+    ~Client() { owner->clients--; }
+  };
+
+  struct Guard {
+    SemaphoreHandle_t m;
+    Guard(SemaphoreHandle_t s) : m(s) { xSemaphoreTake(m, portMAX_DELAY); }
+    ~Guard() { xSemaphoreGive(m); }
+  };
+
+  Zones* zones = nullptr;
+  Weather* weather = nullptr;
+  Logs* logs = nullptr;
+
+  uint32_t zonesVersion = 0, weatherVersion = 0, logSeq = 0;
+  ZoneSent sent[Zones::MAX_ZONES];
+  unsigned long lastSendMs = 0;
+  uint32_t eventCount = 0;
+  uint32_t oversize = 0; // zdarzenia większe niż MAX_EVENT – pominięte
+  std::atomic<uint32_t> lagged{0};  // klienci rozłączeni, bo bufor ich wyprzedził
+  std::atomic<int> clients{0};
+
+  SemaphoreHandle_t lock = nullptr;
+  char ring[RING_BYTES];
+  uint32_t head = 0; // bajty zapisane od startu; ring[head % RING_BYTES] = następny
+
+  void put(const char* data, size_t n) {
+    for (size_t i = 0; i < n; i++) ring[(head + i) % RING_BYTES] = data[i];
+    head += n;
+  }
+
+  // "event: X\ndata: {...}\n\n" w buforze; JSON nie zawiera znaków nowej linii
+  void push(const char* event, const char* data, size_t len) {
+    char pre[32];
+    const int p = snprintf(pre, sizeof(pre), "event: %s\ndata: ", event);
+    Guard g(lock);
+    put(pre, p);
+    put(data, len);
+    put("\n\n", 2);
+    lastSendMs = millis();
+  }
+
+  void emit(const char* event, JsonDocument& doc) {
+    const size_t n = measureJson(doc);
+    if (n > MAX_EVENT) {
+      oversize++;
+      Serial.printf("[Events] Zdarzenie \"%s\" (%u B) większe niż %u B – pominięte\n", event, (unsigned)n, (unsigned)MAX_EVENT);
+      return;
+    }
+    String json;
+    json.reserve(n);
+    serializeJson(doc, json);
+    push(event, json.c_str(), json.length());
+    eventCount++;
+  }
+
+  // Callback odpowiedzi (async_tcp): kolejne bajty od kursora klienta.
+  // 0 = koniec połączenia (przeglądarka łączy się ponownie i pobiera całość).
+  size_t fill(Client& c, uint8_t* buf, size_t maxLen) {
+    size_t out = 0;
+    if (!c.hello) {
+      char hello[48];
+      const int n = snprintf(hello, sizeof(hello), "retry: %d\nevent: hello\ndata: {}\n\n", RETRY_MS);
+      if ((size_t)n > maxLen) return RESPONSE_TRY_AGAIN;
+      memcpy(buf, hello, n);
+      out = n;
+      c.hello = true;
+    }
+    Guard g(lock);
+    if (head - c.cursor > RING_BYTES) {
+      lagged++;
+      return out;
+    }
+    while (out < maxLen && c.cursor != head) buf[out++] = ring[c.cursor++ % RING_BYTES];
+    return out ? out : RESPONSE_TRY_AGAIN;
+  }
+
+  void pollZones() {
+    const uint32_t v = zones->getVersion();
+    if (v == zonesVersion) return;
+    zonesVersion = v;
+    const time_t now = time(nullptr);
+    for (int i = 0; i < zones->getZoneCount(); i++) {
+      ZoneSent s;
+      int remaining = 0, queued = 0;
+      s.active = zones->liveState(i, remaining, queued);
+      s.queued = (int8_t)queued;
+      s.end = s.active ? (uint32_t)(now + remaining) : 0;
+      // Ta sama strefa z innym "end" o 1 s to tylko zaokrąglenie odliczania
+      const bool endMoved = s.end > sent[i].end + 1 || s.end + 1 < sent[i].end;
+      if (s.active == sent[i].active && s.queued == sent[i].queued && !endMoved) continue;
+      sent[i] = s;
+      JsonDocument doc;
+      doc["id"] = i;
+      doc["active"] = s.active;
+      doc["end"] = s.end;
+      doc["remaining"] = remaining;
+      doc["queued"] = s.queued;
+      emit("zone", doc);
+    }
+  }
+
+  void pollLogs() {
+    const uint32_t next = logs->getNextSeq();
+    if (next == logSeq) return;
+    // Po czyszczeniu/przeskoku albo za dużo naraz – tylko najnowsze wpisy;
+    // klient widzi lukę w "seq" i może dociągnąć resztę z /api/logs?since=
+    uint32_t seq = logSeq;
+    if (next < logSeq || next - logSeq > (uint32_t)LOG_BURST) seq = next > (uint32_t)LOG_BURST ? next - LOG_BURST : 0;
+    logSeq = next;
+    char text[192];
+    LogRecord r;
+    for (; seq < next; seq++) {
+      if (!logs->get(seq, r)) continue;
+      Logs::render(r, text, sizeof(text));
+      JsonDocument doc;
+      doc["seq"] = seq;
+      doc["text"] = text;
+      emit("log", doc);
+    }
+  }
+
+  void pollWeather() {
+    const uint32_t v = weather->getVersion();
+    if (v == weatherVersion) return;
+    weatherVersion = v;
+    JsonDocument doc;
+    weather->toJson(doc);
+    emit("weather", doc);
+  }
+
+public:
+  void begin(AsyncWebServer* server, Zones* z, Weather* w, Logs* l) {
+    zones = z; weather = w; logs = l;
+    lock = xSemaphoreCreateMutex();
+    // Stan startowy jako "już wysłany" – nowy klient i tak raz pobiera całość
+    zonesVersion = zones->getVersion() - 1; // pierwszy loop() porówna strefy
+    weatherVersion = weather->getVersion();
+    logSeq = logs->getNextSeq();
+    server->on("/api/events", HTTP_GET, [this](AsyncWebServerRequest* req) {
+      uint32_t start;
+      { Guard g(lock); start = head; } // nowy klient dostaje tylko nowe zdarzenia
+      auto c = std::make_shared<Client>(this, start);
+      AsyncWebServerResponse* resp = req->beginChunkedResponse("text/event-stream",
+        [c](uint8_t* buf, size_t maxLen, size_t) -> size_t { return c->owner->fill(*c, buf, maxLen); });
+      resp->addHeader("Cache-Control", "no-cache");
+      req->send(resp);
+    });
+  }
+
+  void loop() {
+    if (!zones) return;
+    // Bez klientów tylko śledzimy liczniki, żeby po połączeniu nie wysłać zaległości
+    if (clients == 0) {
+      zonesVersion = zones->getVersion() - 1;
+      weatherVersion = weather->getVersion();
+      logSeq = logs->getNextSeq();
+      return;
+    }
+    pollZones();
+    pollLogs();
+    pollWeather();
+    if (millis() - lastSendMs >= KEEPALIVE_MS) {
+      push("ping", "{}", 2); // utrzymuje połączenie przez proxy/NAT
+    }
+  }
+
+  void toJson(JsonDocument& doc) {
+    doc["clients"] = clients.load();
+    doc["events"] = eventCount;
+    doc["oversize"] = oversize;
+    doc["lagged"] = lagged.load();
+  }
+};
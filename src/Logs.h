@@ -3,101 +3,452 @@
 #include <ArduinoJson.h>
 #include <LittleFS.h>
 #include <time.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
 
+// Kody zdarzeń w logu. Tekst (po polsku) powstaje dopiero przy odczycie
+// (/api/logs, MQTT "logs") – patrz Logs::render(). Nowe kody dopisujemy
+// na końcu, bo wartości są zapisywane w /logs.bin.
+enum LogEvent : uint8_t {
+  LOG_MQTT_CONNECTED = 1,
+  LOG_MQTT_CONNECT_FAILED,
+  LOG_MQTT_CMD_REFRESH,
+  LOG_MQTT_CMD_ZONE_NAMES,
+  LOG_MQTT_CMD_TOGGLE,        // zone
+  LOG_MQTT_CMD_START,         // zone, a0/a1 = sekundy (uint32)
+  LOG_MQTT_CMD_STOP,          // zone
+  LOG_MQTT_CMD_IMPORT,
+  LOG_MQTT_CMD_EDIT,          // a0 = id programu
+  LOG_MQTT_CMD_DELETE,        // a0 = id programu
+  LOG_MQTT_CMD_LOGS_CLEAR,
+  LOG_MQTT_CMD_SETTINGS,
+  LOG_PROG_EDITED,            // zone
+  LOG_PROG_REMOVED,           // a0 = id programu
+  LOG_PROGS_CLEARED,
+  LOG_PROG_LIMIT,
+  LOG_PROGS_IMPORTED,
+  LOG_AUTO_CANCELLED,         // zone, a0 = opad 6h ×10, a1 = T ×10, a2 = H, a3 = plan [min]
+  LOG_AUTO_SCALED,            // zone, a0 = opad 6h ×10, a1 = T ×10, a2 = H, a3 = %, a4 = plan [min]
+  LOG_AUTO_START,             // zone, a0 = czas [min]
+  LOG_WIFI_CHANGED,
+  LOG_SETTINGS_SAVED,
+  LOG_ZONE_MANUAL_ON,         // zone
+  LOG_ZONE_MANUAL_OFF,        // zone
+  LOG_ZONE_NAMES_CHANGED,
+  LOG_AUTO_MISSED,            // zone, a0 = spóźnienie [min]
+  LOG_LEGACY_TEXT,            // wpis sprzed logs.bin, a0/a1 = offset linii w /logs-legacy.txt (uint32)
+};
+
+// Rekord logu o stałym rozmiarze (16 B) – w RAM i w pliku w tej samej postaci
+struct LogRecord {
+  uint32_t ts;     // UNIX time
+  uint8_t  code;   // LogEvent
+  uint8_t  zone;   // indeks strefy, 0xFF = brak
+  int16_t  a[5];   // argumenty liczbowe, znaczenie zależne od kodu
+};
+
+// Logi: bufor cykliczny rekordów binarnych w RAM (dodanie = O(1), bez
+// alokacji) + dziennik tylko-do-dopisywania w LittleFS (/logs.bin).
+// Każdy add() dopisuje wyłącznie 16 bajtów; co COMPACT_AFTER rekordów
+// dziennik jest przepisywany do aktualnej zawartości bufora.
+// Każdy wpis ma rosnący numer (seq), który przeżywa restart i clear() –
+// klient może dociągać tylko nowe wpisy (/api/logs?since=<seq>).
 class Logs {
-  static const int MAX_LOGS = 50;
-  String logs[MAX_LOGS];
+public:
+  static const int MAX_LOGS = 1024;          // 16 KB RAM
+  static const int JSON_TAIL = 50;           // ile najnowszych wpisów oddaje toJson()
+
+private:
+  static const int COMPACT_AFTER = 2 * MAX_LOGS;
+  static const uint32_t FILE_MAGIC = 0x32474F4C; // "LOG2"
+  static constexpr const char* JOURNAL_PATH = "/logs.bin";
+  static constexpr const char* LEGACY_TEXT_PATH = "/logs-legacy.txt";
+
+  struct FileHeader {
+    uint32_t magic;
+    uint32_t recordSize;
+    uint32_t baseSeq;    // seq pierwszego rekordu w pliku
+  };
+
+  LogRecord logs[MAX_LOGS];
+  int head = 0;          // indeks najstarszego wpisu
   int count = 0;
+  uint32_t nextSeq = 0;  // seq następnego wpisu; najstarszy w RAM = nextSeq - count
+  int journalRecords = 0;
+  SemaphoreHandle_t lock = nullptr;
+
+  struct Guard {
+    SemaphoreHandle_t m;
+    Guard(SemaphoreHandle_t s) : m(s) { if (m) xSemaphoreTake(m, portMAX_DELAY); }
+    ~Guard() { if (m) xSemaphoreGive(m); }
+  };
 
 public:
   void begin() {
+    if (!lock) lock = xSemaphoreCreateMutex();
+    Guard g(lock);
     loadFromFS();
   }
 
-  void add(const String& txt) {
-    // Dodaj datę i godzinę
-    String entry = getTimestamp() + " – " + txt;
+  void add(LogEvent ev, int zone = -1, int16_t a0 = 0, int16_t a1 = 0, int16_t a2 = 0, int16_t a3 = 0, int16_t a4 = 0) {
+    LogRecord r;
+    r.ts = (uint32_t)time(nullptr);
+    r.code = ev;
+    r.zone = (zone >= 0 && zone < 0xFF) ? (uint8_t)zone : 0xFF;
+    r.a[0] = a0; r.a[1] = a1; r.a[2] = a2; r.a[3] = a3; r.a[4] = a4;
 
-    if (count < MAX_LOGS) {
-      logs[count++] = entry;
-    } else {
-      // FIFO – przesunięcie w lewo
-      for (int i = 1; i < MAX_LOGS; i++) {
-        logs[i - 1] = logs[i];
-      }
-      logs[MAX_LOGS - 1] = entry;
-    }
-    saveToFS();
+    Guard g(lock);
+    push(r);
+    appendToFS(r);
   }
 
   void clear() {
+    Guard g(lock);
+    head = 0;
     count = 0;
-    saveToFS();
+    compact();
+  }
+
+  // Stała w formacie ×10 (np. 6h=1.4mm -> 14) z nasyceniem do int16
+  static int16_t fixed10(float v) {
+    float s = v * 10.0f;
+    if (s > 32767.0f) return 32767;
+    if (s < -32768.0f) return -32768;
+    return (int16_t)lroundf(s);
+  }
+
+  // Liczba 32-bitowa rozpisana na dwa argumenty (a[i] = młodsze, a[i+1] = starsze)
+  static int16_t lo16(uint32_t v) { return (int16_t)(v & 0xFFFF); }
+  static int16_t hi16(uint32_t v) { return (int16_t)(v >> 16); }
+
+  // Tekst wpisu: "RRRR-MM-DD GG:MM:SS – komunikat"
+  static size_t render(const LogRecord& r, char* buf, size_t cap) {
+    if (r.code == LOG_LEGACY_TEXT) return renderLegacy(r, buf, cap);
+    time_t ts = (time_t)r.ts;
+    struct tm t;
+    localtime_r(&ts, &t);
+    int n = snprintf(buf, cap, "%04d-%02d-%02d %02d:%02d:%02d – ",
+                     t.tm_year + 1900, t.tm_mon + 1, t.tm_mday, t.tm_hour, t.tm_min, t.tm_sec);
+    if (n < 0 || (size_t)n >= cap) return cap ? cap - 1 : 0;
+    char* p = buf + n;
+    size_t left = cap - n;
+    const int z = r.zone + 1;
+    const int16_t* a = r.a;
+
+    switch (r.code) {
+      case LOG_MQTT_CONNECTED:      n = snprintf(p, left, "MQTT: połączono z brokerem"); break;
+      case LOG_MQTT_CONNECT_FAILED: n = snprintf(p, left, "MQTT: błąd połączenia"); break;
+      case LOG_MQTT_CMD_REFRESH:    n = snprintf(p, left, "MQTT CMD: global/refresh"); break;
+      case LOG_MQTT_CMD_ZONE_NAMES: n = snprintf(p, left, "MQTT CMD: zmieniono nazwy stref"); break;
+      case LOG_MQTT_CMD_TOGGLE:     n = snprintf(p, left, "MQTT CMD: toggle strefa %d", z); break;
+      case LOG_MQTT_CMD_START:
+        n = snprintf(p, left, "MQTT CMD: start strefa %d na %lus", z,
+                     (unsigned long)((uint16_t)a[0] | ((uint32_t)(uint16_t)a[1] << 16)));
+        break;
+      case LOG_MQTT_CMD_STOP:       n = snprintf(p, left, "MQTT CMD: stop strefa %d", z); break;
+      case LOG_MQTT_CMD_IMPORT:     n = snprintf(p, left, "MQTT CMD: import programów"); break;
+      case LOG_MQTT_CMD_EDIT:       n = snprintf(p, left, "MQTT CMD: edytuj program %d", a[0]); break;
+      case LOG_MQTT_CMD_DELETE:     n = snprintf(p, left, "MQTT CMD: usuń program %d", a[0]); break;
+      case LOG_MQTT_CMD_LOGS_CLEAR: n = snprintf(p, left, "MQTT CMD: wyczyszczono logi"); break;
+      case LOG_MQTT_CMD_SETTINGS:   n = snprintf(p, left, "MQTT CMD: zapisano ustawienia (publiczne)"); break;
+      case LOG_PROG_EDITED:         n = snprintf(p, left, "Edytowano program strefy %d", z); break;
+      case LOG_PROG_REMOVED:        n = snprintf(p, left, "Usunięto program %d", a[0]); break;
+      case LOG_PROGS_CLEARED:       n = snprintf(p, left, "Wyczyszczono wszystkie programy"); break;
+      case LOG_PROG_LIMIT:          n = snprintf(p, left, "Nie dodano programu – maksymalna liczba programów"); break;
+      case LOG_PROGS_IMPORTED:      n = snprintf(p, left, "Zaimportowano programy"); break;
+      case LOG_AUTO_CANCELLED:
+        n = snprintf(p, left, "Podlewanie odwołane – warunki pogodowe. 6h=%.1fmm, T=%.1f°C, H=%d%%, plan=%dmin → 0min",
+                     a[0] / 10.0f, a[1] / 10.0f, a[2], a[3]);
+        break;
+      case LOG_AUTO_SCALED:
+        n = snprintf(p, left, "Automat: Strefa %d: bazowo %dmin, współczynnik %d%% → %dmin (6h=%.1fmm, T=%.1f°C, H=%d%%)",
+                     z, a[4], a[3], (a[4] * a[3]) / 100, a[0] / 10.0f, a[1] / 10.0f, a[2]);
+        break;
+      case LOG_AUTO_START:          n = snprintf(p, left, "Automat: Start strefy %d na %dmin", z, a[0]); break;
+      case LOG_WIFI_CHANGED:        n = snprintf(p, left, "Zmieniono ustawienia WiFi"); break;
+      case LOG_SETTINGS_SAVED:      n = snprintf(p, left, "Zapisano ustawienia systemu"); break;
+      case LOG_ZONE_MANUAL_ON:      n = snprintf(p, left, "Ręcznie włączono strefę #%d", z); break;
+      case LOG_ZONE_MANUAL_OFF:     n = snprintf(p, left, "Ręcznie wyłączono strefę #%d", z); break;
+      case LOG_ZONE_NAMES_CHANGED:  n = snprintf(p, left, "Zmieniono nazwy stref"); break;
+      case LOG_AUTO_MISSED:         n = snprintf(p, left, "Automat: pominięto start strefy %d – spóźnienie %d min", z, a[0]); break;
+      default:                      n = snprintf(p, left, "Zdarzenie #%u", r.code); break;
+    }
+    if (n < 0) n = 0;
+    return (size_t)n >= left ? cap - 1 : (p - buf) + n;
+  }
+
+  // Stary wpis tekstowy – linia z /logs-legacy.txt, razem ze swoją datą
+  static size_t renderLegacy(const LogRecord& r, char* buf, size_t cap) {
+    if (!cap) return 0;
+    const uint32_t off = (uint16_t)r.a[0] | ((uint32_t)(uint16_t)r.a[1] << 16);
+    File f = LittleFS.open(LEGACY_TEXT_PATH, "r");
+    if (!f || !f.seek(off)) {
+      if (f) f.close();
+      int n = snprintf(buf, cap, "(stary wpis niedostępny)");
+      return n < 0 ? 0 : ((size_t)n >= cap ? cap - 1 : (size_t)n);
+    }
+    size_t n = f.readBytesUntil('\n', buf, cap - 1);
+    f.close();
+    buf[n] = 0;
+    return n;
   }
 
-  void toJson(JsonDocument& doc) {
+  // Najnowsze wpisy (domyślnie JSON_TAIL) jako tekst – {"first","next","logs":[...]}.
+  // Renderowanie (LOG_LEGACY_TEXT czyta flash) odbywa się poza blokadą –
+  // pod nią kopiujemy tylko pojedyncze rekordy, jak LogJsonWriter.
+  void toJson(JsonDocument& doc, int limit = JSON_TAIL) {
+    uint32_t from, to;
+    window(0, limit, true, from, to);
+    doc["first"] = from;
+    doc["next"] = to;
     JsonArray arr = doc["logs"].to<JsonArray>();
-    for (int i = 0; i < count; i++) {
-      arr.add(logs[i]);
+    char buf[192];
+    LogRecord r;
+    for (uint32_t seq = from; seq < to; seq++) {
+      if (!get(seq, r)) continue; // wypadł z bufora w międzyczasie
+      render(r, buf, sizeof(buf));
+      arr.add(buf);
     }
   }
 
+  // Zakres [from, to) do wysłania: od since (albo ostatnie limit wpisów,
+  // gdy tail), najwyżej limit rekordów. Wpisy starsze niż bufor są pomijane.
+  void window(uint32_t since, int limit, bool tail, uint32_t& from, uint32_t& to) {
+    Guard g(lock);
+    const uint32_t oldest = nextSeq - count;
+    if (limit < 1) limit = 1;
+    if (tail) {
+      to = nextSeq;
+      from = count > limit ? nextSeq - limit : oldest;
+      return;
+    }
+    // since "z przyszłości" (np. po wymianie pliku) – od najstarszego
+    from = (since < oldest || since > nextSeq) ? oldest : since;
+    to = (nextSeq - from > (uint32_t)limit) ? from + limit : nextSeq;
+  }
+
+  // Kopia rekordu o danym seq; false, jeśli już wypadł z bufora (lub jeszcze go nie ma)
+  bool get(uint32_t seq, LogRecord& out) {
+    Guard g(lock);
+    const uint32_t oldest = nextSeq - count;
+    if (seq < oldest || seq >= nextSeq) return false;
+    out = logs[(head + (int)(seq - oldest)) % MAX_LOGS];
+    return true;
+  }
+
+  uint32_t getNextSeq() {
+    Guard g(lock);
+    return nextSeq;
+  }
+
 private:
-  String getTimestamp() {
-    time_t now = time(nullptr);
-    struct tm t;
-    localtime_r(&now, &t);
-    char buf[20];
-    snprintf(buf, sizeof(buf), "%04d-%02d-%02d %02d:%02d:%02d",
-             t.tm_year + 1900,
-             t.tm_mon + 1,
-             t.tm_mday,
-             t.tm_hour,
-             t.tm_min,
-             t.tm_sec);
-    return String(buf);
+  void push(const LogRecord& r) {
+    nextSeq++;
+    if (count < MAX_LOGS) {
+      logs[(head + count) % MAX_LOGS] = r;
+      count++;
+    } else {
+      // Nadpisz najstarszy
+      logs[head] = r;
+      head = (head + 1) % MAX_LOGS;
+    }
   }
 
   void loadFromFS() {
-    if (!LittleFS.exists("/logs.json")) {
-      count = 0;
+    head = 0;
+    count = 0;
+    nextSeq = 0;
+    journalRecords = 0;
+
+    // Stare formaty tekstowe (/logs.log, wcześniej /logs.json) nie mają kodów
+    // zdarzeń – przy pierwszym starcie trafiają do dziennika jako LOG_LEGACY_TEXT
+    const bool legacy = LittleFS.exists("/logs.log") || LittleFS.exists("/logs.json");
+    if (legacy && !LittleFS.exists(JOURNAL_PATH)) {
+      migrateLegacy();
+      compact();
+    }
+    if (LittleFS.exists("/logs.json")) LittleFS.remove("/logs.json");
+    if (LittleFS.exists("/logs.log"))  LittleFS.remove("/logs.log");
+    if (count) return; // bufor już wypełniony migracją
+
+    if (!LittleFS.exists(JOURNAL_PATH)) {
+      compact(); // utwórz pusty dziennik z nagłówkiem
       return;
     }
-    File f = LittleFS.open("/logs.json", "r");
-    if (!f) {
-      count = 0;
+    File f = LittleFS.open(JOURNAL_PATH, "r");
+    if (!f) return;
+    FileHeader h{};
+    bool ok = f.read((uint8_t*)&h, sizeof(h)) == sizeof(h) &&
+              h.magic == FILE_MAGIC && h.recordSize == sizeof(LogRecord);
+    if (!ok) {
+      f.close();
+      Serial.println("[Logs] Nieprawidłowy nagłówek logs.bin – zaczynam od nowa.");
+      compact();
       return;
     }
-    StaticJsonDocument<4096> doc; // powinno wystarczyć dla 30 wpisów
-    DeserializationError err = deserializeJson(doc, f);
+    nextSeq = h.baseSeq;
+    LogRecord r;
+    while (f.read((uint8_t*)&r, sizeof(r)) == sizeof(r)) {
+      push(r);
+      journalRecords++;
+    }
     f.close();
-    if (err) {
-      Serial.print("[Logs] Błąd odczytu logs.json: ");
-      Serial.println(err.c_str());
-      count = 0;
+    if (journalRecords >= COMPACT_AFTER) compact();
+  }
+
+  // Treść starych wpisów idzie do LEGACY_TEXT_PATH (linia na wpis), a rekord
+  // wskazuje jej offset; plik znika, gdy ostatni taki rekord wypadnie z bufora
+  void migrateLegacy() {
+    File out = LittleFS.open(LEGACY_TEXT_PATH, "w");
+    if (!out) {
+      Serial.println("[Logs] Nie można utworzyć logs-legacy.txt – stare wpisy pominięte.");
       return;
     }
-    count = 0;
-    for (JsonVariant v : doc.as<JsonArray>()) {
-      if (count >= MAX_LOGS) break;
-      logs[count++] = v.as<String>();
+    if (LittleFS.exists("/logs.log")) {
+      File f = LittleFS.open("/logs.log", "r");
+      while (f && f.available()) {
+        String line = f.readStringUntil('\n');
+        if (line.length()) addLegacy(out, line.c_str());
+      }
+      if (f) f.close();
+    } else {
+      File f = LittleFS.open("/logs.json", "r");
+      JsonDocument doc;
+      DeserializationError err = f ? deserializeJson(doc, f) : DeserializationError::InvalidInput;
+      if (f) f.close();
+      if (err) {
+        Serial.print("[Logs] Błąd odczytu logs.json: ");
+        Serial.println(err.c_str());
+      }
+      for (JsonVariant v : doc.as<JsonArray>()) {
+        const char* text = v.as<const char*>();
+        if (text && *text) addLegacy(out, text);
+      }
     }
+    out.close();
+    Serial.printf("[Logs] Przeniesiono %d starych wpisów do logs.bin\n", count);
   }
 
-  void saveToFS() {
-    StaticJsonDocument<4096> doc;
-    JsonArray arr = doc.to<JsonArray>();
-    for (int i = 0; i < count; i++) {
-      arr.add(logs[i]);
-    }
-    File f = LittleFS.open("/logs.json", "w");
+  void addLegacy(File& out, const char* text) {
+    LogRecord r{};
+    r.ts = 0; // data jest w treści
+    r.code = LOG_LEGACY_TEXT;
+    r.zone = 0xFF;
+    const uint32_t off = (uint32_t)out.position();
+    r.a[0] = lo16(off);
+    r.a[1] = hi16(off);
+    for (const char* c = text; *c; c++) out.write((uint8_t)(*c == '\n' ? ' ' : *c));
+    out.write((uint8_t)'\n');
+    push(r);
+  }
+
+  void appendToFS(const LogRecord& r) {
+    File f = LittleFS.open(JOURNAL_PATH, "a");
     if (!f) {
-      Serial.println("[Logs] Nie można otworzyć logs.json do zapisu!");
+      Serial.println("[Logs] Nie można otworzyć logs.bin do zapisu!");
       return;
     }
-    if (serializeJson(doc, f) == 0) {
-      Serial.println("[Logs] Błąd zapisu logs.json!");
+    f.write((const uint8_t*)&r, sizeof(r));
+    f.close();
+    if (++journalRecords >= COMPACT_AFTER) compact();
+  }
+
+  // Przepisuje dziennik tak, by zawierał tylko rekordy z bufora
+  void compact() {
+    File f = LittleFS.open(JOURNAL_PATH, "w");
+    if (!f) {
+      Serial.println("[Logs] Nie można otworzyć logs.bin do zapisu!");
+      return;
     }
+    FileHeader h{FILE_MAGIC, sizeof(LogRecord), nextSeq - count};
+    f.write((const uint8_t*)&h, sizeof(h));
+    // Najwyżej dwa ciągłe fragmenty bufora cyklicznego
+    int firstLen = min(count, MAX_LOGS - head);
+    if (firstLen > 0) f.write((const uint8_t*)&logs[head], firstLen * sizeof(LogRecord));
+    if (count > firstLen) f.write((const uint8_t*)&logs[0], (count - firstLen) * sizeof(LogRecord));
     f.close();
+    journalRecords = count;
+
+    bool legacy = false;
+    for (int i = 0; i < count && !legacy; i++) legacy = logs[(head + i) % MAX_LOGS].code == LOG_LEGACY_TEXT;
+    if (!legacy && LittleFS.exists(LEGACY_TEXT_PATH)) LittleFS.remove(LEGACY_TEXT_PATH);
+  }
+};
+
+// Zakres logów [from, to) jako JSON, wydawany porcjami dowolnej długości
+// (AsyncWebServer::beginChunkedResponse). W pamięci jest tylko jeden
+// wyrenderowany wpis – rozmiar odpowiedzi nie zależy od historii.
+class LogJsonWriter {
+  enum Stage : uint8_t { HEAD, ITEMS, TAIL, DONE };
+
+  Logs* logs;
+  uint32_t from, seq, to;
+  bool more;
+  Stage stage = HEAD;
+  bool firstItem = true;
+  char pend[2 * 192 + 4]; // wpis po escapowaniu (najwyżej 2x) + cudzysłowy i przecinek
+  size_t pendLen = 0, pendOff = 0;
+
+  // "tekst" z escapowaniem JSON; znaki sterujące zamieniamy na spacje
+  size_t quote(const char* text, bool comma) {
+    size_t n = 0;
+    if (comma) pend[n++] = ',';
+    pend[n++] = '"';
+    for (const char* c = text; *c && n < sizeof(pend) - 2; c++) {
+      if (*c == '"' || *c == '\\') { pend[n++] = '\\'; pend[n++] = *c; }
+      else pend[n++] = ((uint8_t)*c < 0x20) ? ' ' : *c;
+    }
+    pend[n++] = '"';
+    return n;
+  }
+
+  bool next() {
+    pendOff = 0;
+    pendLen = 0;
+    switch (stage) {
+      case HEAD:
+        pendLen = snprintf(pend, sizeof(pend), "{\"first\":%lu,\"next\":%lu,\"more\":%s,\"logs\":[",
+                           (unsigned long)from, (unsigned long)to, more ? "true" : "false");
+        stage = ITEMS;
+        return true;
+      case ITEMS: {
+        LogRecord r;
+        while (seq < to && !logs->get(seq, r)) seq++; // wypadł z bufora w trakcie wysyłki
+        if (seq >= to) { stage = TAIL; return next(); }
+        seq++;
+        char text[192];
+        Logs::render(r, text, sizeof(text));
+        pendLen = quote(text, !firstItem);
+        firstItem = false;
+        return true;
+      }
+      case TAIL:
+        pend[0] = ']'; pend[1] = '}';
+        pendLen = 2;
+        stage = DONE;
+        return true;
+      default:
+        return false;
+    }
+  }
+
+public:
+  LogJsonWriter(Logs* l, uint32_t from_, uint32_t to_, bool more_)
+    : logs(l), from(from_), seq(from_), to(to_), more(more_) {}
+
+  // Wypełnia buf (najwyżej maxLen bajtów); 0 = koniec odpowiedzi
+  size_t fill(uint8_t* buf, size_t maxLen) {
+    size_t out = 0;
+    while (out < maxLen) {
+      if (pendOff < pendLen) {
+        size_t n = min(pendLen - pendOff, maxLen - out);
+        memcpy(buf + out, pend + pendOff, n);
+        out += n;
+        pendOff += n;
+        continue;
+      }
+      if (!next()) break;
+    }
+    return out;
   }
 };
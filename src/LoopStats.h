@@ -0,0 +1,141 @@
+#pragma once
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "freertos/FreeRTOS.h"
+
+// Pomiar opóźnień pętli sterującej (loop() w main.cpp).
+// Każdy etap (wifi/zones/programs/weather/mqtt/web) ma własny histogram czasu w µs,
+// a cała iteracja – osobny. Histogram logarytmiczny: 2 kubełki na oktawę,
+// więc percentyle są przybliżone z dokładnością ~40%, ale pamięć jest stała
+// i pomiar kosztuje kilka instrukcji na etap.
+// Zapis tylko z pętli głównej; /api/loop-stats (async_tcp) kopiuje histogramy
+// w sekcji krytycznej, a kasowanie zleca flagą, którą wykonuje pętla.
+class LoopStats {
+  friend struct HostTest; // testy na hoście (host/tests)
+
+public:
+  enum Stage : uint8_t { WIFI = 0, ZONES, PROGRAMS, WEATHER, MQTT, WEB, STAGE_COUNT };
+
+private:
+  static const int BUCKETS = 48; // 1 + 2*23 oktaw -> do ~16 s
+
+  struct Hist {
+    uint32_t buckets[BUCKETS];
+    uint32_t count;
+    uint32_t maxUs;
+    uint64_t sumUs;
+  };
+
+  Hist stages[STAGE_COUNT];
+  Hist total;
+  unsigned long iterStart  = 0;
+  unsigned long stageStart = 0;
+  unsigned long windowStartMs = 0;
+  volatile bool resetPending = false;
+  mutable portMUX_TYPE mux = portMUX_INITIALIZER_UNLOCKED;
+
+  static int bucketOf(uint32_t us) {
+    if (us == 0) return 0;
+    int octave = 31 - __builtin_clz(us);
+    int half   = octave > 0 ? (int)((us >> (octave - 1)) & 1) : 0;
+    int b = 1 + octave * 2 + half;
+    return b < BUCKETS ? b : BUCKETS - 1;
+  }
+
+  // Górna granica kubełka (µs) – tę wartość raportujemy jako percentyl
+  static uint32_t bucketUpper(int b) {
+    if (b <= 0) return 0;
+    int octave = (b - 1) / 2;
+    int half   = (b - 1) % 2;
+    uint32_t lo   = 1UL << octave;
+    uint32_t step = octave > 0 ? (lo >> 1) : 1;
+    return lo + step * (half + 1) - 1;
+  }
+
+  void record(Hist& h, uint32_t us) {
+    const int b = bucketOf(us);
+    portENTER_CRITICAL(&mux);
+    h.buckets[b]++;
+    h.count++;
+    h.sumUs += us;
+    if (us > h.maxUs) h.maxUs = us;
+    portEXIT_CRITICAL(&mux);
+  }
+
+  void clear() {
+    portENTER_CRITICAL(&mux);
+    memset(stages, 0, sizeof(stages));
+    memset(&total, 0, sizeof(total));
+    windowStartMs = millis();
+    portEXIT_CRITICAL(&mux);
+  }
+
+  static uint32_t percentile(const Hist& h, float p) {
+    if (h.count == 0) return 0;
+    uint32_t rank = (uint32_t)(h.count * p);
+    if (rank >= h.count) rank = h.count - 1;
+    uint32_t acc = 0;
+    for (int b = 0; b < BUCKETS; b++) {
+      acc += h.buckets[b];
+      if (acc > rank) {
+        uint32_t up = bucketUpper(b);
+        return up < h.maxUs ? up : h.maxUs;
+      }
+    }
+    return h.maxUs;
+  }
+
+  static void histToJson(const Hist& h, JsonObject o) {
+    o["count"] = h.count;
+    o["avg_us"] = h.count ? (uint32_t)(h.sumUs / h.count) : 0;
+    o["p50_us"] = percentile(h, 0.50f);
+    o["p90_us"] = percentile(h, 0.90f);
+    o["p99_us"] = percentile(h, 0.99f);
+    o["p999_us"] = percentile(h, 0.999f);
+    o["max_us"] = h.maxUs;
+  }
+
+public:
+  LoopStats() { clear(); }
+
+  // Z dowolnego zadania – histogramy wyzeruje najbliższa iteracja pętli
+  void reset() { resetPending = true; }
+
+  void beginIteration() {
+    if (resetPending) {
+      resetPending = false;
+      clear();
+    }
+    iterStart = micros();
+    stageStart = iterStart;
+  }
+
+  // Zamyka pomiar etapu s i od razu otwiera następny
+  void mark(Stage s) {
+    unsigned long now = micros();
+    record(stages[s], (uint32_t)(now - stageStart));
+    stageStart = now;
+  }
+
+  void endIteration() {
+    record(total, (uint32_t)(micros() - iterStart));
+  }
+
+  void toJson(JsonDocument& doc) const {
+    static const char* const names[STAGE_COUNT] = { "wifi", "zones", "programs", "weather", "mqtt", "web" };
+    // Kopia (~1,5 KB) zamiast serializacji w sekcji krytycznej
+    Hist* copy = (Hist*)malloc(sizeof(Hist) * (STAGE_COUNT + 1));
+    if (!copy) return;
+    portENTER_CRITICAL(&mux);
+    memcpy(copy, stages, sizeof(stages));
+    copy[STAGE_COUNT] = total;
+    const unsigned long start = windowStartMs;
+    portEXIT_CRITICAL(&mux);
+
+    doc["window_s"] = (uint32_t)((millis() - start) / 1000);
+    histToJson(copy[STAGE_COUNT], doc["loop"].to<JsonObject>());
+    JsonObject st = doc["stages"].to<JsonObject>();
+    for (int i = 0; i < STAGE_COUNT; i++) histToJson(copy[i], st[names[i]].to<JsonObject>());
+    free(copy);
+  }
+};
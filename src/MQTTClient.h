@@ -9,21 +9,30 @@
 #include "Weather.h"
 #include "Logs.h"
 #include "Config.h"
+#include "esp_heap_caps.h"
+#include <atomic>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+
+// Licznik alokacji sterty (main.cpp, hak ESP-IDF przy CONFIG_HEAP_USE_HOOKS)
+extern volatile uint32_t heapAllocCount;
 
 // Tematy MQTT (base = np. "sprinkler/esp32-001"):
 //  - <base>/global/status           (retained JSON)
 //  - <base>/weather                 (retained JSON)
 //  - <base>/zones                   (retained JSON array: [{id,active,remaining,name}, ...])
 //  - <base>/programs                (retained JSON array)
-//  - <base>/logs                    (retained JSON object {"logs":[...]})
+//  - <base>/logs                    (retained JSON object {"first","next","logs":[...]} – ostatnie wpisy)
 //  - <base>/settings/public         (retained JSON object – bez haseł itp.)
 //  - <base>/rain-history            (retained JSON array/object – zależnie od Twojej impl.)
 //  - <base>/watering-percent        (retained JSON object)
+//  - <base>/zone-stats              (retained JSON object – sumy 7 dni na strefę)
 // Kompatybilnie per-strefa:
 //  - <base>/zones/<id>/status       (retained "0"/"1")
 //  - <base>/zones/<id>/remaining    (retained sekundy)
 //
-// Komendy z backendu (subskrybowane):
+// Komendy z backendu (subskrypcje: <base>/cmd/# i <base>/global/refresh):
 //  - <base>/global/refresh          (pusty payload) → publikacja wszystkich snapshotów
 //  - <base>/cmd/zones/<id>/toggle   ("1"|"" )       → start/stop/toggle
 //  - <base>/cmd/zones/<id>/start    (liczba sekund) → start na czas
@@ -34,32 +43,46 @@
 //  - <base>/cmd/programs/delete/<id>(pusty)         → kasowanie programu
 //  - <base>/cmd/logs/clear          (pusty)         → czyszczenie logów
 //  - <base>/cmd/settings/set        (JSON)          → zapis ustawień PUBLICZNYCH
+//
+// Cały klient (połączenie TLS, odbiór komend, publikacje) działa we własnym
+// zadaniu FreeRTOS – zerwany broker nie zatrzymuje loop(), a więc ani stref,
+// ani programów. Ponowne łączenie z wykładniczym odstępem (1 s → 60 s),
+// komendy subskrybowane z QoS1. Wychodzące snapshoty nie stoją w kolejce
+// wiadomości: inne zadania zgłaszają tylko bit "do sprawdzenia", a zadanie
+// MQTT publikuje bieżący stan (retained – liczy się ostatnia wersja).
+// Komendy zmieniające stan (strefy, programy, ustawienia, nazwy) zadanie MQTT
+// tylko rozpoznaje i kopiuje do kolejki – wykonuje je loop() w pętli głównej,
+// tak jak przed przeniesieniem klienta do osobnego zadania.
 
 class MQTTClient {
+  friend struct HostTest; // testy na hoście (host/tests)
+
 public:
-  MQTTClient() : mqttClient(espClientTLS) {}
+  MQTTClient() : mqttClient(espClientTLS) { resetSent(); }
 
   void begin(Zones* z, Programs* p, Weather* w, Logs* l, Config* c) {
     zones = z; programs = p; weather = w; logs = l; config = c;
+    if (!cmdQueue) cmdQueue = xQueueCreate(CMD_QUEUE_LEN, sizeof(PendingCmd*));
     loadConfig();
+    if (!task) xTaskCreatePinnedToCore(taskEntry, "mqtt", TASK_STACK, this, 1, &task, 0);
   }
 
-  // Używane przez WebServerUI.h → przeładuj konfigurację z Config i przełącz połączenie
-  void updateConfig() {
-    if (!config) return;
-    // zapamiętaj czy byłeś połączony
-    const bool wasConnected = mqttClient.connected();
-    // przeładuj ustawienia z Config
-    loadConfig();
-
-    // jeśli byłeś połączony – rozłącz, by wymusić nową sesję z nowymi parametrami
-    if (wasConnected) {
-      mqttClient.disconnect();
+  // Z pętli głównej: wykonanie komend odebranych przez zadanie MQTT
+  void loop() {
+    PendingCmd* pc;
+    while (cmdQueue && xQueueReceive(cmdQueue, &pc, 0) == pdTRUE) {
+      const uint32_t t0 = micros();
+      handleCommand(pc->cmd, pc->id, pc->payload, pc->length);
+      free(pc);
+      const uint32_t dt = micros() - t0;
+      if (dt > cmdMaxUs) cmdMaxUs = dt;
     }
-    // ustaw znacznik, by pętla po 100 ms spróbowała połączyć się ponownie
-    lastReconnectAttempt = millis() - 1000;
   }
 
+  // Używane przez WebServerUI.h → zadanie MQTT przeładuje konfigurację
+  // z Config i połączy się od nowa (klienta dotyka tylko to zadanie)
+  void updateConfig() { configPending = true; }
+
   void loadConfig() {
     if (!config) return;
     enabled      = config->getEnableMqtt();
@@ -73,6 +96,8 @@ public:
     // TLS – bez weryfikacji CA (na start; docelowo możesz dodać CA brokera)
     espClientTLS.setInsecure();
 
+    buildTopics();
+
     mqttClient.setServer(mqttServer.c_str(), mqttPort);
     mqttClient.setBufferSize(2048); // większe pakiety JSON
     mqttClient.setCallback([this](char* topic, byte* payload, unsigned int length) {
@@ -80,32 +105,46 @@ public:
     });
   }
 
-  void loop() {
-    if (!enabled || mqttServer.length() == 0) {
-      if (mqttClient.connected()) mqttClient.disconnect();
-      return;
-    }
-    if (!mqttClient.connected()) {
-      const unsigned long now = millis();
-      if (now - lastReconnectAttempt > 500) {
-        lastReconnectAttempt = now;
-        (void)reconnect(); // próba; wynik i tak logujemy/obsługujemy dalej
-      }
-    } else {
-      mqttClient.loop();
-      publishGlobalStatus();      // co ~10s
-      publishAllSnapshots();      // co ~15s
-    }
+  // Z dowolnego zadania: sprawdź (i w razie zmiany opublikuj) przy najbliższym obiegu
+  void updateAfterZonesChange()        { request(SN_ZONES); }
+  void updateAfterProgramsChange()     { request(SN_PROGRAMS); }
+  void updateAfterLogsChange()         { request(SN_LOGS); }
+  void updateAfterSettingsChange()     { request(SN_SETTINGS); }
+  void updateAfterWeatherChange()      { request(SN_WEATHER); request(SN_PERCENT); }
+  void updateAfterRainHistoryChange()  { request(SN_RAIN); }
+
+  // Liczniki publikacji: bajty, pakiety i alokacje sterty w ostatnim cyklu
+  void statsToJson(JsonDocument& doc) {
+    doc["publishes"] = pubCount;
+    doc["failed"]    = pubFailed;
+    doc["bytes"]     = pubBytes;
+    doc["cycles"]    = cycleCount;
+    doc["lastCycleBytes"]    = lastCycleBytes;
+    doc["lastCyclePublishes"] = lastCyclePublishes;
+#ifdef CONFIG_HEAP_USE_HOOKS
+    doc["lastCycleAllocs"] = lastCycleAllocs;
+    doc["maxCycleAllocs"]  = maxCycleAllocs;
+#else
+    doc["lastCycleAllocs"] = nullptr; // firmware bez CONFIG_HEAP_USE_HOOKS
+#endif
+    doc["minFreeHeap"] = (uint32_t)heap_caps_get_minimum_free_size(MALLOC_CAP_DEFAULT);
+    doc["connected"]   = connected.load();
+    doc["connects"]    = connectCount;
+    doc["connectFails"] = connectFails;
+    doc["backoffMs"]   = backoffMs;
+    commandsToJson(doc["commands"].to<JsonObject>());
   }
 
-  void updateAfterZonesChange()        { publishZonesSnapshot(); publishGlobalStatus(true); }
-  void updateAfterProgramsChange()     { publishProgramsSnapshot(); }
-  void updateAfterLogsChange()         { publishLogsSnapshot(); }
-  void updateAfterSettingsChange()     { publishSettingsPublicSnapshot(); publishGlobalStatus(true); }
-  void updateAfterWeatherChange()      { publishWeatherSnapshot(); publishWateringPercentSnapshot(); }
-  void updateAfterRainHistoryChange()  { publishRainHistorySnapshot(); }
-
 private:
+  // Ile najnowszych wpisów trafia do <base>/logs – krótki, stały snapshot;
+  // pełna historia jest w /api/logs?since=
+  static const int MQTT_LOGS_TAIL = 15;
+  // Niezmieniony snapshot i tak idzie co HEARTBEAT_MS; treść bez licznika
+  // wersji sprawdzana co SWEEP_MS; samo odliczanie stref co REMAINING_MS
+  static const unsigned long HEARTBEAT_MS = 10UL * 60UL * 1000UL;
+  static const unsigned long SWEEP_MS     = 15000;
+  static const unsigned long REMAINING_MS = 15000;
+
   WiFiClientSecure espClientTLS;
   PubSubClient mqttClient;
 
@@ -119,27 +158,118 @@ private:
   int    mqttPort  = 8883;
   bool   enabled   = true;
 
+  static const uint32_t TASK_STACK = 8192;
+  static const uint32_t BACKOFF_MIN_MS = 1000;
+  static const uint32_t BACKOFF_MAX_MS = 60000;
+
+  TaskHandle_t task = nullptr;
+  std::atomic<bool> configPending{false};
+  std::atomic<bool> connected{false};
+  std::atomic<uint32_t> requested{0}; // bity Snap zgłoszone przez inne zadania
+
+  // Komenda przekazywana z zadania MQTT do loop(): jeden malloc z payloadem
+  struct PendingCmd {
+    uint8_t cmd;
+    int id;
+    unsigned int length;
+    byte payload[];
+  };
+  static const int CMD_QUEUE_LEN = 8;
+  QueueHandle_t cmdQueue = nullptr;
+
   unsigned long lastReconnectAttempt = 0;
+  uint32_t backoffMs = 0;           // 0 = próbuj od razu
+  uint32_t connectCount = 0, connectFails = 0;
   unsigned long lastStatusUpdate     = 0;
   unsigned long lastSnapshotUpdate   = 0;
 
+  // Tematy snapshotów – składane raz w loadConfig(), bez Stringów przy publikacji
+  static const int TOPIC_MAX = 128;
+  char zonesPrefix[TOPIC_MAX] = "";  // "<base>/zones/" dla zones/<id>/...
+  char cmdPrefix[TOPIC_MAX] = "";    // "<base>/cmd/"
+  size_t cmdPrefixLen = 0;
+  char refreshTopic[TOPIC_MAX] = "";
+
+  // Statystyki publikacji
+  uint32_t pubCount = 0, pubFailed = 0, cycleCount = 0;
+  uint64_t pubBytes = 0;
+  uint32_t cycleBytes = 0, cyclePublishes = 0, cycleAllocStart = 0;
+  bool     cycleActive = false;
+  uint32_t lastCycleBytes = 0, lastCyclePublishes = 0, lastCycleAllocs = 0, maxCycleAllocs = 0;
+
   // ---- Utils ----
-  String topic(const String& leaf) const {
-    if (baseTopic.length() == 0) return leaf;
-    if (baseTopic.endsWith("/")) return baseTopic + leaf;
-    return baseTopic + "/" + leaf;
-  }
-
-  static bool parseIntSafe(const String& s, int& out) {
-    if (s.length() == 0) return false;
-    bool neg = false; long v = 0; int i = 0;
-    if (s[0] == '-') { neg = true; i = 1; }
-    for (; i < (int)s.length(); ++i) {
-      char c = s[i]; if (c < '0' || c > '9') return false;
-      v = v * 10 + (c - '0'); if (v > 10000000) return false;
+  void buildTopic(char* out, const char* leaf) const {
+    const char* sep = (baseTopic.length() == 0 || baseTopic.endsWith("/")) ? "" : "/";
+    snprintf(out, TOPIC_MAX, "%s%s%s", baseTopic.c_str(), sep, leaf);
+  }
+
+  void buildTopics() {
+    static const char* const leaves[SN_COUNT] = {
+      "global/status", "zones", "programs", "logs", "settings/public",
+      "weather", "rain-history", "watering-percent", "zone-stats"
+    };
+    for (int i = 0; i < SN_COUNT; i++) buildTopic(snapTopic[i], leaves[i]);
+    buildTopic(zonesPrefix, "zones/");
+    buildTopic(cmdPrefix, "cmd/");
+    cmdPrefixLen = strlen(cmdPrefix);
+    buildTopic(refreshTopic, "global/refresh");
+  }
+
+  // ---- Zadanie MQTT ----
+  static void taskEntry(void* arg) {
+    static_cast<MQTTClient*>(arg)->run();
+  }
+
+  void run() {
+    for (;;) {
+      if (configPending.exchange(false)) {
+        if (mqttClient.connected()) mqttClient.disconnect();
+        loadConfig();
+        backoffMs = 0;
+      }
+      if (!enabled || mqttServer.length() == 0 || WiFi.status() != WL_CONNECTED) {
+        if (mqttClient.connected()) mqttClient.disconnect();
+        connected = false;
+        vTaskDelay(pdMS_TO_TICKS(500));
+        continue;
+      }
+      if (!mqttClient.connected()) {
+        connected = false;
+        const unsigned long now = millis();
+        if (now - lastReconnectAttempt >= backoffMs) {
+          lastReconnectAttempt = now;
+          if (reconnect()) backoffMs = 0;
+          else {
+            // Wykładniczo, z losowym rozrzutem do 25% (kilka urządzeń, jeden broker)
+            uint32_t next = backoffMs ? backoffMs * 2 : BACKOFF_MIN_MS;
+            if (next > BACKOFF_MAX_MS) next = BACKOFF_MAX_MS;
+            backoffMs = next + esp_random() % (next / 4 + 1);
+          }
+        }
+        vTaskDelay(pdMS_TO_TICKS(100));
+        continue;
+      }
+      connected = true;
+      mqttClient.loop();      // odbiór komend → onMessage() w tym zadaniu
+      publishRequested();
+      publishChanged();       // tylko zmienione snapshoty (+ heartbeat)
+      vTaskDelay(pdMS_TO_TICKS(20));
     }
-    out = (int)(neg ? -v : v);
-    return true;
+  }
+
+  // Zgłoszone snapshoty sprawdzamy od razu, nie czekając na SWEEP_MS
+  void publishRequested() {
+    const uint32_t bits = requested.exchange(0);
+    if (!bits) return;
+    beginCycle();
+    if (bits & (1u << SN_ZONES))    publishZonesSnapshot();
+    if (bits & (1u << SN_PROGRAMS)) publishProgramsSnapshot();
+    if (bits & (1u << SN_LOGS))     publishLogsSnapshot();
+    if (bits & (1u << SN_SETTINGS)) publishSettingsPublicSnapshot();
+    if (bits & (1u << SN_WEATHER))  publishWeatherSnapshot();
+    if (bits & (1u << SN_RAIN))     publishRainHistorySnapshot();
+    if (bits & (1u << SN_PERCENT))  publishWateringPercentSnapshot();
+    endCycle();
   }
 
   // ---- Połączenie i subskrypcje ----
@@ -148,47 +278,185 @@ private:
     if (mqttUser.length() > 0) ok = mqttClient.connect(mqttClientId.c_str(), mqttUser.c_str(), mqttPass.c_str());
     else                       ok = mqttClient.connect(mqttClientId.c_str());
     if (ok) {
+      connectCount++;
       subscribeTopics();
-      publishGlobalStatus(true);
       publishAllSnapshots(true);
-      if (logs) logs->add("MQTT: połączono z brokerem");
+      if (logs) logs->add(LOG_MQTT_CONNECTED);
     } else {
-      if (logs) logs->add("MQTT: błąd połączenia");
+      // Log tylko pierwszej nieudanej próby z serii – przy awarii brokera
+      // kolejne próby co minutę zalałyby dziennik
+      if (logs && backoffMs == 0) logs->add(LOG_MQTT_CONNECT_FAILED);
+      connectFails++;
     }
     return ok;
   }
 
   void subscribeTopics() {
-    // Komendy
-    mqttClient.subscribe(topic("global/refresh").c_str());
-    mqttClient.subscribe(topic("cmd/zones/+/toggle").c_str());
-    mqttClient.subscribe(topic("cmd/zones/+/start").c_str());
-    mqttClient.subscribe(topic("cmd/zones/+/stop").c_str());
-    mqttClient.subscribe(topic("cmd/zones-names/set").c_str());
-    mqttClient.subscribe(topic("cmd/programs/import").c_str());
-    mqttClient.subscribe(topic("cmd/programs/edit/+").c_str());
-    mqttClient.subscribe(topic("cmd/programs/delete/+").c_str());
-    mqttClient.subscribe(topic("cmd/logs/clear").c_str());
-    mqttClient.subscribe(topic("cmd/settings/set").c_str());
+    // Komendy: cmd/# + odświeżenie
+    char t[TOPIC_MAX];
+    buildTopic(t, "cmd/#");
+    mqttClient.subscribe(t, 1);
+    mqttClient.subscribe(refreshTopic, 1);
   }
 
   // ---- Publikacje (retained) ----
-  void publishJsonRetained(const String& t, const JsonDocument& doc) {
-    String s; serializeJson(doc, s);
-    mqttClient.publish(t.c_str(), s.c_str(), true);
+  // Snapshot idzie do brokera tylko, gdy zmienił się jego klucz (licznik
+  // wersji źródła albo FNV-1a treści) lub minął HEARTBEAT_MS od ostatniej
+  // wysyłki. Tematy per strefa – tylko dla stref, które się zmieniły.
+  // Nieudana publikacja nie jest zapamiętywana – ponawiamy ją co SWEEP_MS.
+  enum Snap : uint8_t {
+    SN_STATUS, SN_ZONES, SN_PROGRAMS, SN_LOGS, SN_SETTINGS,
+    SN_WEATHER, SN_RAIN, SN_PERCENT, SN_ZONE_STATS, SN_COUNT
+  };
+  struct SnapState {
+    uint32_t key = 0;
+    unsigned long sent = 0;
+    unsigned long failedAt = 0;
+    bool valid = false;
+    bool failed = false;
+  };
+  SnapState snaps[SN_COUNT];
+  char snapTopic[SN_COUNT][TOPIC_MAX] = {};
+
+  // Ostatnio wysłane wartości zones/<id>/status i zones/<id>/remaining
+  int8_t  zoneActiveSent[Zones::MAX_ZONES];
+  int32_t zoneRemainingSent[Zones::MAX_ZONES];
+
+  // FNV-1a i długość serializacji w jednym przebiegu, bez bufora
+  struct HashPrint : public Print {
+    uint32_t h = 2166136261u;
+    size_t n = 0;
+    size_t write(uint8_t c) override { h ^= c; h *= 16777619u; n++; return 1; }
+    size_t write(const uint8_t* b, size_t len) override {
+      for (size_t i = 0; i < len; i++) write(b[i]);
+      return len;
+    }
+  };
+
+  // JSON wprost do pakietu PUBLISH (beginPublish/write/endPublish) przez
+  // mały bufor na stosie – po kawałku, a nie po bajcie (każdy write to
+  // osobny rekord TLS) i bez pośredniego Stringa
+  struct PublishWriter : public Print {
+    PubSubClient& c;
+    uint8_t buf[256];
+    size_t len = 0, total = 0;
+    explicit PublishWriter(PubSubClient& client) : c(client) {}
+    size_t write(uint8_t ch) override {
+      buf[len++] = ch;
+      if (len == sizeof(buf)) flushChunk();
+      return 1;
+    }
+    size_t write(const uint8_t* b, size_t n) override {
+      for (size_t i = 0; i < n; i++) write(b[i]);
+      return n;
+    }
+    void flushChunk() {
+      if (len) { total += c.write(buf, len); len = 0; }
+    }
+  };
+
+  void beginCycle() { cycleActive = false; }
+
+  void notePublish(size_t bytes, bool ok) {
+    if (!cycleActive) {
+      cycleActive = true;
+      cycleBytes = cyclePublishes = 0;
+      cycleAllocStart = heapAllocCount;
+    }
+    if (!ok) { pubFailed++; return; }
+    pubCount++; pubBytes += bytes;
+    cyclePublishes++; cycleBytes += bytes;
+  }
+
+  // Alokacje liczone od pierwszej publikacji w cyklu do jego końca
+  void endCycle() {
+    if (!cycleActive) return;
+    cycleActive = false;
+    cycleCount++;
+    lastCycleBytes = cycleBytes;
+    lastCyclePublishes = cyclePublishes;
+    lastCycleAllocs = heapAllocCount - cycleAllocStart;
+    if (lastCycleAllocs > maxCycleAllocs) maxCycleAllocs = lastCycleAllocs;
+  }
+
+  bool publishDoc(const char* t, const JsonDocument& doc, size_t len) {
+    bool ok = mqttClient.beginPublish(t, len, true);
+    if (ok) {
+      PublishWriter w(mqttClient);
+      serializeJson(doc, w);
+      w.flushChunk();
+      ok = mqttClient.endPublish() && w.total == len;
+    }
+    notePublish(len, ok);
+    return ok;
+  }
+
+  bool publishRaw(const char* t, const char* payload) {
+    const bool ok = mqttClient.publish(t, payload, true);
+    notePublish(strlen(payload), ok);
+    return ok;
+  }
+
+  bool due(Snap s, uint32_t key, bool force) const {
+    const SnapState& st = snaps[s];
+    if (force) return true;
+    if (st.failed) return millis() - st.failedAt >= SWEEP_MS;
+    return !st.valid || st.key != key || millis() - st.sent >= HEARTBEAT_MS;
+  }
+
+  void markSent(Snap s, uint32_t key) {
+    snaps[s].key = key;
+    snaps[s].sent = millis();
+    snaps[s].valid = true;
+    snaps[s].failed = false;
+  }
+
+  void markFailed(Snap s) {
+    snaps[s].failed = true;
+    snaps[s].failedAt = millis();
+  }
+
+  void markResult(Snap s, uint32_t key, bool ok) {
+    if (ok) markSent(s, key);
+    else    markFailed(s);
+  }
+
+  void resetSent() {
+    for (int i = 0; i < SN_COUNT; i++) { snaps[i].valid = false; snaps[i].failed = false; }
+    for (int i = 0; i < Zones::MAX_ZONES; i++) { zoneActiveSent[i] = -1; zoneRemainingSent[i] = -1; }
+  }
+
+  void request(Snap s) { requested.fetch_or(1u << s); }
+
+  // Snapshot bez licznika wersji: kluczem jest hash treści
+  void publishByContent(Snap s, const JsonDocument& doc, bool force) {
+    HashPrint hp;
+    serializeJson(doc, hp);
+    if (!due(s, hp.h, force)) return;
+    markResult(s, hp.h, publishDoc(snapTopic[s], doc, hp.n));
   }
-  void publishStringRetained(const String& t, const String& s) {
-    mqttClient.publish(t.c_str(), s.c_str(), true);
+
+  // Snapshot z licznikiem wersji – bez serializacji, gdy nic się nie zmieniło
+  bool publishVersioned(Snap s, uint32_t version, const JsonDocument& doc) {
+    const bool ok = publishDoc(snapTopic[s], doc, measureJson(doc));
+    markResult(s, version, ok);
+    return ok;
   }
 
+  // Godzina w treści nie liczy się do klucza – inaczej status szedłby co minutę
   void publishGlobalStatus(bool force=false) {
     const unsigned long now = millis();
-    if (!force && now - lastStatusUpdate < 10000) return; // co 10s
+    if (!force && now - lastStatusUpdate < 10000) return; // sprawdzenie co 10s
     lastStatusUpdate = now;
 
     JsonDocument doc;
     doc["wifi"]   = (WiFi.status() == WL_CONNECTED) ? "Połączono" : "Brak połączenia";
     doc["ip"]     = (WiFi.status() == WL_CONNECTED) ? WiFi.localIP().toString() : "-";
+    doc["online"] = true;
+    HashPrint hp;
+    serializeJson(doc, hp);
+    const uint32_t key = hp.h;
+    if (!due(SN_STATUS, key, force)) return;
 
     time_t tnow = time(nullptr);
     struct tm t; localtime_r(&tnow, &t);
@@ -196,52 +464,67 @@ private:
     snprintf(buf, sizeof(buf), "%04d-%02d-%02d %02d:%02d",
              t.tm_year + 1900, t.tm_mon + 1, t.tm_mday, t.tm_hour, t.tm_min);
     doc["time"]   = buf;
-    doc["online"] = true;
-
-    publishJsonRetained(topic("global/status"), doc);
+    publishVersioned(SN_STATUS, key, doc);
   }
 
-  void publishZonesSnapshot() {
+  // Zmiana stanu stref – od razu; samo odliczanie "remaining" – co REMAINING_MS
+  void publishZonesSnapshot(bool force=false) {
     if (!zones) return;
+    const uint32_t v = zones->getVersion();
+    if (!due(SN_ZONES, v, force)) {
+      if (snaps[SN_ZONES].failed || millis() - snaps[SN_ZONES].sent < REMAINING_MS || !zones->hasActive()) return;
+    }
 
     // 1) Pobierz pełny JSON stref z istniejącej implementacji:
     JsonDocument doc;
     zones->toJson(doc); // oczekujemy tablicy [{id,active,remaining,name}, ...]
 
     // 2) Opublikuj całą tablicę:
-    publishJsonRetained(topic("zones"), doc);
+    if (!publishVersioned(SN_ZONES, v, doc)) return;
 
-    // 3) Dodatkowo opublikuj per-strefa na podstawie TEGO SAMEGO JSON-a
+    // 3) Per-strefa tylko to, co się zmieniło od ostatniej wysyłki
     if (doc.is<JsonArray>()) {
       JsonArray arr = doc.as<JsonArray>();
       int idx = 0;
-      for (JsonVariant v : arr) {
-        int id = v.containsKey("id") ? (int)v["id"].as<int>() : idx;
-        bool active = v.containsKey("active") ? v["active"].as<bool>() : false;
-        int remaining = v.containsKey("remaining") ? v["remaining"].as<int>() : 0;
-
-        publishStringRetained(topic("zones/" + String(id) + "/status"), active ? "1" : "0");
-        publishStringRetained(topic("zones/" + String(id) + "/remaining"), String(remaining));
+      for (JsonVariant z : arr) {
+        int id = z["id"].is<int>() ? z["id"].as<int>() : idx;
         ++idx;
+        if (id < 0 || id >= Zones::MAX_ZONES) continue;
+        const int8_t active = z["active"].as<bool>() ? 1 : 0;
+        const int32_t remaining = z["remaining"] | 0;
+
+        char t[TOPIC_MAX + 16];
+        if (active != zoneActiveSent[id]) {
+          snprintf(t, sizeof(t), "%s%d/status", zonesPrefix, id);
+          if (publishRaw(t, active ? "1" : "0")) zoneActiveSent[id] = active;
+        }
+        if (remaining != zoneRemainingSent[id]) {
+          char val[12];
+          snprintf(t, sizeof(t), "%s%d/remaining", zonesPrefix, id);
+          snprintf(val, sizeof(val), "%ld", (long)remaining);
+          if (publishRaw(t, val)) zoneRemainingSent[id] = remaining;
+        }
       }
     }
   }
 
-  void publishProgramsSnapshot() {
+  void publishProgramsSnapshot(bool force=false) {
     if (!programs) return;
     JsonDocument doc;
     programs->toJson(doc); // tablica/obiekt – zależnie od Twojej implementacji
-    publishJsonRetained(topic("programs"), doc);
+    publishByContent(SN_PROGRAMS, doc, force);
   }
 
-  void publishLogsSnapshot() {
+  void publishLogsSnapshot(bool force=false) {
     if (!logs) return;
+    const uint32_t v = logs->getNextSeq();
+    if (!due(SN_LOGS, v, force)) return;
     JsonDocument doc;
-    logs->toJson(doc); // {"logs":[...]}
-    publishJsonRetained(topic("logs"), doc);
+    logs->toJson(doc, MQTT_LOGS_TAIL); // {"first","next","logs":[...]}
+    publishVersioned(SN_LOGS, v, doc);
   }
 
-  void publishSettingsPublicSnapshot() {
+  void publishSettingsPublicSnapshot(bool force=false) {
     if (!config) return;
     JsonDocument doc;
     config->toJson(doc);
@@ -251,155 +534,268 @@ private:
     doc["owmApiKey"]     = "";
     doc["pushoverUser"]  = "";
     doc["pushoverToken"] = "";
-    publishJsonRetained(topic("settings/public"), doc);
+    publishByContent(SN_SETTINGS, doc, force);
   }
 
-  void publishWeatherSnapshot() {
+  void publishWeatherSnapshot(bool force=false) {
     if (!weather) return;
     JsonDocument doc;
     weather->toJson(doc);
-    publishJsonRetained(topic("weather"), doc);
+    publishByContent(SN_WEATHER, doc, force);
   }
 
-  void publishRainHistorySnapshot() {
+  void publishRainHistorySnapshot(bool force=false) {
     if (!weather) return;
     JsonDocument doc;
     weather->rainHistoryToJson(doc);
-    publishJsonRetained(topic("rain-history"), doc);
+    publishByContent(SN_RAIN, doc, force);
   }
 
-  void publishWateringPercentSnapshot() {
+  void publishWateringPercentSnapshot(bool force=false) {
     if (!weather) return;
     JsonDocument doc;
     doc["percent"] = weather->getWateringPercent();
     doc["rain_6h"] = weather->getLast6hRain();
     doc["daily_max_temp"] = weather->getDailyMaxTemp();
     doc["daily_humidity_forecast"] = weather->getDailyHumidityForecast();
-    publishJsonRetained(topic("watering-percent"), doc);
+    publishByContent(SN_PERCENT, doc, force);
   }
 
-  void publishAllSnapshots(bool force=false) {
-    const unsigned long now = millis();
-    if (!force && now - lastSnapshotUpdate < 15000) return; // co 15s
-    lastSnapshotUpdate = now;
+  // Sumy z 7 dni (bez rozbicia dziennego – to jest w /api/zones/stats)
+  void publishZoneStatsSnapshot(bool force=false) {
+    if (!zones) return;
+    const uint32_t v = zones->getStatsVersion();
+    if (!due(SN_ZONE_STATS, v, force)) return;
+    JsonDocument doc;
+    zones->statsToJson(doc, 7);
+    doc.remove("daily");
+    publishVersioned(SN_ZONE_STATS, v, doc);
+  }
 
-    publishGlobalStatus(true);
+  // Z loop(): źródła z licznikiem wersji przy każdym wywołaniu (porównanie
+  // liczb), pozostałe – hash treści co SWEEP_MS.
+  void publishChanged() {
+    beginCycle();
+    publishGlobalStatus();
     publishZonesSnapshot();
-    publishProgramsSnapshot();
     publishLogsSnapshot();
-    publishSettingsPublicSnapshot();
-    publishWeatherSnapshot();
-    publishRainHistorySnapshot();
-    publishWateringPercentSnapshot();
+    publishZoneStatsSnapshot();
+
+    const unsigned long now = millis();
+    if (now - lastSnapshotUpdate >= SWEEP_MS) {
+      lastSnapshotUpdate = now;
+      publishProgramsSnapshot();
+      publishSettingsPublicSnapshot();
+      publishWeatherSnapshot();
+      publishRainHistorySnapshot();
+      publishWateringPercentSnapshot();
+    }
+    endCycle();
+  }
+
+  // Wszystko naraz (po połączeniu i na global/refresh)
+  void publishAllSnapshots(bool force=false) {
+    if (force) resetSent();
+    lastSnapshotUpdate = millis();
+    beginCycle();
+
+    publishGlobalStatus(force);
+    publishZonesSnapshot(force);
+    publishProgramsSnapshot(force);
+    publishLogsSnapshot(force);
+    publishSettingsPublicSnapshot(force);
+    publishWeatherSnapshot(force);
+    publishRainHistorySnapshot(force);
+    publishWateringPercentSnapshot(force);
+    publishZoneStatsSnapshot(force);
+    endCycle();
   }
 
   // ---- Obsługa komend ----
-  void onMessage(char* topicC, byte* payload, unsigned int length) {
-    const String top = String(topicC);
-    String msg; msg.reserve(length);
-    for (unsigned int i=0; i<length; ++i) msg += (char)payload[i];
+  // Jedna subskrypcja <base>/cmd/# – reszta tematu po "cmd/" dopasowywana
+  // do stałej tabeli wzorców ('+' = numer strefy/programu). Bez Stringów:
+  // temat porównywany w miejscu, payload parsowany wprost z bufora klienta.
+  enum Cmd : uint8_t {
+    C_ZONE_TOGGLE, C_ZONE_START, C_ZONE_STOP, C_ZONE_NAMES,
+    C_PROG_IMPORT, C_PROG_EDIT, C_PROG_DELETE, C_LOGS_CLEAR, C_SETTINGS,
+    C_REFRESH, C_COUNT
+  };
+  struct CmdRoute {
+    const char* pattern;
+    Cmd cmd;
+  };
+
+  // "a/+/b" vs "a/12/b" → true, arg = 12
+  static bool matchRoute(const char* pattern, const char* t, int& arg) {
+    arg = -1;
+    while (*pattern && *t) {
+      if (*pattern == '+') {
+        long v = 0; const char* start = t;
+        while (*t >= '0' && *t <= '9' && t - start < 6) v = v * 10 + (*t++ - '0');
+        if (t == start || (*t && *t != '/')) return false;
+        arg = (int)v;
+        pattern++;
+        continue;
+      }
+      if (*pattern++ != *t++) return false;
+    }
+    return *pattern == 0 && *t == 0;
+  }
 
-    if (top == topic("global/refresh")) {
-      if (logs) logs->add("MQTT CMD: global/refresh");
+  static bool parseIntSafe(const byte* p, unsigned int len, int& out) {
+    if (len == 0 || len > 9) return false;
+    bool neg = false; long v = 0; unsigned int i = 0;
+    if (p[0] == '-') { neg = true; i = 1; }
+    if (i == len) return false;
+    for (; i < len; ++i) {
+      if (p[i] < '0' || p[i] > '9') return false;
+      v = v * 10 + (p[i] - '0');
+    }
+    out = (int)(neg ? -v : v);
+    return true;
+  }
+
+  static bool payloadIs(const byte* p, unsigned int len, const char* s) {
+    return strlen(s) == len && memcmp(p, s, len) == 0;
+  }
+
+  // Liczniki komend
+  uint32_t cmdCount[C_COUNT] = {0};
+  uint32_t cmdUnknown = 0, cmdDropped = 0, cmdMaxUs = 0;
+
+  void commandsToJson(JsonObject o) {
+    static const char* const names[C_COUNT] = {
+      "zoneToggle", "zoneStart", "zoneStop", "zoneNames", "programsImport",
+      "programEdit", "programDelete", "logsClear", "settings", "refresh"
+    };
+    for (int i = 0; i < C_COUNT; i++) o[names[i]] = cmdCount[i];
+    o["unknown"] = cmdUnknown;
+    o["dropped"] = cmdDropped;
+    o["maxUs"]   = cmdMaxUs;
+  }
+
+  void onMessage(char* topicC, byte* payload, unsigned int length) {
+    static const CmdRoute routes[] = {
+      {"zones/+/toggle",    C_ZONE_TOGGLE},
+      {"zones/+/start",     C_ZONE_START},
+      {"zones/+/stop",      C_ZONE_STOP},
+      {"zones-names/set",   C_ZONE_NAMES},
+      {"programs/import",   C_PROG_IMPORT},
+      {"programs/edit/+",   C_PROG_EDIT},
+      {"programs/delete/+", C_PROG_DELETE},
+      {"logs/clear",        C_LOGS_CLEAR},
+      {"settings/set",      C_SETTINGS},
+    };
+
+    Cmd cmd = C_COUNT;
+    int arg = -1;
+    if (strcmp(topicC, refreshTopic) == 0) {
+      cmd = C_REFRESH;
+    } else if (strncmp(topicC, cmdPrefix, cmdPrefixLen) == 0) {
+      const char* rest = topicC + cmdPrefixLen;
+      for (const CmdRoute& r : routes) {
+        if (r.pattern[0] == rest[0] && matchRoute(r.pattern, rest, arg)) { cmd = r.cmd; break; }
+      }
+    }
+    if (cmd == C_COUNT) { cmdUnknown++; return; }
+    cmdCount[cmd]++;
+    if (cmd == C_REFRESH) { // same publikacje – zostaje w tym zadaniu
+      if (logs) logs->add(LOG_MQTT_CMD_REFRESH);
       publishAllSnapshots(true);
       return;
     }
+    PendingCmd* pc = (PendingCmd*)malloc(sizeof(PendingCmd) + length);
+    if (!pc) { cmdDropped++; return; }
+    pc->cmd = cmd; pc->id = arg; pc->length = length;
+    memcpy(pc->payload, payload, length);
+    if (xQueueSend(cmdQueue, &pc, 0) != pdTRUE) { free(pc); cmdDropped++; }
+  }
 
-    if (top == topic("cmd/zones-names/set")) {
-      if (zones) {
+  // Pętla główna; publikację zostawiamy zadaniu MQTT przez request()
+  void handleCommand(uint8_t cmd, int id, const byte* payload, unsigned int length) {
+    switch (cmd) {
+      case C_ZONE_NAMES: {
+        if (!zones) return;
         JsonDocument doc;
-        if (deserializeJson(doc, msg) == DeserializationError::Ok && doc.is<JsonArray>()) {
+        if (deserializeJson(doc, payload, length) == DeserializationError::Ok && doc.is<JsonArray>()) {
           zones->setAllZoneNames(doc.as<JsonArray>());
-          if (logs) logs->add("MQTT CMD: zmieniono nazwy stref");
-          publishZonesSnapshot();
+          if (logs) logs->add(LOG_MQTT_CMD_ZONE_NAMES);
+          request(SN_ZONES);
         }
+        return;
       }
-      return;
-    }
 
-    // cmd/zones/<id>/...
-    const String p = topic("cmd/zones/");
-    if (top.startsWith(p)) {
-      const int idx1 = p.length();
-      const int idx2 = top.indexOf('/', idx1);
-      if (idx2 > idx1) {
-        const int id = top.substring(idx1, idx2).toInt();
-        const String action = top.substring(idx2 + 1);
-
-        if (zones) {
-          if (action == "toggle") {
-            if (msg == "1" || msg == "ON" || msg == "on" || msg == "true") {
-              zones->startZone(id, 600); // domyślnie 600 s
-            } else if (msg.length() == 0) {
-              zones->toggleZone(id);
-            } else {
-              zones->stopZone(id);
-            }
-            if (logs) logs->add("MQTT CMD: toggle strefa " + String(id+1));
-          } else if (action == "start") {
-            int secs = 0;
-            if (parseIntSafe(msg, secs) && secs > 0) {
-              zones->startZone(id, secs);
-              if (logs) logs->add("MQTT CMD: start strefa " + String(id+1) + " na " + String(secs) + "s");
-            }
-          } else if (action == "stop") {
-            zones->stopZone(id);
-            if (logs) logs->add("MQTT CMD: stop strefa " + String(id+1));
-          }
-          publishZonesSnapshot();
+      case C_ZONE_TOGGLE:
+        if (!zones) return;
+        if (payloadIs(payload, length, "1") || payloadIs(payload, length, "ON") ||
+            payloadIs(payload, length, "on") || payloadIs(payload, length, "true")) {
+          zones->startZone(id, 600); // domyślnie 600 s
+        } else if (length == 0) {
+          zones->toggleZone(id);
+        } else {
+          zones->stopZone(id);
+        }
+        if (logs) logs->add(LOG_MQTT_CMD_TOGGLE, id);
+        request(SN_ZONES);
+        return;
+
+      case C_ZONE_START: {
+        if (!zones) return;
+        int secs = 0;
+        if (parseIntSafe(payload, length, secs) && secs > 0) {
+          zones->startZone(id, secs);
+          if (logs) logs->add(LOG_MQTT_CMD_START, id, Logs::lo16(secs), Logs::hi16(secs));
         }
+        request(SN_ZONES);
+        return;
       }
-      return;
-    }
 
-    if (top == topic("cmd/programs/import")) {
-      if (programs) {
+      case C_ZONE_STOP:
+        if (!zones) return;
+        zones->stopZone(id);
+        if (logs) logs->add(LOG_MQTT_CMD_STOP, id);
+        request(SN_ZONES);
+        return;
+
+      case C_PROG_IMPORT: {
+        if (!programs) return;
         JsonDocument doc;
-        if (deserializeJson(doc, msg) == DeserializationError::Ok) {
+        if (deserializeJson(doc, payload, length) == DeserializationError::Ok) {
           programs->importFromJson(doc);
-          if (logs) logs->add("MQTT CMD: import programów");
-          publishProgramsSnapshot();
+          if (logs) logs->add(LOG_MQTT_CMD_IMPORT);
+          request(SN_PROGRAMS);
         }
+        return;
       }
-      return;
-    }
 
-    const String pe = topic("cmd/programs/edit/");
-    if (top.startsWith(pe)) {
-      if (programs) {
-        const int id = top.substring(pe.length()).toInt();
+      case C_PROG_EDIT: {
+        if (!programs) return;
         JsonDocument doc;
-        if (deserializeJson(doc, msg) == DeserializationError::Ok) {
+        if (deserializeJson(doc, payload, length) == DeserializationError::Ok) {
           programs->edit(id, doc, true, true);
-          if (logs) logs->add("MQTT CMD: edytuj program " + String(id));
-          publishProgramsSnapshot();
+          if (logs) logs->add(LOG_MQTT_CMD_EDIT, -1, id);
+          request(SN_PROGRAMS);
         }
+        return;
       }
-      return;
-    }
 
-    const String pd = topic("cmd/programs/delete/");
-    if (top.startsWith(pd)) {
-      if (programs) {
-        const int id = top.substring(pd.length()).toInt();
+      case C_PROG_DELETE:
+        if (!programs) return;
         programs->remove(id, true);
-        if (logs) logs->add("MQTT CMD: usuń program " + String(id));
-        publishProgramsSnapshot();
-      }
-      return;
-    }
-
-    if (top == topic("cmd/logs/clear")) {
-      if (logs) logs->clear();
-      if (logs) logs->add("MQTT CMD: wyczyszczono logi");
-      publishLogsSnapshot();
-      return;
-    }
-
-    if (top == topic("cmd/settings/set")) {
-      if (config && weather) {
+        if (logs) logs->add(LOG_MQTT_CMD_DELETE, -1, id);
+        request(SN_PROGRAMS);
+        return;
+
+      case C_LOGS_CLEAR:
+        if (logs) logs->clear();
+        if (logs) logs->add(LOG_MQTT_CMD_LOGS_CLEAR);
+        request(SN_LOGS);
+        return;
+
+      case C_SETTINGS: {
+        if (!config || !weather) return;
         JsonDocument doc;
-        if (deserializeJson(doc, msg) == DeserializationError::Ok) {
+        if (deserializeJson(doc, payload, length) == DeserializationError::Ok) {
           config->saveFromJson(doc);
           weather->applySettings(
             config->getOwmApiKey(),
@@ -407,12 +803,15 @@ private:
             config->getEnableWeatherApi(),
             config->getWeatherUpdateIntervalMin()
           );
-          if (logs) logs->add("MQTT CMD: zapisano ustawienia (publiczne)");
-          publishSettingsPublicSnapshot();
-          publishGlobalStatus(true);
+          if (zones) zones->setBudget(config->getMaxConcurrentZones(), config->getSupplyCapacity());
+          if (logs) logs->add(LOG_MQTT_CMD_SETTINGS);
+          request(SN_SETTINGS);
         }
+        return;
       }
-      return;
+
+      default:
+        return;
     }
   }
 };
@@ -0,0 +1,122 @@
+#pragma once
+#include <Arduino.h>
+#include <LittleFS.h>
+
+// Stan uruchomień programu (zmienia się przy każdym starcie automatu)
+struct ProgramRunState {
+  uint16_t uid = 0;          // stały identyfikator programu (0 = slot wolny)
+  uint8_t  lastPercent = 0;  // ostatni współczynnik pogodowy, %
+  uint8_t  reserved = 0;
+  uint32_t lastRun = 0;      // UNIX time ostatniego uruchomienia
+  uint32_t lastFire = 0;     // ostatni obsłużony termin (także odwołany/pominięty)
+  uint16_t runs = 0;         // liczba uruchomień
+  uint16_t skips = 0;        // odwołane (pogoda) lub pominięte (spóźnienie)
+};
+
+// Plik /programs-state.bin: nagłówek + SLOTS rekordów o stałym rozmiarze.
+// Każdy program ma swój slot, więc zapis po starcie automatu to nadpisanie
+// 16 bajtów w miejscu ("r+"), a definicje w /programs.json nie są ruszane.
+// Operacje na wielu slotach (import, czyszczenie, start) otwierają plik raz:
+// beginBatch() … endBatch(), a write()/release() piszą przez ten uchwyt.
+class ProgramRunStore {
+public:
+  static const int SLOTS = 256;
+
+private:
+  static constexpr const char* PATH = "/programs-state.bin";
+  static const uint32_t MAGIC = 0x31535250; // "PRS1"
+
+  struct Header {
+    uint32_t magic;
+    uint16_t recordSize;
+    uint16_t slots;
+  };
+
+  uint8_t used[SLOTS / 8] = {0};
+  File batch; // otwarty między beginBatch() a endBatch()
+
+  static size_t offsetOf(int slot) { return sizeof(Header) + (size_t)slot * sizeof(ProgramRunState); }
+
+  bool create() {
+    File f = LittleFS.open(PATH, "w");
+    if (!f) {
+      Serial.println("[Programs] Nie można utworzyć programs-state.bin!");
+      return false;
+    }
+    Header h{MAGIC, (uint16_t)sizeof(ProgramRunState), (uint16_t)SLOTS};
+    f.write((const uint8_t*)&h, sizeof(h));
+    ProgramRunState empty;
+    for (int i = 0; i < SLOTS; i++) f.write((const uint8_t*)&empty, sizeof(empty));
+    f.close();
+    return true;
+  }
+
+  File openRW() {
+    File f = LittleFS.open(PATH, "r+");
+    if (!f) {
+      if (!create()) return File();
+      f = LittleFS.open(PATH, "r+");
+    }
+    return f;
+  }
+
+public:
+  bool isUsed(int slot) const { return used[slot / 8] & (1 << (slot % 8)); }
+  void markUsed(int slot, bool on) {
+    if (on) used[slot / 8] |= 1 << (slot % 8);
+    else    used[slot / 8] &= ~(1 << (slot % 8));
+  }
+
+  int allocSlot() {
+    for (int i = 0; i < SLOTS; i++) if (!isUsed(i)) { markUsed(i, true); return i; }
+    return -1;
+  }
+
+  // Odczyt wszystkich rekordów; cb(slot, state) dla zajętych slotów.
+  // false = brak pliku (lub nieprawidłowy) – utworzono pusty.
+  template <typename F>
+  bool load(F cb) {
+    memset(used, 0, sizeof(used));
+    if (LittleFS.exists(PATH)) {
+      File f = LittleFS.open(PATH, "r");
+      Header h;
+      if (f && f.read((uint8_t*)&h, sizeof(h)) == sizeof(h) && h.magic == MAGIC
+            && h.recordSize == sizeof(ProgramRunState) && h.slots == SLOTS) {
+        ProgramRunState r;
+        for (int i = 0; i < SLOTS && f.read((uint8_t*)&r, sizeof(r)) == sizeof(r); i++) {
+          if (r.uid) cb(i, r);
+        }
+        f.close();
+        return true;
+      }
+      if (f) f.close();
+      Serial.println("[Programs] Nieprawidłowy programs-state.bin – zaczynam od nowa.");
+    }
+    create();
+    return false;
+  }
+
+  void beginBatch() { if (!batch) batch = openRW(); }
+  void endBatch()   { if (batch) batch.close(); }
+
+  // Nadpisuje jeden rekord w miejscu
+  void write(int slot, const ProgramRunState& r) {
+    if (slot < 0 || slot >= SLOTS) return;
+    if (batch) {
+      batch.seek(offsetOf(slot));
+      batch.write((const uint8_t*)&r, sizeof(r));
+      return;
+    }
+    File f = openRW();
+    if (!f) return;
+    f.seek(offsetOf(slot));
+    f.write((const uint8_t*)&r, sizeof(r));
+    f.close();
+  }
+
+  void release(int slot) {
+    if (slot < 0 || slot >= SLOTS) return;
+    markUsed(slot, false);
+    write(slot, ProgramRunState());
+  }
+};
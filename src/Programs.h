@@ -3,26 +3,61 @@
 #include <ArduinoJson.h>   // ArduinoJson v7: używaj JsonDocument
 #include <LittleFS.h>
 #include <time.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
 #include "Zones.h"
 #include "Weather.h"
 #include "Logs.h"
 #include "PushoverClient.h"
 #include "Config.h"
+#include "ProgramRunState.h"
 
+// Program w postaci "skompilowanej": bez Stringów, gotowy do liczenia terminów.
+// Definicja (rzadko zmieniana) idzie do /programs.json, stan uruchomień
+// (run) – do osobnego /programs-state.bin, zapisywanego rekordami w miejscu.
 struct Program {
+  uint16_t uid = 0;        // stały identyfikator – klucz stanu w programs-state.bin
   uint8_t  zone = 0;
-  String   time;         // "HH:MM"
-  uint16_t duration = 0; // minuty
-  String   days;         // CSV: "0,1,2"
+  uint8_t  days = 0x7F;    // bit d = dzień tygodnia d (0 = niedziela, jak tm_wday)
+  uint16_t start = 6 * 60; // minuta doby ("HH:MM" -> HH*60+MM)
+  uint16_t duration = 0;   // minuty
   bool     active = true;
-  time_t   lastRun = 0;  // UNIX time ostatniego uruchomienia (persist)
+  int16_t  slot = -1;      // rekord w ProgramRunStore
+  ProgramRunState run;
 };
 
+// Harmonogram: kopiec (min-heap) najbliższych uruchomień wszystkich programów.
+// loop() porównuje tylko wierzchołek z bieżącym czasem, więc koszt nie rośnie
+// z liczbą programów. Uruchomienie spóźnione (np. przestój pętli) o mniej niż
+// scheduleGraceMin minut jest wykonywane, późniejsze – pomijane i logowane.
+// Kopiec jest budowany od nowa leniwie: po każdej zmianie programów, po
+// zmianie strefy czasowej (invalidateSchedule) i gdy zegar jest już ustawiony.
+// Kopiec trzyma indeksy do progs, a zmiany przychodzą z WWW (async_tcp) –
+// loop() i wszystkie metody zmieniające/czytające progs biorą blokadę.
 class Programs {
-  static constexpr int MAX_PROGS = 32;
+  friend struct HostTest; // testy na hoście (host/tests)
+  static constexpr int MAX_PROGS = ProgramRunStore::SLOTS;
+  static const time_t MIN_VALID_TIME = 1600000000; // przed synchronizacją NTP
+
+  struct Fire {
+    time_t   at;
+    uint16_t idx;
+  };
 
   Program progs[MAX_PROGS];
   int     numProgs = 0;
+  ProgramRunStore runStore;
+
+  Fire    heap[MAX_PROGS];
+  int     heapSize = 0;
+  bool    scheduleDirty = true;
+  bool    catchUp = true;  // pierwszy kopiec po starcie obejmuje okno grace wstecz
+  time_t  checkedUntil = 0; // terminy <= tej chwili loop() już obsłużył
+
+  // Wersja treści toJson() (cache /api/programs): rośnie przy każdym zapisie
+  // definicji/stanu, a także gdy minie najbliższe "next" z ostatniego toJson()
+  volatile uint32_t version = 0;
+  volatile time_t   jsonStaleAt = 0;
 
   Zones*          zones    = nullptr;
   Weather*        weather  = nullptr;
@@ -30,36 +65,206 @@ class Programs {
   PushoverClient* pushover = nullptr;
   Config*         config   = nullptr; // wskaźnik na Config
 
-  static bool containsDay(const String& daysStr, int today) {
-    int lastPos = 0, pos;
-    while ((pos = daysStr.indexOf(',', lastPos)) != -1) {
-      int dayNum = daysStr.substring(lastPos, pos).toInt();
-      if (dayNum == today) return true;
-      lastPos = pos + 1;
+  // Rekurencyjny: addFromJson() woła edit()/importFromJson()
+  SemaphoreHandle_t lock = nullptr;
+  struct Guard {
+    SemaphoreHandle_t m;
+    Guard(SemaphoreHandle_t s) : m(s) { if (m) xSemaphoreTakeRecursive(m, portMAX_DELAY); }
+    ~Guard() { if (m) xSemaphoreGiveRecursive(m); }
+  };
+
+  // "HH:MM" -> minuta doby
+  static uint16_t parseTime(const char* s) {
+    if (!s) return 6 * 60;
+    int h = 0, m = 0;
+    if (sscanf(s, "%d:%d", &h, &m) < 1) return 6 * 60;
+    h = constrain(h, 0, 23);
+    m = constrain(m, 0, 59);
+    return (uint16_t)(h * 60 + m);
+  }
+
+  static void formatTime(uint16_t start, char out[6]) {
+    snprintf(out, 6, "%02u:%02u", (unsigned)(start / 60) % 24, (unsigned)(start % 60));
+  }
+
+  // Dni jako tablica [0,1,...] albo CSV "0,1,2" -> maska bitowa
+  static uint8_t parseDays(JsonVariantConst v, uint8_t def) {
+    uint8_t mask = 0;
+    if (v.is<JsonArrayConst>()) {
+      for (JsonVariantConst d : v.as<JsonArrayConst>()) {
+        int n = d.as<int>();
+        if (n >= 0 && n <= 6) mask |= 1 << n;
+      }
+      return mask;
+    }
+    if (!v.is<const char*>()) return def;
+    for (const char* c = v.as<const char*>(); *c; c++) {
+      if (*c >= '0' && *c <= '6' && (c[1] == ',' || c[1] == '\0')) mask |= 1 << (*c - '0');
+    }
+    return mask;
+  }
+
+  static void formatDaysCsv(uint8_t mask, char out[16]) {
+    size_t n = 0;
+    out[0] = '\0';
+    for (int d = 0; d < 7; d++) {
+      if (!(mask & (1 << d))) continue;
+      if (n) out[n++] = ',';
+      out[n++] = '0' + d;
+      out[n] = '\0';
+    }
+  }
+
+  // Najbliższe uruchomienie P w chwili >= from (czas lokalny, DST przez mktime); 0 = nigdy
+  static time_t nextFire(const Program& P, time_t from) {
+    if (!P.active || !P.days) return 0;
+    struct tm base;
+    localtime_r(&from, &base);
+    for (int d = 0; d < 8; d++) {
+      struct tm t = base;
+      t.tm_mday += d;
+      t.tm_hour = P.start / 60;
+      t.tm_min  = P.start % 60;
+      t.tm_sec  = 0;
+      t.tm_isdst = -1;
+      time_t at = mktime(&t); // normalizuje datę i ustawia tm_wday
+      if (at >= from && (P.days & (1 << t.tm_wday))) return at;
+    }
+    return 0;
+  }
+
+  // --- Kopiec ---
+  void heapPush(time_t at, uint16_t idx) {
+    int i = heapSize++;
+    while (i > 0) {
+      int parent = (i - 1) / 2;
+      if (heap[parent].at <= at) break;
+      heap[i] = heap[parent];
+      i = parent;
+    }
+    heap[i] = Fire{at, idx};
+  }
+
+  Fire heapPop() {
+    Fire top = heap[0];
+    Fire last = heap[--heapSize];
+    int i = 0;
+    for (;;) {
+      int c = 2 * i + 1;
+      if (c >= heapSize) break;
+      if (c + 1 < heapSize && heap[c + 1].at < heap[c].at) c++;
+      if (heap[c].at >= last.at) break;
+      heap[i] = heap[c];
+      i = c;
     }
-    if (lastPos < (int)daysStr.length()) {
-      int dayNum = daysStr.substring(lastPos).toInt();
-      if (dayNum == today) return true;
+    if (heapSize > 0) heap[i] = last;
+    return top;
+  }
+
+  int graceSec() const {
+    int g = config ? config->getScheduleGraceMin() : 15;
+    return g > 0 ? g * 60 : 60; // 0 = tylko w tej samej minucie
+  }
+
+  void rebuildSchedule(time_t now) {
+    heapSize = 0;
+    // Od chwili, do której loop() już sprawdził terminy (po starcie: grace
+    // minut wstecz) – przebudowa po edycji w czasie przestoju pętli nie gubi
+    // należnego uruchomienia; starsze niż grace i tak są pomijane w loop()
+    time_t from = now - graceSec();
+    if (!catchUp && checkedUntil + 1 > from) from = checkedUntil + 1;
+    for (int i = 0; i < numProgs; i++) {
+      time_t at = nextFire(progs[i], from);
+      if (at && (time_t)progs[i].run.lastFire >= at) at = nextFire(progs[i], at + 60);
+      if (at) heapPush(at, (uint16_t)i);
     }
-    return false;
+    scheduleDirty = false;
+    catchUp = false;
   }
 
-  static String daysArrayToCsv(JsonArray arr) {
-    String d;
-    for (auto v : arr) {
-      if (d.length() > 0) d += ",";
-      d += String((int)v);
+  // Nowy program: uid i slot stanu
+  void assignIdentity(Program& P) {
+    if (!P.uid) {
+      uint16_t maxUid = 0;
+      for (int i = 0; i < numProgs; i++) if (progs[i].uid > maxUid) maxUid = progs[i].uid;
+      P.uid = maxUid + 1;
     }
-    return d;
+    P.run.uid = P.uid;
+    P.slot = runStore.allocSlot();
+    runStore.write(P.slot, P.run);
+  }
+
+  void saveRunState(int i) { runStore.write(progs[i].slot, progs[i].run); version++; }
+
+  void releaseAll() {
+    for (int i = 0; i < numProgs; i++) runStore.release(progs[i].slot);
   }
 
-  static void csvToDaysArray(const String& csv, JsonArray out) {
-    int lastPos = 0, pos;
-    while ((pos = csv.indexOf(',', lastPos)) != -1) {
-      out.add(csv.substring(lastPos, pos).toInt());
-      lastPos = pos + 1;
+  void runProgram(int i, time_t fireAt, time_t now) {
+    Program& P = progs[i];
+    P.run.lastFire = (uint32_t)fireAt;
+    int baseDuration = P.duration;
+    int actualDuration = baseDuration;
+    // Decyzja i dane do logów z jednego, spójnego odczytu pogody
+    WateringInputs wx = weather ? weather->getWateringInputs() : WateringInputs{100, -1.0f, -1000.0f, -1.0f};
+    int wateringPercent = wx.percent;
+
+    // Dane do logów – BIEŻĄCE, zgodnie z logiką decyzji
+    float rain6h = wx.rain6h;
+    float tNow   = wx.temp;
+    int   hNow   = (int)wx.humidity;
+    P.run.lastPercent = (uint8_t)constrain(wateringPercent, 0, 255);
+
+    // Komunikaty bez sklejania Stringów: log to rekord z liczbami,
+    // Pushover dostaje tekst złożony w buforze na stosie.
+    const bool push = pushover && config && config->getEnablePushover();
+    char msg[160];
+
+    if (wateringPercent == 0) {
+      if (logs) logs->add(LOG_AUTO_CANCELLED, P.zone, Logs::fixed10(rain6h), Logs::fixed10(tNow), hNow, baseDuration);
+      if (push) {
+        snprintf(msg, sizeof(msg), "Automat: odwołano podlewanie (6h=%.1fmm, T=%.1f°C, H=%d%%)", rain6h, tNow, hNow);
+        pushover->send(msg);
+      }
+      P.run.skips++;
+      saveRunState(i);
+      zones->recordAutoRun(P.zone, baseDuration * 60, 0);
+      return;
+    }
+    actualDuration = (actualDuration * wateringPercent) / 100;
+
+    // Jawne komunikaty (BIEŻĄCE T/H)
+    if (logs) logs->add(LOG_AUTO_SCALED, P.zone, Logs::fixed10(rain6h), Logs::fixed10(tNow), hNow, wateringPercent, baseDuration);
+
+    if (push) {
+      snprintf(msg, sizeof(msg), "Automat: strefa %d – %d%% (plan %dmin → %dmin). 6h=%.1fmm, T=%.1f°C, H=%d%%.",
+               P.zone + 1, wateringPercent, baseDuration, actualDuration, rain6h, tNow, hNow);
+      pushover->send(msg);
+    }
+
+    zones->recordAutoRun(P.zone, baseDuration * 60, actualDuration * 60);
+    zones->startZone(P.zone, actualDuration * 60);
+    P.run.lastRun = (uint32_t)now;
+    P.run.runs++;
+    saveRunState(i); // kilkanaście bajtów zamiast całego programs.json
+
+    if (logs) logs->add(LOG_AUTO_START, P.zone, actualDuration);
+    if (push) {
+      snprintf(msg, sizeof(msg), "Start strefy %d na %dmin", P.zone + 1, actualDuration);
+      pushover->send(msg);
     }
-    if (lastPos < (int)csv.length()) out.add(csv.substring(lastPos).toInt());
+  }
+
+  // Wspólne dla dodawania/importu/odczytu z pliku
+  static Program fromJson(JsonVariantConst el) {
+    Program P;
+    P.uid      = el["uid"]      | 0;
+    P.zone     = el["zone"]     | 0;
+    P.start    = parseTime(el["time"] | "06:00");
+    P.duration = el["duration"] | 10;
+    P.days     = parseDays(el["days"], 0x7F);
+    P.active   = el["active"].isNull() ? true : el["active"].as<bool>();
+    return P;
   }
 
 public:
@@ -69,63 +274,102 @@ public:
     logs = l;
     pushover = p;
     config = c;
+    if (!lock) lock = xSemaphoreCreateRecursiveMutex();
+    Guard g(lock);
     loadFromFS();
   }
 
   int size() const { return numProgs; }
 
+  // Po zmianie strefy czasowej terminy trzeba policzyć od nowa
+  void invalidateSchedule() { scheduleDirty = true; version++; }
+
+  uint32_t getVersion() {
+    if (jsonStaleAt && ::time(nullptr) >= jsonStaleAt) { jsonStaleAt = 0; version++; }
+    return version;
+  }
+
   void toJson(JsonDocument& doc) {
+    Guard g(lock);
     JsonArray arr = doc.to<JsonArray>();
+    const time_t now = ::time(nullptr);
+    time_t staleAt = now < MIN_VALID_TIME ? MIN_VALID_TIME : 0; // po NTP dojdzie "next"
+    char buf[16];
     for (int i = 0; i < numProgs; i++) {
+      const Program& P = progs[i];
       JsonObject p = arr.add<JsonObject>();
       p["id"]       = i;
-      p["zone"]     = progs[i].zone;
-      p["time"]     = progs[i].time;
-      p["duration"] = progs[i].duration;
-      p["active"]   = progs[i].active;
+      p["uid"]      = P.uid;
+      p["zone"]     = P.zone;
+      formatTime(P.start, buf);
+      p["time"]     = buf;
+      p["duration"] = P.duration;
+      p["active"]   = P.active;
 
       JsonArray daysArr = p["days"].to<JsonArray>();
-      csvToDaysArray(progs[i].days, daysArr);
+      for (int d = 0; d < 7; d++) if (P.days & (1 << d)) daysArr.add(d);
+
+      if (now >= MIN_VALID_TIME) {
+        time_t next = nextFire(P, now);
+        if (next) p["next"] = (long)next;
+        if (next && (!staleAt || next < staleAt)) staleAt = next;
+      }
+      p["lastRun"]     = P.run.lastRun;
+      p["lastPercent"] = P.run.lastPercent;
+      p["runs"]        = P.run.runs;
+      p["skips"]       = P.run.skips;
     }
+    jsonStaleAt = staleAt;
   }
 
   bool edit(int idx, JsonDocument& doc, bool save=true, bool logIt=true) {
+    Guard g(lock);
     if (idx < 0 || idx >= numProgs) return false;
     Program &P = progs[idx];
     if (doc["zone"].is<uint8_t>())      P.zone = doc["zone"].as<uint8_t>();
-    if (doc["time"].is<const char*>())  P.time = doc["time"].as<const char*>();
+    if (doc["time"].is<const char*>())  P.start = parseTime(doc["time"].as<const char*>());
     if (doc["duration"].is<uint16_t>()) P.duration = doc["duration"].as<uint16_t>();
     if (doc["active"].is<bool>())       P.active = doc["active"].as<bool>();
-    if (doc["days"].is<JsonArray>())    P.days = daysArrayToCsv(doc["days"].as<JsonArray>());
+    if (doc["days"].is<JsonArray>())    P.days = parseDays(doc["days"], P.days);
+    scheduleDirty = true;
 
     if (save) saveToFS();
     if (logIt) {
-      if (logs)     logs->add("Edytowano program strefy " + String(P.zone + 1));
+      if (logs)     logs->add(LOG_PROG_EDITED, P.zone);
       if (pushover) pushover->send("Edytowano program strefy " + String(P.zone + 1));
     }
     return true;
   }
 
   bool remove(int idx, bool logIt=true) {
+    Guard g(lock);
     if (idx < 0 || idx >= numProgs) return false;
+    runStore.release(progs[idx].slot);
     for (int i = idx; i < numProgs - 1; i++) progs[i] = progs[i + 1];
     numProgs--;
+    scheduleDirty = true;
     saveToFS();
     if (logIt) {
-      if (logs)     logs->add("Usunięto program " + String(idx));
+      if (logs)     logs->add(LOG_PROG_REMOVED, -1, idx);
       if (pushover) pushover->send("Usunięto program " + String(idx));
     }
     return true;
   }
 
   void clear() {
+    Guard g(lock);
+    runStore.beginBatch();
+    releaseAll();
+    runStore.endBatch();
     numProgs = 0;
+    scheduleDirty = true;
     saveToFS();
-    if (logs)     logs->add("Wyczyszczono wszystkie programy");
+    if (logs)     logs->add(LOG_PROGS_CLEARED);
     if (pushover) pushover->send("Wyczyszczono wszystkie programy");
   }
 
   void addFromJson(JsonDocument& doc) {
+    Guard g(lock);
     if (doc.is<JsonArray>()) {
       importFromJson(doc);
       return;
@@ -142,56 +386,58 @@ public:
     if (numProgs < MAX_PROGS) {
       Program P;
       P.zone     = doc["zone"].as<uint8_t>();
-      P.time     = doc["time"].as<const char*>();
+      P.start    = parseTime(doc["time"].as<const char*>());
       P.duration = doc["duration"].as<uint16_t>();
-      P.days     = daysArrayToCsv(doc["days"].as<JsonArray>());
+      P.days     = parseDays(doc["days"], 0);
       P.active   = doc["active"].isNull() ? true : doc["active"].as<bool>();
-      P.lastRun  = 0;
 
+      assignIdentity(P);
       progs[numProgs++] = P;
+      scheduleDirty = true;
       saveToFS();
     } else {
-      if (logs)     logs->add("Nie dodano programu – maksymalna liczba programów");
+      if (logs)     logs->add(LOG_PROG_LIMIT);
       if (pushover) pushover->send("Nie dodano programu – maksymalna liczba programów");
     }
   }
 
   void importFromJson(JsonDocument& doc) {
+    Guard g(lock);
     JsonArray arr = doc.as<JsonArray>();
+    runStore.beginBatch(); // jedno otwarcie pliku stanu na cały import
+    releaseAll(); // import = nowe programy, stan uruchomień od zera
     numProgs = 0;
     for (auto el : arr) {
       if (numProgs >= MAX_PROGS) break;
-      Program P;
-      P.zone     = el["zone"]     | 0;
-      P.time     = el["time"]     | "06:00";
-      P.duration = el["duration"] | 10;
-      if (el["days"].is<JsonArray>()) {
-        P.days = daysArrayToCsv(el["days"].as<JsonArray>());
-      } else {
-        P.days = el["days"] | "0,1,2,3,4,5,6";
-      }
-      P.active   = el["active"].isNull() ? true : el["active"].as<bool>();
-      P.lastRun  = 0;
+      Program P = fromJson(el);
+      P.uid = 0; // uid z pliku mógł się powtarzać
+      assignIdentity(P);
       progs[numProgs++] = P;
     }
+    runStore.endBatch();
+    scheduleDirty = true;
     saveToFS();
-    if (logs)     logs->add("Zaimportowano programy");
+    if (logs)     logs->add(LOG_PROGS_IMPORTED);
     if (pushover) pushover->send("Zaimportowano programy");
   }
 
   void saveToFS() {
+    version++;
     File f = LittleFS.open("/programs.json", "w");
     if (!f) return;
     JsonDocument doc;
     JsonArray arr = doc.to<JsonArray>();
+    char t[6], d[16];
     for (int i = 0; i < numProgs; i++) {
       JsonObject p = arr.add<JsonObject>();
+      formatTime(progs[i].start, t);
+      formatDaysCsv(progs[i].days, d);
+      p["uid"]      = progs[i].uid;
       p["zone"]     = progs[i].zone;
-      p["time"]     = progs[i].time;
+      p["time"]     = t;
       p["duration"] = progs[i].duration;
-      p["days"]     = progs[i].days;
+      p["days"]     = d;
       p["active"]   = progs[i].active;
-      p["lastRun"]  = (long)progs[i].lastRun;
     }
     serializeJson(doc, f);
     f.close();
@@ -199,145 +445,93 @@ public:
 
   void loadFromFS() {
     numProgs = 0;
-    if (!LittleFS.exists("/programs.json")) return;
+    scheduleDirty = true;
+    const bool migrate = loadDefinitions();
+    loadRunState();
+    if (migrate) saveToFS();
+  }
+
+  // true = stary format (lastRun w definicji / brak uid) – do przepisania
+  bool loadDefinitions() {
+    if (!LittleFS.exists("/programs.json")) return false;
     File f = LittleFS.open("/programs.json", "r");
-    if (!f) return;
+    if (!f) return false;
     JsonDocument doc;
     if (deserializeJson(doc, f)) {
       f.close();
-      return;
+      return false;
     }
     f.close();
+    bool migrate = false;
     if (doc.is<JsonArray>()) {
       for (auto el : doc.as<JsonArray>()) {
         if (numProgs >= MAX_PROGS) break;
-        Program P;
-        P.zone     = el["zone"]     | 0;
-        P.time     = el["time"]     | "06:00";
-        P.duration = el["duration"] | 10;
-        if (el["days"].is<JsonArray>()) {
-          P.days = daysArrayToCsv(el["days"].as<JsonArray>());
-        } else {
-          P.days = el["days"] | "0,1,2,3,4,5,6";
-        }
-        P.active  = el["active"].isNull() ? true : el["active"].as<bool>();
-        if (!el["lastRun"].isNull()) {
-          P.lastRun = (time_t)(el["lastRun"].as<long>());
-        } else {
-          P.lastRun = 0;
-        }
+        Program P = fromJson(el);
+        if (!el["lastRun"].isNull()) { P.run.lastRun = P.run.lastFire = el["lastRun"].as<uint32_t>(); migrate = true; }
+        for (int i = 0; i < numProgs && P.uid; i++) if (progs[i].uid == P.uid) P.uid = 0;
+        if (!P.uid) migrate = true;
         progs[numProgs++] = P;
       }
     }
+    return migrate;
+  }
+
+  // Dopasowanie rekordów stanu do programów po uid
+  void loadRunState() {
+    uint8_t orphans[ProgramRunStore::SLOTS / 8] = {0};
+    runStore.load([this, &orphans](int slot, const ProgramRunState& r) {
+      for (int i = 0; i < numProgs; i++) {
+        if (progs[i].uid == r.uid && progs[i].slot < 0) {
+          progs[i].slot = slot;
+          progs[i].run = r;
+          runStore.markUsed(slot, true);
+          return;
+        }
+      }
+      orphans[slot / 8] |= 1 << (slot % 8); // program usunięty – zwolnij po odczycie
+    });
+    runStore.beginBatch();
+    for (int s = 0; s < ProgramRunStore::SLOTS; s++) {
+      if (orphans[s / 8] & (1 << (s % 8))) runStore.release(s);
+    }
+    for (int i = 0; i < numProgs; i++) {
+      if (progs[i].slot < 0) assignIdentity(progs[i]);
+    }
+    runStore.endBatch();
   }
 
   void loop() {
     if (!config || !config->getAutoMode()) return;
 
     static unsigned long lastCheck = 0;
-    if (millis() - lastCheck < 10000) return;
+    if (millis() - lastCheck < 1000) return;
     lastCheck = millis();
 
-    time_t now = ::time(nullptr);
-    struct tm nowTm{};
-    localtime_r(&now, &nowTm);
-
-    int today   = nowTm.tm_wday;
-    int nowMins = nowTm.tm_hour * 60 + nowTm.tm_min;
+    const time_t now = ::time(nullptr);
+    if (now < MIN_VALID_TIME) return; // bez NTP nie ma sensownych terminów
+    Guard g(lock);
+    if (scheduleDirty) rebuildSchedule(now);
 
-    for (int i = 0; i < numProgs; i++) {
-      const Program& P = progs[i];
-      if (!P.active) continue;
-
-      bool runToday = containsDay(P.days, today);
-      if (!runToday) continue;
+    while (heapSize > 0 && heap[0].at <= now) {
+      const Fire f = heapPop();
+      Program& P = progs[f.idx];
+      const long late = (long)(now - f.at);
 
-      int pHour    = atoi(P.time.substring(0, 2).c_str());
-      int pMin     = atoi(P.time.substring(3, 5).c_str());
-      int progMins = pHour * 60 + pMin;
-
-      int lastYday = -1;
-      if (P.lastRun != 0) {
-        struct tm lastTm{};
-        localtime_r(&P.lastRun, &lastTm);
-        lastYday = lastTm.tm_yday;
-      }
-
-      if (nowMins == progMins && (P.lastRun == 0 || lastYday != nowTm.tm_yday)) {
-        int baseDuration = P.duration;
-        int actualDuration = baseDuration;
-        int wateringPercent = weather ? weather->getWateringPercent() : 100;
-
-        // Dane do logów – BIEŻĄCE, zgodnie z logiką decyzji
-        float rain6h = weather ? weather->getLast6hRain() : -1.0f;
-        float tNow   = weather ? weather->getCurrentTemp() : -1000.0f;
-        int   hNow   = weather ? (int)weather->getCurrentHumidity() : -1;
-
-        if (wateringPercent == 0) {
-          if (logs) logs->add(
-            String("Podlewanie odwołane – warunki pogodowe. ")
-            + "6h=" + String(rain6h, 1) + "mm, "
-            + "T=" + String(tNow, 1) + "°C, "
-            + "H=" + String(hNow) + "%, "
-            + "plan=" + String(baseDuration) + "min → 0min"
-          );
-          if (pushover && config && config->getEnablePushover())
-            pushover->send(
-              String("Automat: odwołano podlewanie (6h=") + String(rain6h,1) + "mm, "
-              "T=" + String(tNow,1) + "°C, H=" + String(hNow) + "%)"
-            );
-          continue;
+      if ((time_t)P.run.lastFire < f.at) {
+        if (late <= graceSec()) {
+          runProgram(f.idx, f.at, now);
         } else {
-          actualDuration = (actualDuration * wateringPercent) / 100;
-
-          // Jawne komunikaty (BIEŻĄCE T/H)
-          if (logs) {
-            logs->add(
-              String("Automat: Strefa ") + String(P.zone + 1)
-              + ": bazowo " + String(baseDuration) + "min, "
-              + "współczynnik " + String(wateringPercent) + "% → "
-              + String(actualDuration) + "min "
-              + "(6h=" + String(rain6h, 1) + "mm, "
-              + "T=" + String(tNow, 1) + "°C, "
-              + "H=" + String(hNow) + "%)"
-            );
-          }
-
-          if (pushover && config && config->getEnablePushover()) {
-            String detail = String("6h=") + String(rain6h,1) + "mm, T=" + String(tNow,1) + "°C, H=" + String(hNow) + "%.";
-            if (wateringPercent == 80) {
-              pushover->send(
-                String("Automat: strefa ") + String(P.zone + 1) + " – 80% "
-                "(plan " + String(baseDuration) + "min → " + String(actualDuration) + "min). " + detail
-              );
-            } else if (wateringPercent == 120) {
-              pushover->send(
-                String("Automat: strefa ") + String(P.zone + 1) + " – 120% "
-                "(plan " + String(baseDuration) + "min → " + String(actualDuration) + "min). " + detail
-              );
-            } else if (wateringPercent == 100) {
-              pushover->send(
-                String("Automat: strefa ") + String(P.zone + 1) + " – 100% "
-                "(plan " + String(baseDuration) + "min → " + String(actualDuration) + "min). " + detail
-              );
-            } else {
-              pushover->send(
-                String("Automat: strefa ") + String(P.zone + 1) + " – " + String(wateringPercent) + "% "
-                "(plan " + String(baseDuration) + "min → " + String(actualDuration) + "min). " + detail
-              );
-            }
-          }
-        }
-
-        zones->startZone(P.zone, actualDuration * 60);
-        progs[i].lastRun = now;
-        saveToFS();
-
-        if (logs) logs->add("Automat: Start strefy " + String(P.zone + 1) + " na " + String(actualDuration) + "min");
-        if (pushover && config && config->getEnablePushover()) {
-          pushover->send("Start strefy " + String(P.zone + 1) + " na " + String(actualDuration) + "min");
+          P.run.lastFire = (uint32_t)f.at;
+          P.run.skips++;
+          saveRunState(f.idx);
+          if (logs) logs->add(LOG_AUTO_MISSED, P.zone, (int16_t)min(late / 60, 32767L));
         }
       }
+      // Następny termin po tym właśnie obsłużonym; po długim przestoju – po "teraz",
+      // żeby zaległe wystąpienia nie odpalały się seriami
+      const time_t next = nextFire(P, (f.at > now - 60 ? f.at : now) + 60);
+      if (next) heapPush(next, f.idx);
     }
+    checkedUntil = now;
   }
 };
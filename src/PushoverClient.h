@@ -1,25 +1,132 @@
 #pragma once
-#include <WiFiClientSecure.h>
+#include <Arduino.h>
 #include <HTTPClient.h>
+#include <ArduinoJson.h>
+#include <atomic>
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/task.h"
 #include "Settings.h"
+#include "HttpsPool.h"
 
+// Transport wiadomości: zwraca kod HTTP (200 = OK). Domyślnie HTTPS POST do
+// api.pushover.net przez wspólną pulę połączeń; na potrzeby testów można
+// podmienić przez setTransport() np. na funkcję zapisującą wiadomości do bufora.
+typedef int (*PushoverTransport)(const char* token, const char* user, const char* msg, void* ctx);
+
+// send() tylko wrzuca wiadomość do kolejki o stałym rozmiarze – wysyłką
+// (TLS + POST) zajmuje się osobne zadanie FreeRTOS, więc loop() i handlery
+// HTTP nigdy nie czekają na sieć. Pełna kolejka = wiadomość odrzucona (licznik).
 class PushoverClient {
+  static const int    QUEUE_LEN  = 8;
+  static const size_t TEXT_MAX   = 256;
+  static const size_t CRED_MAX   = 48;
+  static const uint32_t TASK_STACK = 8192;
+
+  // Dane logowania kopiujemy do wiadomości w chwili send(), żeby zadanie
+  // nie czytało Stringów z Settings równolegle z ich zapisem z WWW.
+  struct Message {
+    char token[CRED_MAX];
+    char user[CRED_MAX];
+    char text[TEXT_MAX];
+  };
+
   Settings* settings;
+  HttpsPool* https;
+  QueueHandle_t queue = nullptr;
+  TaskHandle_t  task  = nullptr;
+  PushoverTransport transport = nullptr; // nullptr = postHttps()
+  void* transportCtx = nullptr;
+
+  std::atomic<uint32_t> enqueued{0}, sent{0}, failed{0}, dropped{0}, truncated{0};
+  std::atomic<uint32_t> lastSendMs{0}, maxSendMs{0};
+
+  int postHttps(const Message& m) {
+    HttpsPool::Lease conn;
+    if (!https || !https->lease("api.pushover.net", conn)) return HTTPC_ERROR_CONNECTION_REFUSED;
+    String body = String("token=") + m.token + "&user=" + m.user + "&message=" + m.text;
+    int code = https->send(conn, "https://api.pushover.net/1/messages.json", "POST", body,
+                           "application/x-www-form-urlencoded");
+    if (code > 0) {
+      HttpBodyStream resp(conn.http());
+      resp.drain(); // odpowiedź nas nie interesuje, ale musi zejść z gniazda
+      if (!resp.reusable()) conn.invalidate();
+    } else {
+      conn.invalidate();
+    }
+    conn.http().end();
+    return code;
+  }
+
+  static void taskEntry(void* arg) {
+    PushoverClient* self = static_cast<PushoverClient*>(arg);
+    Message m;
+    for (;;) {
+      if (xQueueReceive(self->queue, &m, portMAX_DELAY) != pdTRUE) continue;
+      unsigned long t0 = millis();
+      int code = self->transport ? self->transport(m.token, m.user, m.text, self->transportCtx)
+                                 : self->postHttps(m);
+      uint32_t dt = (uint32_t)(millis() - t0);
+      self->lastSendMs = dt;
+      if (dt > self->maxSendMs) self->maxSendMs = dt;
+      if (code == 200) self->sent++;
+      else {
+        self->failed++;
+        Serial.printf("[Pushover] Błąd wysyłki, kod HTTP: %d\n", code);
+      }
+    }
+  }
+
+  void ensureWorker() {
+    if (!queue) queue = xQueueCreate(QUEUE_LEN, sizeof(Message));
+    if (queue && !task) {
+      xTaskCreatePinnedToCore(taskEntry, "pushover", TASK_STACK, this, 1, &task, 0);
+    }
+  }
+
+  static bool copyField(char* dst, size_t cap, const String& src) {
+    strlcpy(dst, src.c_str(), cap);
+    return src.length() < cap;
+  }
+
 public:
-  PushoverClient(Settings* s) : settings(s) {}
-  void begin() {}
-  void send(const String& msg) {
+  PushoverClient(Settings* s, HttpsPool* pool = nullptr) : settings(s), https(pool) {}
+
+  void begin() { ensureWorker(); }
+
+  void setTransport(PushoverTransport t, void* ctx = nullptr) {
+    transport = t;
+    transportCtx = ctx;
+  }
+
+  void send(const String& msg) { send(msg.c_str()); }
+
+  void send(const char* msg) {
     if (!settings) return;
     if (!settings->getEnablePushover()) return;
     if (settings->getPushoverUser() == "" || settings->getPushoverToken() == "") return;
 
-    WiFiClientSecure client;
-    client.setInsecure();
-    HTTPClient http;
-    http.begin(client, "https://api.pushover.net/1/messages.json");
-    http.addHeader("Content-Type", "application/x-www-form-urlencoded");
-    String body = "token=" + settings->getPushoverToken() + "&user=" + settings->getPushoverUser() + "&message=" + msg;
-    http.POST(body);
-    http.end();
+    ensureWorker();
+    if (!queue) { dropped++; return; }
+
+    Message m;
+    copyField(m.token, sizeof(m.token), settings->getPushoverToken());
+    copyField(m.user, sizeof(m.user), settings->getPushoverUser());
+    if (strlcpy(m.text, msg, sizeof(m.text)) >= sizeof(m.text)) truncated++;
+
+    if (xQueueSend(queue, &m, 0) == pdTRUE) enqueued++;
+    else dropped++; // kolejka pełna – nie blokujemy wywołującego
+  }
+
+  void toJson(JsonDocument& doc) const {
+    doc["queue_len"]   = QUEUE_LEN;
+    doc["queued"]      = queue ? (uint32_t)uxQueueMessagesWaiting(queue) : 0;
+    doc["enqueued"]    = enqueued.load();
+    doc["sent"]        = sent.load();
+    doc["failed"]      = failed.load();
+    doc["dropped"]     = dropped.load();
+    doc["truncated"]   = truncated.load();
+    doc["last_send_ms"] = lastSendMs.load();
+    doc["max_send_ms"]  = maxSendMs.load();
   }
 };
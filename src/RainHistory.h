@@ -20,7 +20,8 @@ public:
         loadFromFS();
     }
 
-    void addRainMeasurement(float rain_mm) {
+    // persist = false: tylko w RAM, zapis później przez save() (np. poza blokadą)
+    void addRainMeasurement(float rain_mm, bool persist = true) {
         time_t now = time(nullptr);
 
         // Jeśli ostatni rekord jest z tej samej godziny, zsumuj opady
@@ -34,7 +35,7 @@ public:
                 last_tm.tm_hour == now_tm.tm_hour) {
                 records[count-1].rain_mm += rain_mm;
                 records[count-1].timestamp = now;
-                saveToFS();
+                if (persist) saveToFS();
                 return;
             }
         }
@@ -54,9 +55,15 @@ public:
         // Usuń stare rekordy starsze niż 6 godzin
         cleanupOld();
 
-        saveToFS();
+        if (persist) saveToFS();
     }
 
+    void save() { saveToFS(); }
+
+    int size() const { return count; }
+    time_t timeAt(int i) const { return records[i].timestamp; }
+    float rainAt(int i) const { return records[i].rain_mm; }
+
     float getLast6hRain() const {
         float sum = 0.0f;
         time_t now = time(nullptr);
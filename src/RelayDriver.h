@@ -0,0 +1,209 @@
+#pragma once
+#include <Arduino.h>
+#include <SPI.h>
+#include <Wire.h>
+
+// Wyjścia zaworów. Zones trzyma stan wszystkich stref jako maskę bitową
+// (bit i = strefa i) i przy każdej zmianie woła apply(maska) – sterownik
+// sam decyduje, jak ją wystawić: GPIO pin po pinie, łańcuch 74HC595 jednym
+// zapisem SPI + zatrzaśnięcie, MCP23017 jednym zapisem OLATA/OLATB na układ.
+class RelayDriver {
+public:
+  static const int MAX_OUTPUTS = 48;
+
+  virtual ~RelayDriver() {}
+  // false = sprzęt niedostępny; count może zostać obcięte do capacity()
+  virtual bool begin(int count) = 0;
+  // false = nie wszystkie wyjścia przyjęły stan; Zones ponawia apply()
+  virtual bool apply(uint64_t mask) = 0;
+  virtual int capacity() const = 0;
+  virtual const char* name() const = 0;
+};
+
+// Bezpośrednio z pinów ESP32 (domyślnie 8 stref jak dotąd)
+class GpioRelayDriver : public RelayDriver {
+  static const int MAX_PINS = 16;
+  int pins[MAX_PINS] = {13,12,14,27,26,25,33,32};
+  int numPins = 8;
+  int count = 0;
+  uint64_t last = 0;
+
+public:
+  // pinList = nullptr → domyślne piny
+  explicit GpioRelayDriver(const int* pinList = nullptr, int n = 0) {
+    if (pinList && n > 0) {
+      numPins = min(n, MAX_PINS);
+      for (int i = 0; i < numPins; i++) pins[i] = pinList[i];
+    }
+  }
+
+  bool begin(int n) override {
+    count = min(n, numPins);
+    for (int i = 0; i < count; i++) {
+      pinMode(pins[i], OUTPUT);
+      digitalWrite(pins[i], LOW);
+    }
+    last = 0;
+    return true;
+  }
+
+  bool apply(uint64_t mask) override {
+    const uint64_t diff = mask ^ last;
+    for (int i = 0; i < count; i++) {
+      if (diff & (1ULL << i)) digitalWrite(pins[i], (mask >> i) & 1 ? HIGH : LOW);
+    }
+    last = mask;
+    return true;
+  }
+
+  int capacity() const override { return numPins; }
+  const char* name() const override { return "gpio"; }
+};
+
+// Łańcuch 74HC595 na sprzętowym SPI: cała maska wychodzi jednym
+// transferem, potem impuls RCLK przełącza wszystkie wyjścia naraz.
+// Pierwszy rejestr w łańcuchu (przy MCU) = strefy 1..8.
+class Hc595RelayDriver : public RelayDriver {
+  int dataPin, clockPin, latchPin, oePin;
+  int bytes = 0;
+  SPIClass* spi = nullptr;
+
+public:
+  Hc595RelayDriver(int data, int clock, int latch, int oe = -1)
+    : dataPin(data), clockPin(clock), latchPin(latch), oePin(oe) {}
+
+  bool begin(int n) override {
+    bytes = (min(n, MAX_OUTPUTS) + 7) / 8;
+    pinMode(latchPin, OUTPUT);
+    digitalWrite(latchPin, LOW);
+    if (oePin >= 0) { pinMode(oePin, OUTPUT); digitalWrite(oePin, HIGH); }
+    spi = &SPI;
+    spi->begin(clockPin, -1, dataPin, -1);
+    apply(0);
+    if (oePin >= 0) digitalWrite(oePin, LOW); // wyjścia aktywne dopiero po wyzerowaniu
+    return true;
+  }
+
+  bool apply(uint64_t mask) override {
+    if (!spi) return false;
+    uint8_t buf[(MAX_OUTPUTS + 7) / 8];
+    // Ostatni bajt wysyłany jako pierwszy – przesunie się najdalej w łańcuchu
+    for (int i = 0; i < bytes; i++) buf[i] = (uint8_t)(mask >> (8 * (bytes - 1 - i)));
+    spi->beginTransaction(SPISettings(4000000, MSBFIRST, SPI_MODE0));
+    spi->transferBytes(buf, nullptr, bytes);
+    spi->endTransaction();
+    digitalWrite(latchPin, HIGH);
+    digitalWrite(latchPin, LOW);
+    return true;
+  }
+
+  int capacity() const override { return MAX_OUTPUTS; }
+  const char* name() const override { return "hc595"; }
+};
+
+// MCP23017 (I2C, 16 wyjść na układ, adresy kolejno od baseAddr).
+// Zmiana stanu = jeden zapis OLATA+OLATB (autoinkrementacja adresu
+// rejestru) tylko do układów, których bajty się zmieniły. Układ, do którego
+// zapis się nie udał, ma stan nieznany – następne apply() pisze go zawsze.
+class Mcp23017RelayDriver : public RelayDriver {
+  static const uint8_t REG_IODIRA = 0x00;
+  static const uint8_t REG_OLATA  = 0x14;
+  static const int MAX_CHIPS = (MAX_OUTPUTS + 15) / 16;
+
+  int sdaPin, sclPin;
+  uint8_t baseAddr;
+  int chips = 0;
+  uint16_t last[MAX_CHIPS] = {0};
+  uint8_t failedChips = 0; // bit c = ostatni zapis do układu c nieudany
+  bool ok = false;
+
+  bool writePair(uint8_t addr, uint8_t reg, uint16_t v) {
+    Wire.beginTransmission(addr);
+    Wire.write(reg);
+    Wire.write((uint8_t)(v & 0xFF));
+    Wire.write((uint8_t)(v >> 8));
+    return Wire.endTransmission() == 0;
+  }
+
+public:
+  Mcp23017RelayDriver(int sda, int scl, uint8_t addr = 0x20)
+    : sdaPin(sda), sclPin(scl), baseAddr(addr) {}
+
+  bool begin(int n) override {
+    chips = (min(n, MAX_OUTPUTS) + 15) / 16;
+    Wire.begin(sdaPin, sclPin, 400000);
+    ok = true;
+    for (int c = 0; c < chips; c++) {
+      // Najpierw zatrzaski na 0, dopiero potem kierunek = wyjście
+      if (!writePair(baseAddr + c, REG_OLATA, 0) || !writePair(baseAddr + c, REG_IODIRA, 0)) {
+        Serial.printf("[Zones] MCP23017 0x%02X nie odpowiada!\n", baseAddr + c);
+        ok = false;
+      }
+      last[c] = 0;
+    }
+    return ok;
+  }
+
+  bool apply(uint64_t mask) override {
+    for (int c = 0; c < chips; c++) {
+      const uint16_t v = (uint16_t)(mask >> (16 * c));
+      const uint8_t bit = 1 << c;
+      if (v == last[c] && !(failedChips & bit)) continue;
+      if (writePair(baseAddr + c, REG_OLATA, v)) {
+        if (failedChips & bit) Serial.printf("[Zones] MCP23017 0x%02X znowu odpowiada\n", baseAddr + c);
+        failedChips &= ~bit;
+        last[c] = v;
+      } else {
+        if (!(failedChips & bit)) Serial.printf("[Zones] MCP23017 0x%02X: błąd zapisu OLAT (0x%04X)!\n", baseAddr + c, v);
+        failedChips |= bit;
+      }
+    }
+    return failedChips == 0;
+  }
+
+  int capacity() const override { return MAX_OUTPUTS; }
+  const char* name() const override { return "mcp23017"; }
+};
+
+// Bez sprzętu: zapamiętuje maskę i liczy zapisy (testy na hoście, stanowisko
+// bez przekaźników). Czas przełączenia mierzy Zones wokół apply().
+class MockRelayDriver : public RelayDriver {
+  uint64_t state = 0;
+  uint32_t writes = 0;
+
+public:
+  bool begin(int) override { state = 0; writes = 0; return true; }
+  bool apply(uint64_t mask) override { state = mask; writes++; return true; }
+  int capacity() const override { return MAX_OUTPUTS; }
+  const char* name() const override { return "mock"; }
+
+  uint64_t getState() const { return state; }
+  uint32_t getWrites() const { return writes; }
+};
+
+// Fabryka wg ustawień: type = gpio|hc595|mcp23017|mock,
+// pins (CSV): gpio – lista pinów stref; hc595 – data,clock,latch[,oe];
+// mcp23017 – sda,scl[,adres]. Pusty = domyślne.
+inline RelayDriver* createRelayDriver(const String& type, const String& pins) {
+  int v[16]; int n = 0;
+  int from = 0;
+  while (n < 16 && from < (int)pins.length()) {
+    int comma = pins.indexOf(',', from);
+    if (comma < 0) comma = pins.length();
+    String part = pins.substring(from, comma);
+    part.trim();
+    if (part.length()) v[n++] = (int)strtol(part.c_str(), nullptr, 0); // "0x21" też
+    from = comma + 1;
+  }
+
+  if (type == "hc595") {
+    return n >= 3 ? new Hc595RelayDriver(v[0], v[1], v[2], n >= 4 ? v[3] : -1)
+                  : new Hc595RelayDriver(23, 18, 5);
+  }
+  if (type == "mcp23017") {
+    return n >= 2 ? new Mcp23017RelayDriver(v[0], v[1], n >= 3 ? (uint8_t)v[2] : 0x20)
+                  : new Mcp23017RelayDriver(21, 22);
+  }
+  if (type == "mock") return new MockRelayDriver();
+  return new GpioRelayDriver(n ? v : nullptr, n);
+}
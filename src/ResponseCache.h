@@ -0,0 +1,89 @@
+#pragma once
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <ESPAsyncWebServer.h>
+#include <esp_random.h>
+#include <memory>
+
+// Zserializowana odpowiedź JSON dla rzadko zmienianych danych (pogoda,
+// programy, ustawienia, nazwy stref). Klucz = licznik wersji modułu: dopóki
+// się nie zmieni, GET dostaje gotowy bufor bez ArduinoJson, a klient z
+// If-None-Match: samo 304. ETag zawiera losowy identyfikator startu, więc po
+// restarcie (liczniki od zera) przeglądarka nie dostanie starego 304.
+// Handlery AsyncWebServer działają w jednym zadaniu (async_tcp) – bez blokady;
+// treść jest we współdzielonym wskaźniku, bo wysyłka trwa dłużej niż handler.
+class CachedJson {
+  const char* name;
+  std::shared_ptr<String> body;
+  uint32_t key = 0;
+  bool valid = false;
+  char etag[24] = {0};
+  uint32_t builds = 0, hits = 0, notModified = 0;
+
+  // Lista wszystkich buforów dla /api/cache/stats
+  static const int MAX_CACHES = 16;
+  struct Registry { CachedJson* items[MAX_CACHES]; int count; };
+  static Registry& registry() {
+    static Registry r = {{nullptr}, 0};
+    return r;
+  }
+
+  static uint32_t bootId() {
+    static const uint32_t id = esp_random();
+    return id;
+  }
+
+public:
+  explicit CachedJson(const char* n) : name(n) {
+    Registry& r = registry();
+    if (r.count < MAX_CACHES) r.items[r.count++] = this;
+  }
+
+  // build(JsonDocument&) woła się tylko, gdy key różni się od zapamiętanego
+  template <typename Build>
+  void send(AsyncWebServerRequest* req, uint32_t version, Build build) {
+    if (!valid || version != key) {
+      JsonDocument doc;
+      build(doc);
+      auto fresh = std::make_shared<String>();
+      serializeJson(doc, *fresh);
+      body = fresh;
+      key = version;
+      valid = true;
+      snprintf(etag, sizeof(etag), "\"%08lx-%lx\"", (unsigned long)bootId(), (unsigned long)key);
+      builds++;
+    } else {
+      hits++;
+    }
+
+    AsyncWebServerResponse* r;
+    if (req->hasHeader("If-None-Match") && req->header("If-None-Match") == etag) {
+      r = req->beginResponse(304);
+      notModified++;
+    } else {
+      std::shared_ptr<String> b = body;
+      r = req->beginResponse("application/json", b->length(),
+        [b](uint8_t* buf, size_t maxLen, size_t index) -> size_t {
+          size_t n = b->length() - index;
+          if (n > maxLen) n = maxLen;
+          memcpy(buf, b->c_str() + index, n);
+          return n;
+        });
+    }
+    r->addHeader("ETag", etag);
+    r->addHeader("Cache-Control", "no-cache"); // zawsze pytaj, ale z ETagiem
+    req->send(r);
+  }
+
+  static void toJson(JsonDocument& doc) {
+    const Registry& r = registry();
+    for (int i = 0; i < r.count; i++) {
+      const CachedJson* c = r.items[i];
+      JsonObject o = doc[c->name].to<JsonObject>();
+      o["builds"] = c->builds;
+      o["hits"] = c->hits;
+      o["notModified"] = c->notModified;
+      o["bytes"] = c->body ? c->body->length() : 0;
+    }
+  }
+};
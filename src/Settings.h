@@ -24,6 +24,14 @@ class Settings {
 
   // Automatyka
   bool   autoMode = true;
+  int    scheduleGraceMin = 15; // o ile minut program może wystartować później (np. po restarcie)
+  int    maxConcurrentZones = 1;  // ile stref może podlewać naraz
+  float  supplyCapacity = 0;      // wydajność zasilania, l/min (0 = bez limitu)
+
+  // Wyjścia stref (zmiana działa po restarcie)
+  int    zoneCount = 8;               // 1..48
+  String relayDriver = "gpio";        // gpio | hc595 | mcp23017 | mock
+  String relayPins = "";              // CSV, znaczenie zależy od sterownika (pusty = domyślne)
 
   // Strefa czasowa
   String timezone = "Europe/Warsaw";
@@ -32,6 +40,8 @@ class Settings {
   bool   enableWeatherApi = true;
   int    weatherUpdateIntervalMin = 60; // minuty
 
+  uint32_t version = 0; // rośnie przy każdej zmianie (cache /api/settings)
+
 public:  // GETTERY (używane przez Config/MQTT/Weather/itp.)
   String getSSID() { return ssid; }
   String getPass() { return pass; }
@@ -52,9 +62,16 @@ public:  // GETTERY (używane przez Config/MQTT/Weather/itp.)
   String getMqttTopicBase() { return mqttTopicBase; }
 
   bool   getAutoMode() { return autoMode; }
+  int    getScheduleGraceMin() { return scheduleGraceMin; }
+  int    getMaxConcurrentZones() { return maxConcurrentZones; }
+  float  getSupplyCapacity() { return supplyCapacity; }
+
+  int    getZoneCount() { return zoneCount; }
+  String getRelayDriver() { return relayDriver; }
+  String getRelayPins() { return relayPins; }
 
   String getTimezone() { return timezone; }
-  void   setTimezone(const String& tz) { timezone = tz; }
+  void   setTimezone(const String& tz) { timezone = tz; version++; }
 
   bool   getEnableWeatherApi() { return enableWeatherApi; }
   int    getWeatherUpdateIntervalMin() { return weatherUpdateIntervalMin; }
@@ -81,6 +98,13 @@ public:  // GETTERY (używane przez Config/MQTT/Weather/itp.)
     mqttTopicBase = prefs.getString("mqttTopicBase", "sprinkler");
 
     autoMode  = prefs.getBool("autoMode", true);
+    scheduleGraceMin = prefs.getInt("schedGraceMin", 15);
+    maxConcurrentZones = prefs.getInt("maxZonesOn", 1);
+    supplyCapacity   = prefs.getFloat("supplyCap", 0);
+
+    zoneCount   = prefs.getInt("zoneCount", 8);
+    relayDriver = prefs.getString("relayDriver", "gpio");
+    relayPins   = prefs.getString("relayPins", "");
 
     timezone  = prefs.getString("timezone", "Europe/Warsaw");
 
@@ -89,7 +113,10 @@ public:  // GETTERY (używane przez Config/MQTT/Weather/itp.)
     prefs.end();
   }
 
+  uint32_t getVersion() { return version; }
+
   void saveFromJson(JsonDocument& doc) {
+    version++;
     prefs.begin("ews", false);
 
     // WiFi
@@ -116,6 +143,26 @@ public:  // GETTERY (używane przez Config/MQTT/Weather/itp.)
 
     // Automatyka
     if (doc["autoMode"].is<bool>()) { autoMode = doc["autoMode"].as<bool>(); prefs.putBool("autoMode", autoMode); }
+    if (doc["scheduleGraceMin"].is<int>()) {
+      scheduleGraceMin = constrain(doc["scheduleGraceMin"].as<int>(), 0, 720);
+      prefs.putInt("schedGraceMin", scheduleGraceMin);
+    }
+    if (doc["maxConcurrentZones"].is<int>()) {
+      maxConcurrentZones = constrain(doc["maxConcurrentZones"].as<int>(), 1, 48);
+      prefs.putInt("maxZonesOn", maxConcurrentZones);
+    }
+    if (doc["supplyCapacity"].is<float>()) {
+      supplyCapacity = max(0.0f, doc["supplyCapacity"].as<float>());
+      prefs.putFloat("supplyCap", supplyCapacity);
+    }
+
+    // Wyjścia stref
+    if (doc["zoneCount"].is<int>()) {
+      zoneCount = constrain(doc["zoneCount"].as<int>(), 1, 48);
+      prefs.putInt("zoneCount", zoneCount);
+    }
+    if (doc["relayDriver"].is<const char*>()) { relayDriver = doc["relayDriver"].as<const char*>(); prefs.putString("relayDriver", relayDriver); }
+    if (doc["relayPins"].is<const char*>())   { relayPins = doc["relayPins"].as<const char*>(); prefs.putString("relayPins", relayPins); }
 
     // Strefa czasowa
     if (doc["timezone"].is<const char*>()) { timezone = doc["timezone"].as<const char*>(); prefs.putString("timezone", timezone); }
@@ -155,6 +202,14 @@ public:  // GETTERY (używane przez Config/MQTT/Weather/itp.)
 
     // Automatyka
     doc["autoMode"] = autoMode;
+    doc["scheduleGraceMin"] = scheduleGraceMin;
+    doc["maxConcurrentZones"] = maxConcurrentZones;
+    doc["supplyCapacity"] = supplyCapacity;
+
+    // Wyjścia stref
+    doc["zoneCount"]   = zoneCount;
+    doc["relayDriver"] = relayDriver;
+    doc["relayPins"]   = relayPins;
 
     // Strefa czasowa
     doc["timezone"] = timezone;
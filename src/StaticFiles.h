@@ -0,0 +1,95 @@
+#pragma once
+#include <Arduino.h>
+#include <ESPAsyncWebServer.h>
+#include <LittleFS.h>
+
+// Pliki z LittleFS z obsługą:
+//  - rodzeństwa ".gz" (Content-Encoding: gzip, gdy klient je przyjmuje),
+//  - ETag = rozmiar + czas zapisu pliku; If-None-Match → 304 bez czytania treści,
+//  - Cache-Control podanego przez wywołującego (np. immutable dla /assets/*).
+// Metadane (czy jest .gz, ETagi) trzymane w małym cache w RAM, więc ciepłe
+// odświeżenie PWA nie sięga do flasha; invalidate() po uploadzie/kasowaniu.
+// Handlery AsyncWebServer działają w jednym zadaniu (async_tcp) – bez blokady.
+class StaticFiles {
+  static const int CACHE_SIZE = 16;
+
+  struct Entry {
+    String path;        // pusty = wolny wpis
+    bool plain = false; // istnieje plik bez kompresji
+    bool gz = false;    // istnieje path + ".gz"
+    String etagPlain, etagGz;
+  };
+
+  Entry cache[CACHE_SIZE];
+  int nextSlot = 0;
+
+  static String etagOf(const String& path, const char* variant) {
+    File f = LittleFS.open(path, "r");
+    if (!f) return "";
+    char buf[48];
+    snprintf(buf, sizeof(buf), "\"%x-%lx%s\"", (unsigned)f.size(), (unsigned long)f.getLastWrite(), variant);
+    f.close();
+    return String(buf);
+  }
+
+  const Entry* lookup(const String& path) {
+    for (int i = 0; i < CACHE_SIZE; i++) if (cache[i].path == path) return &cache[i];
+
+    Entry e;
+    e.path = path;
+    const String gzPath = path + ".gz";
+    e.plain = LittleFS.exists(path);
+    e.gz = LittleFS.exists(gzPath);
+    if (!e.plain && !e.gz) return nullptr;
+    if (e.plain) e.etagPlain = etagOf(path, "");
+    if (e.gz) e.etagGz = etagOf(gzPath, "-gz");
+
+    Entry& slot = cache[nextSlot];
+    nextSlot = (nextSlot + 1) % CACHE_SIZE;
+    slot = e;
+    return &slot;
+  }
+
+  static bool acceptsGzip(AsyncWebServerRequest* req) {
+    if (!req->hasHeader("Accept-Encoding")) return false;
+    return req->header("Accept-Encoding").indexOf("gzip") >= 0;
+  }
+
+public:
+  static const char* contentTypeOf(const String& path) {
+    if (path.endsWith(".html")) return "text/html";
+    if (path.endsWith(".js"))   return "application/javascript";
+    if (path.endsWith(".css"))  return "text/css";
+    if (path.endsWith(".json")) return "application/json";
+    if (path.endsWith(".png"))  return "image/png";
+    if (path.endsWith(".svg"))  return "image/svg+xml";
+    if (path.endsWith(".ico"))  return "image/x-icon";
+    return "application/octet-stream";
+  }
+
+  void invalidate() {
+    for (int i = 0; i < CACHE_SIZE; i++) cache[i] = Entry();
+  }
+
+  // false = brak pliku (wywołujący decyduje, co dalej)
+  bool send(AsyncWebServerRequest* req, const String& path, const char* contentType, const char* cacheControl) {
+    const Entry* e = lookup(path);
+    if (!e) return false;
+    const bool useGz = e->gz && (!e->plain || acceptsGzip(req));
+    const String& etag = useGz ? e->etagGz : e->etagPlain;
+
+    AsyncWebServerResponse* r;
+    if (req->hasHeader("If-None-Match") && req->header("If-None-Match") == etag) {
+      r = req->beginResponse(304);
+    } else {
+      // Typ podany wprost – inaczej AsyncFileResponse wziąłby go z ".gz"
+      r = req->beginResponse(LittleFS, useGz ? path + ".gz" : path, contentType);
+      if (useGz) r->addHeader("Content-Encoding", "gzip");
+    }
+    r->addHeader("ETag", etag);
+    r->addHeader("Cache-Control", cacheControl);
+    if (e->gz && e->plain) r->addHeader("Vary", "Accept-Encoding");
+    req->send(r);
+    return true;
+  }
+};
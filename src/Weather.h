@@ -1,17 +1,25 @@
 #pragma once
 #include <Arduino.h>
-#include <WiFiClientSecure.h>
 #include <HTTPClient.h>
 #include <ArduinoJson.h>
+#include <LittleFS.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
 #include "RainHistory.h"
-
-class Weather {
-  String apiKey, location;
-
+#include "WeatherHistory.h"
+#include "Chart.h"
+#include "HttpsPool.h"
+
+// Kompletny, niezmienny po publikacji zestaw danych pogodowych.
+// Zadanie "weather" buduje nową kopię i podmienia ją pod blokadą,
+// czytelnicy (loop, WWW, MQTT) zawsze dostają spójną kopię.
+struct WeatherSnapshot {
   // Dane aktualne
   float temp = 0, feels_like = 0, temp_min = 0, temp_max = 0;
   float humidity = 0, pressure = 0, wind = 0, wind_deg = 0, clouds = 0, visibility = 0;
-  String weather_desc = "", icon = "";
+  char  weather_desc[64] = "";
+  char  icon[8] = "";
   float rain = 0;
 
   // Prognozy
@@ -20,11 +28,70 @@ class Weather {
   float humidity_tomorrow_max = 0; // maksymalna prognozowana wilgotność na jutro
 
   // Wschód/zachód
-  String sunrise = "", sunset = "";
+  char sunrise[6] = "", sunset[6] = "";
 
-  // Sterowanie
+  uint32_t version = 0; // rośnie przy każdej publikacji
+  uint32_t updated = 0; // UNIX time ostatniej udanej aktualizacji (0 = nigdy)
+};
+
+// Wejścia decyzji o podlewaniu odczytane jednym, spójnym odczytem
+struct WateringInputs {
+  int   percent;
+  float rain6h;
+  float temp;
+  float humidity;
+};
+
+// Koszt parsowania jednej odpowiedzi OWM (czas i zajęta sterta)
+struct ParseStats {
+  uint32_t count = 0;
+  uint32_t lastUs = 0, maxUs = 0;
+  uint32_t lastHeap = 0, maxHeap = 0;
+  int32_t  lastBodyBytes = -1; // Content-Length, -1 gdy nieznany
+
+  void record(uint32_t us, uint32_t heap, int32_t body) {
+    count++;
+    lastUs = us;     if (us > maxUs) maxUs = us;
+    lastHeap = heap; if (heap > maxHeap) maxHeap = heap;
+    lastBodyBytes = body;
+  }
+
+  void toJson(JsonObject o) const {
+    o["count"] = count;
+    o["last_us"] = lastUs;
+    o["max_us"] = maxUs;
+    o["last_heap"] = lastHeap;
+    o["max_heap"] = maxHeap;
+    o["last_body_bytes"] = lastBodyBytes;
+  }
+};
+
+class Weather {
+  static constexpr const char* OWM_HOST = "api.openweathermap.org";
+  HttpsPool* https = nullptr; // wspólne połączenia HTTPS (main.cpp)
+
+  // Konfiguracja (zapisywana z WWW/MQTT, czytana przez zadanie) – pod blokadą
+  String apiKey, location;
   bool   enabled = true;
   unsigned long intervalMs = 60UL * 60UL * 1000UL;  // domyślnie 1h
+  bool   settingsChanged = true;
+
+  // Opublikowany stan – pod blokadą
+  WeatherSnapshot current;
+  RainHistory rainHistory; // historia opadów (rolling 6h) – tylko dla /api/rain-history
+  WeatherHistory history;  // godzinowa/dzienna historia pogody, okna opadu w O(1)
+  bool historyLoaded = false;
+
+  ParseStats geoStats, weatherStats, forecastStats;
+
+  SemaphoreHandle_t lock = nullptr;
+  TaskHandle_t      task = nullptr;
+  static const uint32_t TASK_STACK = 10240;
+
+  // --- Stan prywatny zadania "weather" (nie dotykany z innych kontekstów) ---
+  String taskKey, taskLoc;
+  bool   taskEnabled = true;
+  unsigned long taskIntervalMs = 60UL * 60UL * 1000UL;
 
   // Terminy pobrań
   unsigned long nextWeatherDue  = 0;
@@ -39,7 +106,32 @@ class Weather {
   float cachedLon = 0.0f;
   bool  coordsValid = false;
 
-  RainHistory rainHistory; // historia opadów (rolling 6h, trwała w LittleFS)
+  // Trwały cache (warm start): współrzędne dla danej lokalizacji + ostatni snapshot.
+  // Po restarcie decyzje o podlewaniu działają od razu, a GEO jest wołane
+  // tylko wtedy, gdy owmLocation faktycznie się zmieni. Snapshot starszy niż
+  // 2× interwał pobierania (co najmniej CACHE_MIN_AGE_S) jest odrzucany, gdy
+  // tylko znamy czas – po długim wyłączeniu nie decyduje o podlewaniu.
+  static constexpr const char* CACHE_PATH = "/weather-cache.bin";
+  static const uint32_t CACHE_MAGIC = 0x31435857; // "WXC1"
+  static const uint32_t CACHE_MIN_AGE_S = 3UL * 3600UL;
+  static const time_t MIN_VALID_TIME = 1600000000; // przed synchronizacją NTP
+  struct CacheFile {
+    uint32_t magic;
+    uint32_t size;       // sizeof(CacheFile) – zmiana układu unieważnia plik
+    char     location[64];
+    float    lat, lon;
+    WeatherSnapshot snap;
+  };
+  bool   cacheLoaded = false;
+  bool   cacheAgePending = false; // snapshot z pliku, wiek jeszcze niesprawdzony
+  String geoLoc;       // lokalizacja, dla której znamy geoLat/geoLon
+  float  geoLat = 0.0f, geoLon = 0.0f;
+
+  struct Guard {
+    SemaphoreHandle_t m;
+    Guard(SemaphoreHandle_t s) : m(s) { xSemaphoreTake(m, portMAX_DELAY); }
+    ~Guard() { xSemaphoreGive(m); }
+  };
 
   // --- Pomocnicze: proste URL-encode (wystarczy do spacji, przecinków itd.)
   static String urlEncode(const String& s) {
@@ -65,32 +157,31 @@ class Weather {
 
   bool resolveCoords() {
     if (coordsValid && cachedLat != 0.0f && cachedLon != 0.0f) return true;
-    if (apiKey.isEmpty() || location.isEmpty()) {
+    if (taskKey.isEmpty() || taskLoc.isEmpty()) {
       Serial.println("[Weather] Brak apiKey lub location – pomijam GEO.");
       return false;
     }
 
-    // HTTPS + WiFiClientSecure
-    WiFiClientSecure client;
-    client.setInsecure();
-
-    String urlGeo = "https://api.openweathermap.org/geo/1.0/direct?q=" + urlEncode(location) + "&limit=1&appid=" + apiKey;
-    HTTPClient httpGeo;
-    if (!httpGeo.begin(client, urlGeo)) {
-      Serial.println("[Weather] Nie można zainicjować żądania GEO (begin).");
-      return false;
-    }
-    int codeGeo = httpGeo.GET();
+    String urlGeo = "https://api.openweathermap.org/geo/1.0/direct?q=" + urlEncode(taskLoc) + "&limit=1&appid=" + taskKey;
+    JsonDocument filter;
+    filter[0]["lat"] = true;
+    filter[0]["lon"] = true;
+    JsonDocument docGeo;
+    DeserializationError err;
+    int codeGeo = getJson(urlGeo, docGeo, filter, geoStats, err);
     if (codeGeo == HTTP_CODE_OK) {
-      String respGeo = httpGeo.getString();
-      JsonDocument docGeo;
-      DeserializationError err = deserializeJson(docGeo, respGeo);
       if (!err) {
         if (docGeo.is<JsonArray>() && docGeo.size() > 0) {
           JsonObject obj = docGeo[0];
           cachedLat = obj["lat"].as<float>();
           cachedLon = obj["lon"].as<float>();
           coordsValid = (cachedLat != 0.0f || cachedLon != 0.0f);
+          if (coordsValid) {
+            geoLoc = taskLoc;
+            geoLat = cachedLat;
+            geoLon = cachedLon;
+            saveCache(copySnapshot());
+          }
         } else {
           Serial.println("[Weather] GEO: pusty wynik dla podanej lokalizacji.");
           coordsValid = false;
@@ -103,7 +194,6 @@ class Weather {
       Serial.print("[Weather] Błąd pobierania GEO! Kod HTTP: "); Serial.println(codeGeo);
       coordsValid = false;
     }
-    httpGeo.end();
 
     if (!coordsValid) Serial.println("[Weather] Błąd: Brak współrzędnych!");
     return coordsValid;
@@ -120,111 +210,244 @@ class Weather {
   void scheduleRetryEarly(bool forWeather) {
     if (forWeather) {
       if (!everSucceededWeather) nextWeatherDue = millis() + 60000UL;
-      else                       nextWeatherDue = millis() + intervalMs;
+      else                       nextWeatherDue = millis() + taskIntervalMs;
     } else {
       if (!everSucceededForecast) nextForecastDue = millis() + 60000UL;
-      else                        nextForecastDue = millis() + intervalMs;
+      else                        nextForecastDue = millis() + taskIntervalMs;
     }
   }
 
-public:
-  void begin(const String& key, const String& loc, bool en=true, int intervalMin=60) {
-    apiKey = key;
-    location = loc;
-    enabled = en;
-    if (intervalMin < 5) intervalMin = 5;
-    intervalMs = (unsigned long)intervalMin * 60UL * 1000UL;
+  // GET przez wspólną pulę HTTPS (keep-alive do api.openweathermap.org).
+  // Odpowiedź parsowana prosto ze strumienia, z filtrem – w dokumencie lądują
+  // tylko pola, których używamy; cała odpowiedź nigdy nie trafia do Stringa.
+  int getJson(const String& url, JsonDocument& doc, JsonDocument& filter, ParseStats& st, DeserializationError& err) {
+    HttpsPool::Lease conn;
+    if (!https || !https->lease(OWM_HOST, conn)) return HTTPC_ERROR_CONNECTION_REFUSED;
+    int code = https->send(conn, url);
+    if (code == HTTP_CODE_OK) {
+      HttpBodyStream body(conn.http());
+      const uint32_t heapBefore = ESP.getFreeHeap();
+      const unsigned long t0 = micros();
+      err = deserializeJson(doc, body, DeserializationOption::Filter(filter));
+      const uint32_t us = (uint32_t)(micros() - t0);
+      const uint32_t heapAfter = ESP.getFreeHeap();
+      {
+        Guard g(lock);
+        st.record(us, heapBefore > heapAfter ? heapBefore - heapAfter : 0, conn.http().getSize());
+      }
+      body.drain();
+      if (!body.reusable()) conn.invalidate();
+    } else {
+      conn.invalidate();
+    }
+    conn.http().end();
+    return code;
+  }
 
-    nextWeatherDue  = 0;
-    nextForecastDue = 0;
-    everSucceededWeather  = false;
-    everSucceededForecast = false;
+  static void formatHHMM(time_t ts, char* out, size_t cap) {
+    if (!ts) { out[0] = '\0'; return; }
+    struct tm t;
+    localtime_r(&ts, &t);
+    snprintf(out, cap, "%02d:%02d", t.tm_hour, t.tm_min);
+  }
 
-    coordsValid = false;
-    cachedLat = cachedLon = 0.0f;
+  // Wynik (dane + historia opadów) trafia do czytelników jednym podstawieniem.
+  // Zapis do LittleFS (przy zmianie godziny cały wx-history.bin) już po
+  // zwolnieniu blokady – getWateringInputs() i /api/chart nie czekają na flash.
+  // Historie wczytuje raz begin() (przed startem zadania), potem zmienia je
+  // tylko to zadanie, więc czytanie ich do zapisu bez blokady jest spójne.
+  void publish(WeatherSnapshot& s, bool addRain) {
+    {
+      Guard g(lock);
+      s.version = current.version + 1;
+      s.updated = (uint32_t)time(nullptr);
+      current = s;
+      if (addRain) {
+        rainHistory.addRainMeasurement(s.rain, false); // aktualizacja historii opadów (rolling 6h)
+        history.add(s.updated, s.rain, s.temp, s.humidity, s.wind, false);
+      }
+    }
+    if (addRain) {
+      rainHistory.save();
+      history.persist();
+    }
+    saveCache(s);
+  }
 
-    rainHistory.begin(); // wczytaj historię z pliku
+  // Pierwszy start z WeatherHistory: przenieś opady z RainHistory,
+  // żeby decyzja o podlewaniu nie straciła ostatnich 6 h
+  void loadHistory() {
+    if (history.begin()) return;
+    for (int i = 0; i < rainHistory.size(); i++) {
+      history.addRain(rainHistory.timeAt(i), rainHistory.rainAt(i), false);
+    }
+    history.flush();
   }
 
-  void applySettings(const String& key, const String& loc, bool en, int intervalMin) {
-    begin(key, loc, en, intervalMin);
+  // Opad 6h do decyzji; bez pamięci na historię – stare RainHistory
+  float rain6hLocked() {
+    return history.ready() ? history.rainLastHours(6, time(nullptr)) : rainHistory.getLast6hRain();
   }
 
-  void loop() {
-    if (!enabled) return;
+  // Wywoływane w begin() przed startem zadania
+  void loadCache() {
+    if (!LittleFS.exists(CACHE_PATH)) return;
+    File f = LittleFS.open(CACHE_PATH, "r");
+    if (!f) return;
+    CacheFile c;
+    size_t n = f.read((uint8_t*)&c, sizeof(c));
+    f.close();
+    if (n != sizeof(c) || c.magic != CACHE_MAGIC || c.size != sizeof(c)) {
+      Serial.println("[Weather] Nieprawidłowy weather-cache.bin – pomijam.");
+      return;
+    }
+    c.location[sizeof(c.location) - 1] = '\0';
+    geoLoc = c.location;
+    geoLat = c.lat;
+    geoLon = c.lon;
+    if (c.snap.updated) {
+      current = c.snap;
+      current.version = 1;
+      cacheAgePending = true;
+    }
+    Serial.printf("[Weather] Warm start: %s (%.4f, %.4f), snapshot z %lu\n",
+                  geoLoc.c_str(), geoLat, geoLon, (unsigned long)c.snap.updated);
+  }
+
+  // Pod blokadą; snap.updated to czas pobrania. Przed NTP wiek jest nieznany –
+  // sprawdza go wtedy pierwszy przebieg zadania (startuje po synchronizacji).
+  void dropStaleCache() {
+    if (!cacheAgePending) return;
+    const time_t now = time(nullptr);
+    if (now < MIN_VALID_TIME) return;
+    cacheAgePending = false;
+    uint32_t maxAge = (uint32_t)(2 * intervalMs / 1000UL);
+    if (maxAge < CACHE_MIN_AGE_S) maxAge = CACHE_MIN_AGE_S;
+    if (now - (time_t)current.updated <= (time_t)maxAge) return;
+    Serial.printf("[Weather] Snapshot z cache sprzed %lu min – za stary, czekam na OWM.\n",
+                  (unsigned long)((now - (time_t)current.updated) / 60));
+    const uint32_t v = current.version;
+    current = WeatherSnapshot();
+    current.version = v + 1;
+  }
+
+  // Tylko z zadania "weather"
+  void saveCache(const WeatherSnapshot& s) {
+    CacheFile c{};
+    c.magic = CACHE_MAGIC;
+    c.size = sizeof(c);
+    strlcpy(c.location, geoLoc.c_str(), sizeof(c.location));
+    c.lat = geoLat;
+    c.lon = geoLon;
+    c.snap = s;
+    File f = LittleFS.open(CACHE_PATH, "w");
+    if (!f) {
+      Serial.println("[Weather] Nie można zapisać weather-cache.bin!");
+      return;
+    }
+    f.write((const uint8_t*)&c, sizeof(c));
+    f.close();
+  }
+
+  WeatherSnapshot copySnapshot() {
+    Guard g(lock);
+    return current;
+  }
+
+  bool fetchCurrent(WeatherSnapshot& s) {
+    Serial.println("[Weather] Pobieranie AKTUALNEJ pogody OWM...");
+    String url = "https://api.openweathermap.org/data/2.5/weather?lat=" + String(cachedLat, 6) +
+                 "&lon=" + String(cachedLon, 6) + "&units=metric&appid=" + taskKey + "&lang=pl";
+    bool ok = false;
+    JsonDocument filter;
+    currentFilter(filter);
+
+    JsonDocument doc;
+    DeserializationError err;
+    int code = getJson(url, doc, filter, weatherStats, err);
+    if (code == HTTP_CODE_OK) {
+      if (!err) {
+        readCurrent(doc, s);
+        ok = true;
+      } else {
+        Serial.print("[Weather] Błąd JSON weather: "); Serial.println(err.c_str());
+      }
+    } else {
+      Serial.print("[Weather] Błąd pobierania weather! Kod HTTP: "); Serial.println(code);
+    }
+    return ok;
+  }
+
+  bool fetchForecast(WeatherSnapshot& s) {
+    Serial.println("[Weather] Pobieranie prognozy OWM...");
+    String urlF = "https://api.openweathermap.org/data/2.5/forecast?lat=" + String(cachedLat, 6) +
+                  "&lon=" + String(cachedLon, 6) + "&appid=" + taskKey + "&units=metric";
+    bool ok = false;
+    JsonDocument filter;
+    forecastFilter(filter);
+
+    JsonDocument docF;
+    DeserializationError err;
+    int codeF = getJson(urlF, docF, filter, forecastStats, err);
+    if (codeF == HTTP_CODE_OK) {
+      if (!err) {
+        readForecast(docF, s, ydayTomorrow());
+        ok = true;
+      } else {
+        Serial.print("[Weather] Błąd JSON forecast: "); Serial.println(err.c_str());
+      }
+    } else {
+      Serial.print("[Weather] Błąd pobierania forecast! Kod HTTP: "); Serial.println(codeF);
+    }
+    return ok;
+  }
+
+  // Jeden przebieg zadania: przejmij ustawienia, pobierz to, co jest „do zrobienia”
+  void runDue() {
+    {
+      Guard g(lock);
+      dropStaleCache();
+      if (settingsChanged) {
+        settingsChanged = false;
+        const bool locChanged = (taskLoc != location);
+        taskKey = apiKey;
+        taskLoc = location;
+        taskEnabled = enabled;
+        taskIntervalMs = intervalMs;
+
+        nextWeatherDue  = 0;
+        nextForecastDue = 0;
+        everSucceededWeather  = false;
+        everSucceededForecast = false;
+
+        if (locChanged) {
+          coordsValid = false;
+          cachedLat = cachedLon = 0.0f;
+          // Współrzędne z cache tylko dla tej samej lokalizacji
+          if (geoLoc.length() > 0 && geoLoc == taskLoc) {
+            cachedLat = geoLat;
+            cachedLon = geoLon;
+            coordsValid = (cachedLat != 0.0f || cachedLon != 0.0f);
+          }
+        }
+      }
+    }
+    if (!taskEnabled) return;
     unsigned long nowMs = millis();
 
     // --- AKTUALNA ---
     if (nowMs >= nextWeatherDue) {
-      if (apiKey.isEmpty() || location.isEmpty()) {
+      if (taskKey.isEmpty() || taskLoc.isEmpty()) {
         Serial.println("[Weather] Pomijam aktualne dane – brak apiKey/location.");
-        nextWeatherDue = nowMs + intervalMs;
+        nextWeatherDue = nowMs + taskIntervalMs;
       } else if (resolveCoords()) {
-        Serial.println("[Weather] Pobieranie AKTUALNEJ pogody OWM...");
-        WiFiClientSecure client;
-        client.setInsecure();
-        String url = "https://api.openweathermap.org/data/2.5/weather?lat=" + String(cachedLat, 6) +
-                     "&lon=" + String(cachedLon, 6) + "&units=metric&appid=" + apiKey + "&lang=pl";
-        HTTPClient http;
-        if (!http.begin(client, url)) {
-          Serial.println("[Weather] Nie można zainicjować żądania weather (begin).");
-          scheduleRetryEarly(true);
+        WeatherSnapshot s = copySnapshot();
+        if (fetchCurrent(s)) {
+          publish(s, true);
+          everSucceededWeather = true;
+          nextWeatherDue = nowMs + taskIntervalMs;
         } else {
-          int code = http.GET();
-          if (code == HTTP_CODE_OK) {
-            String resp = http.getString();
-            JsonDocument doc;
-            DeserializationError err = deserializeJson(doc, resp);
-            if (!err) {
-              temp        = doc["main"]["temp"]        | 0.0;
-              feels_like  = doc["main"]["feels_like"]  | 0.0;
-              temp_min    = doc["main"]["temp_min"]    | 0.0;
-              temp_max    = doc["main"]["temp_max"]    | 0.0;
-              humidity    = doc["main"]["humidity"]    | 0.0;
-              pressure    = doc["main"]["pressure"]    | 0.0;
-              wind        = doc["wind"]["speed"]       | 0.0;
-              wind_deg    = doc["wind"]["deg"]         | 0.0;
-              clouds      = doc["clouds"]["all"]       | 0.0;
-              visibility  = doc["visibility"]          | 0.0;
-              rain        = doc["rain"]["1h"]          | 0.0;
-
-              weather_desc = "";
-              icon = "";
-              if (doc["weather"].is<JsonArray>() && doc["weather"].size() > 0) {
-                weather_desc = doc["weather"][0]["description"].as<const char*>();
-                icon         = doc["weather"][0]["icon"].as<const char*>();
-              }
-
-              // Wschód/zachód
-              time_t sunrise_ts = (time_t)(doc["sys"]["sunrise"] | 0);
-              time_t sunset_ts  = (time_t)(doc["sys"]["sunset"]  | 0);
-              char buf[8];
-              struct tm t;
-              if (sunrise_ts) {
-                localtime_r(&sunrise_ts, &t);
-                snprintf(buf, sizeof(buf), "%02d:%02d", t.tm_hour, t.tm_min);
-                sunrise = String(buf);
-              } else sunrise = "";
-              if (sunset_ts) {
-                localtime_r(&sunset_ts, &t);
-                snprintf(buf, sizeof(buf), "%02d:%02d", t.tm_hour, t.tm_min);
-                sunset = String(buf);
-              } else sunset = "";
-
-              // aktualizacja historii opadów (rolling 6h)
-              rainHistory.addRainMeasurement(rain);
-
-              everSucceededWeather = true;
-              nextWeatherDue = nowMs + intervalMs;
-            } else {
-              Serial.print("[Weather] Błąd JSON weather: "); Serial.println(err.c_str());
-              scheduleRetryEarly(true);
-            }
-          } else {
-            Serial.print("[Weather] Błąd pobierania weather! Kod HTTP: "); Serial.println(code);
-            scheduleRetryEarly(true);
-          }
-          http.end();
+          scheduleRetryEarly(true);
         }
       } else {
         scheduleRetryEarly(true);
@@ -233,71 +456,17 @@ public:
 
     // --- PROGNOZA ---
     if (nowMs >= nextForecastDue) {
-      if (apiKey.isEmpty() || location.isEmpty()) {
+      if (taskKey.isEmpty() || taskLoc.isEmpty()) {
         Serial.println("[Weather] Pomijam prognozę – brak apiKey/location.");
-        nextForecastDue = nowMs + intervalMs;
+        nextForecastDue = nowMs + taskIntervalMs;
       } else if (resolveCoords()) {
-        Serial.println("[Weather] Pobieranie prognozy OWM...");
-        WiFiClientSecure clientF;
-        clientF.setInsecure();
-        String urlF = "https://api.openweathermap.org/data/2.5/forecast?lat=" + String(cachedLat, 6) +
-                      "&lon=" + String(cachedLon, 6) + "&appid=" + apiKey + "&units=metric";
-        HTTPClient httpF;
-        if (!httpF.begin(clientF, urlF)) {
-          Serial.println("[Weather] Nie można zainicjować żądania forecast (begin).");
-          scheduleRetryEarly(false);
+        WeatherSnapshot s = copySnapshot();
+        if (fetchForecast(s)) {
+          publish(s, false);
+          everSucceededForecast = true;
+          nextForecastDue = nowMs + taskIntervalMs;
         } else {
-          int codeF = httpF.GET();
-          if (codeF == HTTP_CODE_OK) {
-            String respF = httpF.getString();
-            JsonDocument docF;
-            DeserializationError err = deserializeJson(docF, respF);
-            if (!err) {
-              rain_1h_forecast = 0;
-              rain_6h_forecast = 0;
-              temp_min_tomorrow = 0;
-              temp_max_tomorrow = 0;
-              humidity_tomorrow_max = 0;
-
-              if (docF["list"].is<JsonArray>() && docF["list"].size() >= 2) {
-                float rain3h_0 = docF["list"][0]["rain"]["3h"] | 0.0;
-                float rain3h_1 = docF["list"][1]["rain"]["3h"] | 0.0;
-                rain_1h_forecast = rain3h_0 / 3.0f;
-                rain_6h_forecast = rain3h_0 + rain3h_1;
-              }
-
-              int targetYday = ydayTomorrow();
-              float min_t = 1000.0f, max_t = -1000.0f;
-              float max_h = 0.0f;
-
-              for (JsonVariant v : docF["list"].as<JsonArray>()) {
-                time_t ts = (time_t)(v["dt"] | 0);
-                struct tm tt;
-                localtime_r(&ts, &tt);
-                if (tt.tm_yday == targetYday) {
-                  float t_min = v["main"]["temp_min"] | 0.0;
-                  float t_max = v["main"]["temp_max"] | 0.0;
-                  float h_val = v["main"]["humidity"] | 0.0;
-                  if (t_min < min_t) min_t = t_min;
-                  if (t_max > max_t) max_t = t_max;
-                  if (h_val > max_h) max_h = h_val;
-                }
-              }
-              temp_min_tomorrow = (min_t < 1000.0f) ? min_t : 0.0f;
-              temp_max_tomorrow = (max_t > -1000.0f) ? max_t : 0.0f;
-              humidity_tomorrow_max = max_h;
-
-              everSucceededForecast = true;
-              nextForecastDue = nowMs + intervalMs;
-            } else {
-              Serial.print("[Weather] Błąd JSON forecast: "); Serial.println(err.c_str());
-              scheduleRetryEarly(false);
-            }
-          } else {
-            Serial.print("[Weather] Błąd pobierania forecast! Kod HTTP: "); Serial.println(codeF);
-            scheduleRetryEarly(false);
-          }
-          httpF.end();
+          scheduleRetryEarly(false);
         }
       } else {
         scheduleRetryEarly(false);
@@ -305,38 +474,214 @@ public:
     }
   }
 
+  static void taskEntry(void* arg) {
+    Weather* self = static_cast<Weather*>(arg);
+    for (;;) {
+      // Budzimy się co 1 s albo natychmiast po zmianie ustawień
+      ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(1000));
+      self->runDue();
+      if (self->https) self->https->closeIdle();
+    }
+  }
+
+public:
+  explicit Weather(HttpsPool* pool = nullptr) : https(pool) {}
+
+  void begin(const String& key, const String& loc, bool en=true, int intervalMin=60) {
+    if (!lock) lock = xSemaphoreCreateMutex();
+    {
+      Guard g(lock);
+      apiKey = key;
+      location = loc;
+      enabled = en;
+      if (intervalMin < 5) intervalMin = 5;
+      intervalMs = (unsigned long)intervalMin * 60UL * 1000UL;
+      settingsChanged = true;
+
+      // Historie tylko raz, przed startem zadania – applySettings() z WWW/MQTT
+      // nie może ich przeładować w trakcie zapisu przez zadanie "weather"
+      if (!historyLoaded) {
+        historyLoaded = true;
+        rainHistory.begin(); // wczytaj historię z pliku
+        loadHistory();
+      }
+      if (!cacheLoaded) { cacheLoaded = true; loadCache(); }
+      dropStaleCache();
+    }
+    if (task) xTaskNotifyGive(task);
+  }
+
+  void applySettings(const String& key, const String& loc, bool en, int intervalMin) {
+    begin(key, loc, en, intervalMin);
+  }
+
+  // --- Parsowanie odpowiedzi OWM (także host/owm_parse_bench.cpp) ---
+  // Filtry ArduinoJson: w dokumencie lądują tylko pola, których używamy
+  static void currentFilter(JsonDocument& filter) {
+    JsonObject fMain = filter["main"].to<JsonObject>();
+    fMain["temp"] = true; fMain["feels_like"] = true;
+    fMain["temp_min"] = true; fMain["temp_max"] = true;
+    fMain["humidity"] = true; fMain["pressure"] = true;
+    filter["wind"]["speed"] = true;
+    filter["wind"]["deg"] = true;
+    filter["clouds"]["all"] = true;
+    filter["visibility"] = true;
+    filter["rain"]["1h"] = true;
+    filter["weather"][0]["description"] = true;
+    filter["weather"][0]["icon"] = true;
+    filter["sys"]["sunrise"] = true;
+    filter["sys"]["sunset"] = true;
+  }
+
+  // Z 40 wpisów listy zostawiamy tylko dt, main.temp_min/temp_max/humidity i rain.3h
+  static void forecastFilter(JsonDocument& filter) {
+    JsonObject fItem = filter["list"][0].to<JsonObject>();
+    fItem["dt"] = true;
+    fItem["main"]["temp_min"] = true;
+    fItem["main"]["temp_max"] = true;
+    fItem["main"]["humidity"] = true;
+    fItem["rain"]["3h"] = true;
+  }
+
+  // /data/2.5/weather -> dane aktualne snapshotu
+  static void readCurrent(JsonDocument& doc, WeatherSnapshot& s) {
+    s.temp        = doc["main"]["temp"]        | 0.0;
+    s.feels_like  = doc["main"]["feels_like"]  | 0.0;
+    s.temp_min    = doc["main"]["temp_min"]    | 0.0;
+    s.temp_max    = doc["main"]["temp_max"]    | 0.0;
+    s.humidity    = doc["main"]["humidity"]    | 0.0;
+    s.pressure    = doc["main"]["pressure"]    | 0.0;
+    s.wind        = doc["wind"]["speed"]       | 0.0;
+    s.wind_deg    = doc["wind"]["deg"]         | 0.0;
+    s.clouds      = doc["clouds"]["all"]       | 0.0;
+    s.visibility  = doc["visibility"]          | 0.0;
+    s.rain        = doc["rain"]["1h"]          | 0.0;
+
+    s.weather_desc[0] = '\0';
+    s.icon[0] = '\0';
+    if (doc["weather"].is<JsonArray>() && doc["weather"].size() > 0) {
+      strlcpy(s.weather_desc, doc["weather"][0]["description"] | "", sizeof(s.weather_desc));
+      strlcpy(s.icon,         doc["weather"][0]["icon"]        | "", sizeof(s.icon));
+    }
+
+    // Wschód/zachód
+    formatHHMM((time_t)(doc["sys"]["sunrise"] | 0), s.sunrise, sizeof(s.sunrise));
+    formatHHMM((time_t)(doc["sys"]["sunset"]  | 0), s.sunset,  sizeof(s.sunset));
+  }
+
+  // /data/2.5/forecast -> prognozy snapshotu; targetYday = jutro (tm_yday)
+  static void readForecast(JsonDocument& doc, WeatherSnapshot& s, int targetYday) {
+    s.rain_1h_forecast = 0;
+    s.rain_6h_forecast = 0;
+
+    if (doc["list"].is<JsonArray>() && doc["list"].size() >= 2) {
+      float rain3h_0 = doc["list"][0]["rain"]["3h"] | 0.0;
+      float rain3h_1 = doc["list"][1]["rain"]["3h"] | 0.0;
+      s.rain_1h_forecast = rain3h_0 / 3.0f;
+      s.rain_6h_forecast = rain3h_0 + rain3h_1;
+    }
+
+    float min_t = 1000.0f, max_t = -1000.0f;
+    float max_h = 0.0f;
+
+    for (JsonVariant v : doc["list"].as<JsonArray>()) {
+      time_t ts = (time_t)(v["dt"] | 0);
+      struct tm tt;
+      localtime_r(&ts, &tt);
+      if (tt.tm_yday == targetYday) {
+        float t_min = v["main"]["temp_min"] | 0.0;
+        float t_max = v["main"]["temp_max"] | 0.0;
+        float h_val = v["main"]["humidity"] | 0.0;
+        if (t_min < min_t) min_t = t_min;
+        if (t_max > max_t) max_t = t_max;
+        if (h_val > max_h) max_h = h_val;
+      }
+    }
+    s.temp_min_tomorrow = (min_t < 1000.0f) ? min_t : 0.0f;
+    s.temp_max_tomorrow = (max_t > -1000.0f) ? max_t : 0.0f;
+    s.humidity_tomorrow_max = max_h;
+  }
+
+  // Pobieranie odbywa się w zadaniu "weather" – pętla główna nie czeka na OWM.
+  // Zadanie startuje przy pierwszym loop(), czyli po synchronizacji NTP w setup().
+  void loop() {
+    if (!task && lock) xTaskCreatePinnedToCore(taskEntry, "weather", TASK_STACK, this, 1, &task, 0);
+  }
+
+  WeatherSnapshot snapshot() { return copySnapshot(); }
+  uint32_t getVersion() { Guard g(lock); return current.version; }
+
   void toJson(JsonDocument& doc) {
-    doc["temp"] = temp;
-    doc["feels_like"] = feels_like;
-    doc["humidity"] = humidity;
-    doc["pressure"] = pressure;
-    doc["wind"] = wind;
-    doc["wind_deg"] = wind_deg;
-    doc["clouds"] = clouds;
-    doc["visibility"] = (int)(visibility / 1000);
-    doc["weather_desc"] = weather_desc;
-    doc["icon"] = icon;
-    doc["rain"] = rain;
-    doc["rain_1h_forecast"] = rain_1h_forecast;
-    doc["rain_6h_forecast"] = rain_6h_forecast;
-    doc["sunrise"] = sunrise;
-    doc["sunset"] = sunset;
-    doc["temp_min"] = temp_min;
-    doc["temp_max"] = temp_max;
-    doc["temp_min_tomorrow"] = temp_min_tomorrow;
-    doc["temp_max_tomorrow"] = temp_max_tomorrow;
-    doc["humidity_tomorrow_max"] = humidity_tomorrow_max;
+    const WeatherSnapshot s = copySnapshot();
+    doc["temp"] = s.temp;
+    doc["feels_like"] = s.feels_like;
+    doc["humidity"] = s.humidity;
+    doc["pressure"] = s.pressure;
+    doc["wind"] = s.wind;
+    doc["wind_deg"] = s.wind_deg;
+    doc["clouds"] = s.clouds;
+    doc["visibility"] = (int)(s.visibility / 1000);
+    doc["weather_desc"] = s.weather_desc;
+    doc["icon"] = s.icon;
+    doc["rain"] = s.rain;
+    doc["rain_1h_forecast"] = s.rain_1h_forecast;
+    doc["rain_6h_forecast"] = s.rain_6h_forecast;
+    doc["sunrise"] = s.sunrise;
+    doc["sunset"] = s.sunset;
+    doc["temp_min"] = s.temp_min;
+    doc["temp_max"] = s.temp_max;
+    doc["temp_min_tomorrow"] = s.temp_min_tomorrow;
+    doc["temp_max_tomorrow"] = s.temp_max_tomorrow;
+    doc["humidity_tomorrow_max"] = s.humidity_tomorrow_max;
+    doc["updated"] = s.updated;
+  }
+
+  // Koszt parsowania odpowiedzi OWM (czas, sterta, rozmiar body)
+  void statsToJson(JsonDocument& doc) {
+    Guard g(lock);
+    geoStats.toJson(doc["geo"].to<JsonObject>());
+    weatherStats.toJson(doc["weather"].to<JsonObject>());
+    forecastStats.toJson(doc["forecast"].to<JsonObject>());
+    doc["free_heap"] = ESP.getFreeHeap();
+    doc["min_free_heap"] = ESP.getMinFreeHeap();
   }
 
   // API dla WebServerUI / innych modułów
-  void rainHistoryToJson(JsonDocument& doc) const { rainHistory.toJson(doc); }
-  float getLast6hRain() const { return rainHistory.getLast6hRain(); }
-  float getDailyMaxTemp() const { return temp_max_tomorrow; }
-  float getDailyHumidityForecast() const { return humidity_tomorrow_max; }
+  void rainHistoryToJson(JsonDocument& doc) { Guard g(lock); rainHistory.toJson(doc); }
+  float getLast6hRain() { Guard g(lock); return rain6hLocked(); }
+
+  // Punkt serii historii do wykresu (pod blokadą – woła go ChartWriter z async_tcp)
+  bool historySample(WeatherHistory::Metric m, bool daily, int32_t key, float& v) {
+    Guard g(lock);
+    return history.sample(m, daily, key, v);
+  }
+
+  // Źródło wykresu dla [from, to] przycięte do przechowywanej historii
+  ChartSource* chartSource(WeatherHistory::Metric m, bool daily, time_t from, time_t to);
+
+  // Podsumowanie historii (okna opadu, średnie) + ostatnie hours godzin / days dni
+  void historyToJson(JsonDocument& doc, int hours = 0, int days = 0) {
+    Guard g(lock);
+    history.toJson(doc, time(nullptr), hours, days);
+  }
+  float getDailyMaxTemp() { Guard g(lock); return current.temp_max_tomorrow; }
+  float getDailyHumidityForecast() { Guard g(lock); return current.humidity_tomorrow_max; }
 
   // --- Bieżące (rzeczywiste) parametry, jeśli chcesz je gdzieś wyświetlać ---
-  float getCurrentTemp() const { return temp; }
-  float getCurrentHumidity() const { return humidity; }
+  float getCurrentTemp() { Guard g(lock); return current.temp; }
+  float getCurrentHumidity() { Guard g(lock); return current.humidity; }
+
+  WateringInputs getWateringInputs() {
+    WateringInputs in;
+    {
+      Guard g(lock);
+      in.rain6h   = rain6hLocked();
+      in.temp     = current.temp;
+      in.humidity = current.humidity;
+    }
+    in.percent = wateringPercentFor(in.rain6h, in.temp, in.humidity);
+    return in;
+  }
 
   // *** LOGIKA PROCENTOWA – PRIORYTET OPADÓW 6h, przy 0mm przechodzimy do reguł T/H ***
   // Deszcz (ostatnie 6h):
@@ -349,11 +694,7 @@ public:
   //   gorąco i sucho: T_now > 27°C && H_now < 50%  -> 120%
   //   chłodno/wilgotno: H_now > 70%                -> 80%
   //   w pozostałych przypadkach                    -> 100%
-  int getWateringPercent() {
-    const float rain6h = getLast6hRain();
-    const float T_now  = temp;
-    const float H_now  = humidity;
-
+  static int wateringPercentFor(float rain6h, float T_now, float H_now) {
     // 1) Priorytet opadów 6h
     if (rain6h >= 4.0f) return 0;
     if (rain6h >= 1.0f) return 40;
@@ -365,12 +706,15 @@ public:
     return 100; // neutralnie
   }
 
+  int getWateringPercent() { return getWateringInputs().percent; }
+
   bool wateringAllowed() { return getWateringPercent() > 0; }
 
   String getWateringDecisionExplain() {
-    const float rain6h = getLast6hRain();
-    const float T_now  = temp;
-    const float H_now  = humidity;
+    const WateringInputs in = getWateringInputs();
+    const float rain6h = in.rain6h;
+    const float T_now  = in.temp;
+    const float H_now  = in.humidity;
 
     // Sekcja opadów (priorytet)
     if (rain6h >= 4.0f)
@@ -389,3 +733,36 @@ public:
     return "Brak opadów 6h i warunki neutralne (T=" + String(T_now,1) + "°C, H=" + String(H_now,0) + "%) → 100%";
   }
 };
+
+// Seria z WeatherHistory dla /api/chart: punkt i = klucz first + i
+class WeatherSeries : public ChartSource {
+  Weather* weather;
+  WeatherHistory::Metric metric;
+  bool daily;
+  int32_t first, n;
+
+public:
+  WeatherSeries(Weather* w, WeatherHistory::Metric m, bool d, int32_t firstKey, int32_t count)
+    : weather(w), metric(m), daily(d), first(firstKey), n(count) {}
+
+  int32_t count() override { return n; }
+
+  bool at(int32_t i, uint32_t& t, float& v) override {
+    if (i < 0 || i >= n) return false;
+    if (!weather->historySample(metric, daily, first + i, v)) return false;
+    t = WeatherHistory::keyTime(daily, first + i);
+    return true;
+  }
+};
+
+inline ChartSource* Weather::chartSource(WeatherHistory::Metric m, bool daily, time_t from, time_t to) {
+  int32_t oldest = 0, newest = -1;
+  {
+    Guard g(lock);
+    if (!history.range(daily, oldest, newest)) newest = oldest - 1;
+  }
+  int32_t a = WeatherHistory::keyOf(daily, from), b = WeatherHistory::keyOf(daily, to);
+  if (a < oldest) a = oldest;
+  if (b > newest) b = newest;
+  return new WeatherSeries(this, m, daily, a, b >= a ? b - a + 1 : 0);
+}
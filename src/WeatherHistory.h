@@ -0,0 +1,487 @@
+#pragma once
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <LittleFS.h>
+#include <time.h>
+#include <stddef.h>
+#include <new>
+
+// Historia pogody w kolumnach o stałym rozmiarze:
+//  - godzinowo przez 32 dni: opad, temperatura, wilgotność, wiatr,
+//  - dziennie przez 366 dni: opad, Tmin/Tmax/Tśr, wilgotność, max wiatr.
+// Obok wartości trzymane są sumy narastające, więc suma lub średnia z
+// dowolnego okna (6h, 24h, 7d, 365d) to jedno odejmowanie – bez skanowania.
+// Wartości w stałym przecinku: opad 0.1 mm, temperatura 0.1 °C, wiatr 0.1 m/s.
+// Pamięć (~24 KB) alokowana raz w begin(). Klasa nie ma własnej blokady –
+// Weather woła ją pod swoim mutexem.
+class WeatherHistory {
+public:
+  static const int HOURS = 32 * 24;
+  static const int DAYS  = 366;
+
+  // Serie dostępne dla wykresów (/api/chart)
+  enum Metric : uint8_t { M_RAIN, M_TEMP, M_HUMIDITY, M_WIND };
+
+private:
+  static constexpr const char* PATH = "/wx-history.bin";
+  static const uint32_t MAGIC = 0x31485857; // "WXH1"
+
+  struct Store {
+    // Godzinowe (slot = godzina UTC % HOURS)
+    int16_t  hRain[HOURS];   // suma opadu w godzinie
+    int16_t  hTemp[HOURS];   // średnia temperatura
+    uint8_t  hHum[HOURS];    // średnia wilgotność, %
+    uint16_t hWind[HOURS];   // średni wiatr
+    uint8_t  hN[HOURS];      // liczba pomiarów meteo (0 = brak danych)
+    // Dzienne (slot = dzień lokalny % DAYS)
+    int16_t  dRain[DAYS];
+    int16_t  dTmin[DAYS], dTmax[DAYS], dTavg[DAYS];
+    uint8_t  dHum[DAYS];
+    uint16_t dWindMax[DAYS];
+    uint16_t dN[DAYS];
+    // Sumy narastające – nie trafiają do pliku, odtwarzane w begin()
+    int32_t  cRain[HOURS], cTemp[HOURS], cHum[HOURS], cValid[HOURS];
+    int32_t  cdRain[DAYS];
+  };
+  static const size_t RAW_SIZE = offsetof(Store, cRain); // część zapisywana do pliku
+
+  struct FileHeader {
+    uint32_t magic;
+    uint32_t rawSize;
+    int32_t  lastHour, hoursFilled;
+    int32_t  lastDay, daysFilled;
+  };
+
+  enum Col : uint8_t { RAIN, TEMP, HUM, VALID };
+
+  Store*  st = nullptr;
+  int32_t lastHour = 0, hoursFilled = 0;
+  int32_t lastDay = 0, daysFilled = 0;
+  bool    layoutChanged = false; // przesunięto bufor – zapis całego pliku zamiast łatki
+
+  static int hSlot(int32_t h) { return (int)(h % HOURS); }
+  static int dSlot(int32_t d) { return (int)(d % DAYS); }
+
+  static int16_t fixed10(float v) {
+    float s = v * 10.0f;
+    if (s > 32767.0f) return 32767;
+    if (s < -32767.0f) return -32767;
+    return (int16_t)lroundf(s);
+  }
+
+  // Dni od 1970-01-01 dla daty kalendarzowej (H. Hinnant, days_from_civil)
+  static int32_t daysFromCivil(int y, unsigned m, unsigned d) {
+    y -= m <= 2;
+    const int era = (y >= 0 ? y : y - 399) / 400;
+    const unsigned yoe = (unsigned)(y - era * 400);
+    const unsigned doy = (153 * (m > 2 ? m - 3 : m + 9) + 2) / 5 + d - 1;
+    const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + (int32_t)doe - 719468;
+  }
+
+  static void civilFromDays(int32_t z, int& y, unsigned& m, unsigned& d) {
+    z += 719468;
+    const int32_t era = (z >= 0 ? z : z - 146096) / 146097;
+    const unsigned doe = (unsigned)(z - era * 146097);
+    const unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    const unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    const unsigned mp = (5 * doy + 2) / 153;
+    d = doy - (153 * mp + 2) / 5 + 1;
+    m = mp < 10 ? mp + 3 : mp - 9;
+    y = (int)yoe + era * 400 + (m <= 2);
+  }
+
+  static int32_t hourOf(time_t ts) { return (int32_t)(ts / 3600); }
+  static int32_t localDayOf(time_t ts) {
+    struct tm t;
+    localtime_r(&ts, &t);
+    return daysFromCivil(t.tm_year + 1900, t.tm_mon + 1, t.tm_mday);
+  }
+
+  int32_t rawHour(Col c, int s) const {
+    switch (c) {
+      case RAIN:  return st->hRain[s];
+      case TEMP:  return st->hN[s] ? st->hTemp[s] : 0;
+      case HUM:   return st->hN[s] ? st->hHum[s] : 0;
+      default:    return st->hN[s] ? 1 : 0;
+    }
+  }
+
+  int32_t* cumCol(Col c) const {
+    switch (c) {
+      case RAIN:  return st->cRain;
+      case TEMP:  return st->cTemp;
+      case HUM:   return st->cHum;
+      default:    return st->cValid;
+    }
+  }
+
+  // Suma narastająca slotu s = suma poprzedniej godziny + wartość slotu
+  void recumHour(int32_t h, bool first) {
+    const int s = hSlot(h), p = hSlot(h - 1);
+    for (int i = RAIN; i <= VALID; i++) {
+      const Col c = (Col)i;
+      int32_t* cum = cumCol(c);
+      cum[s] = (first ? 0 : cum[p]) + rawHour(c, s);
+    }
+  }
+
+  void recumDay(int32_t d, bool first) {
+    const int s = dSlot(d);
+    st->cdRain[s] = (first ? 0 : st->cdRain[dSlot(d - 1)]) + st->dRain[s];
+  }
+
+  void clearHour(int s) {
+    st->hRain[s] = 0; st->hTemp[s] = 0; st->hHum[s] = 0; st->hWind[s] = 0; st->hN[s] = 0;
+  }
+
+  void clearDay(int s) {
+    st->dRain[s] = 0; st->dTmin[s] = 0; st->dTmax[s] = 0; st->dTavg[s] = 0;
+    st->dHum[s] = 0; st->dWindMax[s] = 0; st->dN[s] = 0;
+  }
+
+  // Przesuwa bufor godzinowy do godziny h; godziny pomiędzy zostają puste
+  bool advanceHour(int32_t h) {
+    if (hoursFilled > 0 && h < lastHour) return false; // zegar cofnięty – pomijamy
+    if (hoursFilled == 0 || h - lastHour >= HOURS) {
+      hoursFilled = 1;
+      lastHour = h;
+      clearHour(hSlot(h));
+      recumHour(h, true);
+      layoutChanged = true;
+      return true;
+    }
+    while (lastHour < h) {
+      lastHour++;
+      clearHour(hSlot(lastHour));
+      recumHour(lastHour, false);
+      if (hoursFilled < HOURS) hoursFilled++;
+      layoutChanged = true;
+    }
+    return true;
+  }
+
+  bool advanceDay(int32_t d) {
+    if (daysFilled > 0 && d < lastDay) return false;
+    if (daysFilled == 0 || d - lastDay >= DAYS) {
+      daysFilled = 1;
+      lastDay = d;
+      clearDay(dSlot(d));
+      recumDay(d, true);
+      layoutChanged = true;
+      return true;
+    }
+    while (lastDay < d) {
+      lastDay++;
+      clearDay(dSlot(lastDay));
+      recumDay(lastDay, false);
+      if (daysFilled < DAYS) daysFilled++;
+      layoutChanged = true;
+    }
+    return true;
+  }
+
+  // Suma kolumny z godzin (nowH - n, nowH]; godziny po lastHour są puste
+  int32_t hourWindow(Col c, int n, int32_t nowH) const {
+    if (!st || hoursFilled == 0 || n <= 0) return 0;
+    const int32_t oldest = lastHour - hoursFilled + 1;
+    const int32_t to = nowH < lastHour ? nowH : lastHour;
+    const int32_t from = nowH - n;
+    if (to < oldest || to <= from) return 0;
+    const int32_t* cum = cumCol(c);
+    const int32_t lo = from >= oldest ? cum[hSlot(from)] : cum[hSlot(oldest)] - rawHour(c, hSlot(oldest));
+    return cum[hSlot(to)] - lo;
+  }
+
+  int32_t dayWindow(int n, int32_t today) const {
+    if (!st || daysFilled == 0 || n <= 0) return 0;
+    const int32_t oldest = lastDay - daysFilled + 1;
+    const int32_t to = today < lastDay ? today : lastDay;
+    const int32_t from = today - n;
+    if (to < oldest || to <= from) return 0;
+    const int32_t lo = from >= oldest ? st->cdRain[dSlot(from)] : st->cdRain[dSlot(oldest)] - st->dRain[dSlot(oldest)];
+    return st->cdRain[dSlot(to)] - lo;
+  }
+
+  void rebuildCums() {
+    for (int32_t i = 0; i < hoursFilled; i++) recumHour(lastHour - hoursFilled + 1 + i, i == 0);
+    for (int32_t i = 0; i < daysFilled; i++)  recumDay(lastDay - daysFilled + 1 + i, i == 0);
+  }
+
+  FileHeader header() const {
+    return FileHeader{ MAGIC, (uint32_t)RAW_SIZE, lastHour, hoursFilled, lastDay, daysFilled };
+  }
+
+  // Pełny zapis (po przesunięciu bufora)
+  void save() {
+    File f = LittleFS.open(PATH, "w");
+    if (!f) {
+      Serial.println("[WeatherHistory] Nie można otworzyć pliku do zapisu!");
+      return;
+    }
+    const FileHeader h = header();
+    f.write((const uint8_t*)&h, sizeof(h));
+    f.write((const uint8_t*)st, RAW_SIZE);
+    f.close();
+    layoutChanged = false;
+  }
+
+  template <typename T>
+  static void patchCell(File& f, size_t colOffset, int slot, const T& v) {
+    f.seek(sizeof(FileHeader) + colOffset + slot * sizeof(T));
+    f.write((const uint8_t*)&v, sizeof(T));
+  }
+
+  // Zapis tylko bieżącej godziny i bieżącego dnia (kilkanaście bajtów)
+  void saveCurrent() {
+    if (layoutChanged || !LittleFS.exists(PATH)) { save(); return; }
+    File f = LittleFS.open(PATH, "r+");
+    if (!f) { save(); return; }
+    const int h = hSlot(lastHour), d = dSlot(lastDay);
+    patchCell(f, offsetof(Store, hRain), h, st->hRain[h]);
+    patchCell(f, offsetof(Store, hTemp), h, st->hTemp[h]);
+    patchCell(f, offsetof(Store, hHum),  h, st->hHum[h]);
+    patchCell(f, offsetof(Store, hWind), h, st->hWind[h]);
+    patchCell(f, offsetof(Store, hN),    h, st->hN[h]);
+    patchCell(f, offsetof(Store, dRain), d, st->dRain[d]);
+    patchCell(f, offsetof(Store, dTmin), d, st->dTmin[d]);
+    patchCell(f, offsetof(Store, dTmax), d, st->dTmax[d]);
+    patchCell(f, offsetof(Store, dTavg), d, st->dTavg[d]);
+    patchCell(f, offsetof(Store, dHum),  d, st->dHum[d]);
+    patchCell(f, offsetof(Store, dWindMax), d, st->dWindMax[d]);
+    patchCell(f, offsetof(Store, dN),    d, st->dN[d]);
+    f.close();
+  }
+
+  static float avg10(int32_t sum, int32_t n) { return n > 0 ? (float)sum / n / 10.0f : NAN; }
+
+  static void dayString(int32_t day, char* out, size_t cap) {
+    int y; unsigned m, d;
+    civilFromDays(day, y, m, d);
+    snprintf(out, cap, "%04d-%02u-%02u", y, m, d);
+  }
+
+public:
+  // false = brak pliku historii (świeży start – można zasilić starszymi danymi)
+  bool begin() {
+    if (!st) st = new (std::nothrow) Store();
+    if (!st) {
+      Serial.println("[WeatherHistory] Brak pamięci na historię pogody!");
+      return true;
+    }
+    hoursFilled = daysFilled = 0;
+    if (!LittleFS.exists(PATH)) return false;
+    File f = LittleFS.open(PATH, "r");
+    if (!f) return false;
+    FileHeader h;
+    bool ok = f.read((uint8_t*)&h, sizeof(h)) == sizeof(h) && h.magic == MAGIC && h.rawSize == RAW_SIZE
+              && h.hoursFilled >= 0 && h.hoursFilled <= HOURS && h.daysFilled >= 0 && h.daysFilled <= DAYS
+              && f.read((uint8_t*)st, RAW_SIZE) == RAW_SIZE;
+    f.close();
+    if (!ok) {
+      Serial.println("[WeatherHistory] Nieprawidłowy wx-history.bin – zaczynam od nowa.");
+      memset(st, 0, sizeof(Store));
+      return false;
+    }
+    lastHour = h.lastHour; hoursFilled = h.hoursFilled;
+    lastDay = h.lastDay;   daysFilled = h.daysFilled;
+    rebuildCums();
+    return true;
+  }
+
+  bool ready() const { return st != nullptr; }
+
+  // Opad doliczany do godziny i dnia pomiaru (jak RainHistory: pomiary z tej samej godziny się sumują)
+  void addRain(time_t ts, float rainMm, bool persist = true) {
+    if (!st || ts < 1600000000) return; // czas jeszcze nie zsynchronizowany
+    const int16_t r = fixed10(rainMm);
+    if (advanceHour(hourOf(ts))) {
+      const int s = hSlot(lastHour);
+      st->hRain[s] = (int16_t)constrain((int32_t)st->hRain[s] + r, -32767, 32767);
+      recumHour(lastHour, hoursFilled == 1);
+    }
+    if (advanceDay(localDayOf(ts))) {
+      const int s = dSlot(lastDay);
+      st->dRain[s] = (int16_t)constrain((int32_t)st->dRain[s] + r, -32767, 32767);
+      recumDay(lastDay, daysFilled == 1);
+    }
+    if (persist) saveCurrent();
+  }
+
+  // Pełny pomiar z aktualnej pogody OWM; persist = false → zapis później przez persist()
+  void add(time_t ts, float rainMm, float temp, float hum, float wind, bool persist = true) {
+    if (!st || ts < 1600000000) return;
+    addRain(ts, rainMm, false);
+    const int16_t t = fixed10(temp);
+    const uint8_t hu = (uint8_t)constrain(lroundf(hum), 0L, 100L);
+    const uint16_t w = (uint16_t)constrain(lroundf(wind * 10.0f), 0L, 65535L);
+
+    if (lastHour == hourOf(ts)) {
+      const int s = hSlot(lastHour);
+      const int n = st->hN[s];
+      // Średnie bieżące
+      st->hTemp[s] = (int16_t)((st->hTemp[s] * n + t) / (n + 1));
+      st->hHum[s]  = (uint8_t)((st->hHum[s] * n + hu) / (n + 1));
+      st->hWind[s] = (uint16_t)((st->hWind[s] * n + w) / (n + 1));
+      if (n < 255) st->hN[s] = n + 1;
+      recumHour(lastHour, hoursFilled == 1);
+    }
+    if (lastDay == localDayOf(ts)) {
+      const int s = dSlot(lastDay);
+      const int32_t n = st->dN[s];
+      if (n == 0 || t < st->dTmin[s]) st->dTmin[s] = t;
+      if (n == 0 || t > st->dTmax[s]) st->dTmax[s] = t;
+      st->dTavg[s] = (int16_t)((st->dTavg[s] * n + t) / (n + 1));
+      st->dHum[s]  = (uint8_t)((st->dHum[s] * n + hu) / (n + 1));
+      if (w > st->dWindMax[s]) st->dWindMax[s] = w;
+      if (n < 65535) st->dN[s] = n + 1;
+    }
+    if (persist) saveCurrent();
+  }
+
+  void flush() { if (st) save(); }
+  // Bieżąca godzina/dzień, a po przesunięciu bufora cały plik
+  void persist() { if (st) saveCurrent(); }
+
+  // --- Okna (O(1)); bieżąca godzina/dzień wliczone ---
+  float rainLastHours(int n, time_t now) const { return hourWindow(RAIN, n, hourOf(now)) / 10.0f; }
+  float rainLastDays(int n, time_t now) const { return dayWindow(n, localDayOf(now)) / 10.0f; }
+  float tempAvgLastHours(int n, time_t now) const {
+    const int32_t h = hourOf(now);
+    return avg10(hourWindow(TEMP, n, h), hourWindow(VALID, n, h));
+  }
+  float humidityAvgLastHours(int n, time_t now) const {
+    const int32_t h = hourOf(now);
+    const int32_t cnt = hourWindow(VALID, n, h);
+    return cnt > 0 ? (float)hourWindow(HUM, n, h) / cnt : NAN;
+  }
+
+  int hoursStored() const { return hoursFilled; }
+  int daysStored() const { return daysFilled; }
+
+  // Wiersz godzinowy dla godziny UTC h; false = poza zakresem lub brak danych meteo
+  bool hourAt(int32_t h, float& rain, float& temp, float& hum, float& wind) const {
+    if (!st || hoursFilled == 0 || h > lastHour || h <= lastHour - hoursFilled) return false;
+    const int s = hSlot(h);
+    rain = st->hRain[s] / 10.0f;
+    if (!st->hN[s]) return false;
+    temp = st->hTemp[s] / 10.0f;
+    hum  = st->hHum[s];
+    wind = st->hWind[s] / 10.0f;
+    return true;
+  }
+
+  static bool metricFromName(const String& name, Metric& out) {
+    if (name == "rain")     { out = M_RAIN;     return true; }
+    if (name == "temp")     { out = M_TEMP;     return true; }
+    if (name == "humidity") { out = M_HUMIDITY; return true; }
+    if (name == "wind")     { out = M_WIND;     return true; }
+    return false;
+  }
+
+  // Klucz punktu: godzina UTC (ts/3600) albo dzień lokalny (dni od 1970-01-01)
+  static int32_t keyOf(bool daily, time_t ts) { return daily ? localDayOf(ts) : hourOf(ts); }
+
+  // Początek godziny / lokalnej doby dla klucza (UNIX time)
+  static uint32_t keyTime(bool daily, int32_t key) {
+    if (!daily) return (uint32_t)key * 3600UL;
+    int y; unsigned m, d;
+    civilFromDays(key, y, m, d);
+    struct tm t{};
+    t.tm_year = y - 1900; t.tm_mon = (int)m - 1; t.tm_mday = (int)d;
+    t.tm_isdst = -1;
+    return (uint32_t)mktime(&t);
+  }
+
+  // Zakres kluczy w pamięci; false = brak danych
+  bool range(bool daily, int32_t& oldest, int32_t& newest) const {
+    if (!st) return false;
+    if (daily) { if (!daysFilled) return false; newest = lastDay; oldest = lastDay - daysFilled + 1; }
+    else       { if (!hoursFilled) return false; newest = lastHour; oldest = lastHour - hoursFilled + 1; }
+    return true;
+  }
+
+  // Wartość serii dla klucza; false = poza zakresem lub brak pomiaru.
+  // Dziennie: opad = suma, temp = średnia, humidity = średnia, wind = maksimum.
+  bool sample(Metric m, bool daily, int32_t key, float& v) const {
+    int32_t oldest, newest;
+    if (!range(daily, oldest, newest) || key < oldest || key > newest) return false;
+    if (daily) {
+      const int s = dSlot(key);
+      if (m == M_RAIN) { v = st->dRain[s] / 10.0f; return true; }
+      if (!st->dN[s]) return false;
+      switch (m) {
+        case M_TEMP:     v = st->dTavg[s] / 10.0f; break;
+        case M_HUMIDITY: v = st->dHum[s]; break;
+        default:         v = st->dWindMax[s] / 10.0f; break;
+      }
+      return true;
+    }
+    const int s = hSlot(key);
+    if (m == M_RAIN) { v = st->hRain[s] / 10.0f; return true; }
+    if (!st->hN[s]) return false;
+    switch (m) {
+      case M_TEMP:     v = st->hTemp[s] / 10.0f; break;
+      case M_HUMIDITY: v = st->hHum[s]; break;
+      default:         v = st->hWind[s] / 10.0f; break;
+    }
+    return true;
+  }
+
+  // Podsumowanie okien + opcjonalnie ostatnie godziny/dni (ograniczone, by nie puchło)
+  void toJson(JsonDocument& doc, time_t now, int hours = 0, int days = 0) const {
+    doc["hours_stored"] = hoursFilled;
+    doc["days_stored"] = daysFilled;
+
+    JsonObject rain = doc["rain_mm"].to<JsonObject>();
+    rain["1h"]   = rainLastHours(1, now);
+    rain["6h"]   = rainLastHours(6, now);
+    rain["24h"]  = rainLastHours(24, now);
+    rain["7d"]   = rainLastDays(7, now);
+    rain["30d"]  = rainLastDays(30, now);
+    rain["365d"] = rainLastDays(365, now);
+
+    JsonObject temp = doc["temp_avg"].to<JsonObject>();
+    float v;
+    if (!isnan(v = tempAvgLastHours(24, now)))  temp["24h"] = v;
+    if (!isnan(v = tempAvgLastHours(168, now))) temp["7d"] = v;
+    JsonObject hum = doc["humidity_avg"].to<JsonObject>();
+    if (!isnan(v = humidityAvgLastHours(24, now)))  hum["24h"] = v;
+    if (!isnan(v = humidityAvgLastHours(168, now))) hum["7d"] = v;
+
+    if (!st) return;
+    if (hours > 48) hours = 48;
+    if (hours > hoursFilled) hours = hoursFilled;
+    if (hours > 0) {
+      JsonArray arr = doc["hourly"].to<JsonArray>();
+      for (int32_t h = lastHour - hours + 1; h <= lastHour; h++) {
+        float r = 0, t, hu, w;
+        JsonObject o = arr.add<JsonObject>();
+        o["time"] = (uint32_t)h * 3600UL;
+        bool meteo = hourAt(h, r, t, hu, w);
+        o["rain"] = r;
+        if (meteo) { o["temp"] = t; o["humidity"] = hu; o["wind"] = w; }
+      }
+    }
+    if (days > 31) days = 31;
+    if (days > daysFilled) days = daysFilled;
+    if (days > 0) {
+      JsonArray arr = doc["daily"].to<JsonArray>();
+      char date[12];
+      for (int32_t d = lastDay - days + 1; d <= lastDay; d++) {
+        const int s = dSlot(d);
+        JsonObject o = arr.add<JsonObject>();
+        dayString(d, date, sizeof(date));
+        o["date"] = date;
+        o["rain"] = st->dRain[s] / 10.0f;
+        if (st->dN[s]) {
+          o["temp_min"] = st->dTmin[s] / 10.0f;
+          o["temp_max"] = st->dTmax[s] / 10.0f;
+          o["temp_avg"] = st->dTavg[s] / 10.0f;
+          o["humidity"] = st->dHum[s];
+          o["wind_max"] = st->dWindMax[s] / 10.0f;
+        }
+      }
+    }
+  }
+};
@@ -3,6 +3,7 @@
 #include <Update.h>
 #include <LittleFS.h>
 #include <ArduinoJson.h>
+#include <memory>
 #include "Config.h"
 #include "Zones.h"
 #include "Weather.h"
@@ -10,11 +11,23 @@
 #include "Programs.h"
 #include "Logs.h"
 #include "MQTTClient.h"
+#include "LoopStats.h"
+#include "StaticFiles.h"
+#include "LiveEvents.h"
+#include "ResponseCache.h"
+
+// Największe body JSON (POST/PUT) składane w całość – import kilkuset programów
+// to kilkadziesiąt KB; większe żądania dostają 413. Do nadpisania flagą -D.
+#ifndef WEBUI_MAX_BODY_BYTES
+#define WEBUI_MAX_BODY_BYTES 49152
+#endif
 
 // z main.cpp
 extern "C" void setTimezoneFromWeb();
 
 extern MQTTClient mqtt; // użyjemy do updateConfig po zapisaniu ustawień
+extern LoopStats loopStats; // z main.cpp – statystyki opóźnień loop()
+extern HttpsPool httpsPool; // z main.cpp – pula połączeń HTTPS
 
 // ========== AWARYJNA STRONA GŁÓWNA ==========
 const char MAIN_PAGE_HTML[] PROGMEM = R"rawliteral(
@@ -83,30 +96,54 @@ const char MAIN_PAGE_HTML[] PROGMEM = R"rawliteral(
         document.getElementById('czas').textContent = d.time;
       });
     }
+    function showWeather(d) {
+      document.getElementById('temp').textContent = d.temp ?? '?';
+      document.getElementById('humidity').textContent = d.humidity ?? '?';
+      document.getElementById('rain').textContent = d.rain ?? '?';
+      document.getElementById('wind').textContent = d.wind ?? '?';
+    }
     function loadWeather() {
-      fetch('/api/weather').then(r=>r.json()).then(d=>{
-        document.getElementById('temp').textContent = d.temp ?? '?';
-        document.getElementById('humidity').textContent = d.humidity ?? '?';
-        document.getElementById('rain').textContent = d.rain ?? '?';
-        document.getElementById('wind').textContent = d.wind ?? '?';
-      });
+      fetch('/api/weather').then(r=>r.json()).then(showWeather);
+    }
+    let zoneList = [];
+    function renderZones() {
+      const now = Date.now() / 1000;
+      let html = '';
+      for (let z of zoneList) {
+        const left = z.active && z.end ? Math.max(0, Math.round(z.end - now)) : 0;
+        html += `<div class="zone ${z.active?'on':'off'}">
+          <span>Strefa #${z.id+1} ${z.active?'(WŁ'+(left?' '+Math.ceil(left/60)+' min':'')+')':(z.queued?'(kolejka)':'(WYŁ)')} ${z.name?(' - ' + z.name):''}</span>
+          <button onclick="toggleZone(${z.id}, this)">${z.active||z.queued?'Wyłącz':'Włącz'}</button>
+        </div>`;
+      }
+      document.getElementById('zones').innerHTML = html;
     }
     function loadZones() {
       fetch('/api/zones').then(r=>r.json()).then(zs=>{
-        let html = '';
-        for (let z of zs) {
-          html += `<div class="zone ${z.active?'on':'off'}">
-            <span>Strefa #${z.id+1} ${z.active?'(WŁ)':'(WYŁ)'} ${z.name?(' - ' + z.name):''}</span>
-            <button onclick="toggleZone(${z.id}, this)">${z.active?'Wyłącz':'Włącz'}</button>
-          </div>`;
-        }
-        document.getElementById('zones').innerHTML = html;
+        const now = Date.now() / 1000;
+        zoneList = zs.map(z=>Object.assign(z, { end: z.active ? now + z.remaining : 0 }));
+        renderZones();
       });
     }
     function toggleZone(id, btn) {
       btn.disabled = true;
       fetch('/api/zones', { method: 'POST', headers: {'Content-Type':'application/json'}, body: JSON.stringify({id, toggle:true}) })
-        .then(r=>r.json()).then(()=>{ setTimeout(loadZones, 400); btn.disabled = false; });
+        .then(r=>r.json()).then(()=>{ if (!window.EventSource) setTimeout(loadZones, 400); btn.disabled = false; });
+    }
+    // Zmiany przychodzą z /api/events; zegar przeglądarki może odbiegać od
+    // urządzenia, więc koniec liczymy z "remaining" z tego samego zdarzenia
+    if (window.EventSource) {
+      const es = new EventSource('/api/events');
+      es.addEventListener('hello', ()=>{ loadZones(); loadWeather(); });
+      es.addEventListener('zone', e=>{
+        const d = JSON.parse(e.data);
+        const z = zoneList.find(x=>x.id===d.id);
+        if (!z) return loadZones();
+        Object.assign(z, { active: d.active, queued: d.queued, end: d.active ? Date.now()/1000 + d.remaining : 0 });
+        renderZones();
+      });
+      es.addEventListener('weather', e=>showWeather(JSON.parse(e.data)));
+      setInterval(renderZones, 30000);
     }
     loadStatus(); loadWeather(); loadZones();
   </script>
@@ -339,6 +376,51 @@ inline bool checkAuth(AsyncWebServerRequest *request) {
 namespace WebServerUI {
   static AsyncWebServer* server = nullptr;
   static File _uploadFile; // do /api/fs/upload
+  static StaticFiles staticFiles;
+  static LiveEvents liveEvents; // /api/events (SSE)
+
+  // Gotowe odpowiedzi GET, ważne do zmiany wersji modułu (ETag/304)
+  static CachedJson weatherJson("weather"), rainHistoryJson("rain-history"), wateringJson("watering-percent");
+  static CachedJson programsJson("programs"), settingsJson("settings"), zoneNamesJson("zones-names");
+
+  // Procent podlewania zależy od okna opadu 6 h, które przesuwa się z czasem –
+  // oprócz wersji pogody klucz zmienia się co 10 min
+  static uint32_t wateringKey(Weather* weather) {
+    return weather->getVersion() * 2654435761u + (uint32_t)(time(nullptr) / 600);
+  }
+
+  // Body przychodzi w kawałkach (index/total, po jednym na segment TCP) – składamy
+  // je w request->_tempObject, który biblioteka zwalnia free() razem z żądaniem.
+  // true = komplet; data/len wskazują wtedy całe body (pojedynczy kawałek bez kopii).
+  static bool collectBody(AsyncWebServerRequest* req, uint8_t* chunk, size_t chunkLen, size_t index, size_t total,
+                          uint8_t*& data, size_t& len) {
+    if (index == 0 && chunkLen == total) { data = chunk; len = chunkLen; return true; }
+    if (total > WEBUI_MAX_BODY_BYTES) {
+      if (index == 0) {
+        Serial.printf("[HTTP] %s: body %u B > %u B – odrzucone\n", req->url().c_str(), (unsigned)total, (unsigned)WEBUI_MAX_BODY_BYTES);
+        req->send(413, "application/json", "{\"ok\":false,\"error\":\"Za duże body\"}");
+      }
+      return false;
+    }
+    if (index == 0) {
+      req->_tempObject = malloc(total);
+      if (!req->_tempObject) {
+        req->send(500, "application/json", "{\"ok\":false,\"error\":\"Brak pamięci\"}");
+        return false;
+      }
+    }
+    if (!req->_tempObject || index + chunkLen > total) return false;
+    memcpy((uint8_t*)req->_tempObject + index, chunk, chunkLen);
+    if (index + chunkLen < total) return false;
+    data = (uint8_t*)req->_tempObject;
+    len = total;
+    return true;
+  }
+
+  // Build Vite: nazwy w /assets/ mają hash treści → wolno cache'ować na zawsze.
+  // Reszta (index.html, sw.js, manifest) zawsze rewalidowana przez ETag.
+  static const char* CACHE_IMMUTABLE = "public, max-age=31536000, immutable";
+  static const char* CACHE_REVALIDATE = "no-cache";
 
   void begin(
       Config* config,
@@ -355,15 +437,20 @@ namespace WebServerUI {
     server->on("/", HTTP_GET, [config](AsyncWebServerRequest *req) {
       Serial.println("[HTTP] GET /");
       if (config->isInAPMode()) { req->redirect("/wifi"); return; }
-      if (LittleFS.exists("/index.html")) req->send(LittleFS, "/index.html", "text/html");
-      else req->send_P(200, "text/html", MAIN_PAGE_HTML);
+      if (!staticFiles.send(req, "/index.html", "text/html", CACHE_REVALIDATE))
+        req->send_P(200, "text/html", MAIN_PAGE_HTML);
+    });
+
+    // Zasoby z hashem w nazwie: .gz gdy jest, immutable, ETag/304
+    server->on("/assets", HTTP_GET, [](AsyncWebServerRequest *req){
+      const String path = req->url();
+      if (path.indexOf("..") >= 0 || !staticFiles.send(req, path, StaticFiles::contentTypeOf(path), CACHE_IMMUTABLE))
+        req->send(404, "text/plain", "Not found");
     });
 
     // favicon.ico -> spróbuj z favicon.png, inaczej 204
     server->on("/favicon.ico", HTTP_GET, [](AsyncWebServerRequest *req){
-      if (LittleFS.exists("/favicon.png")) {
-        req->send(LittleFS, "/favicon.png", "image/png");
-      } else {
+      if (!staticFiles.send(req, "/favicon.png", "image/png", "public, max-age=86400")) {
         req->send(204); // bez treści, bez błędu
       }
     });
@@ -440,6 +527,7 @@ namespace WebServerUI {
         }
         if (final) {
           if (_uploadFile) _uploadFile.close();
+          staticFiles.invalidate();
           Serial.println("[FS] Upload koniec");
         }
       }
@@ -473,6 +561,7 @@ namespace WebServerUI {
       if (!path.startsWith("/")) path = "/" + path;
 
       bool ok = LittleFS.remove(path);
+      staticFiles.invalidate();
       String resp = String("{\"ok\":") + (ok ? "true" : "false") + "}";
       req->send(ok ? 200 : 404, "application/json", resp);
     });
@@ -557,15 +646,53 @@ namespace WebServerUI {
     // --- Rain history (bez i z ukośnikiem)
     server->on("/api/rain-history", HTTP_GET, [weather](AsyncWebServerRequest *req){
       Serial.println("[API] GET /api/rain-history");
-      JsonDocument doc;
-      weather->rainHistoryToJson(doc);
-      String json; serializeJson(doc, json);
-      req->send(200, "application/json", json);
+      rainHistoryJson.send(req, weather->getVersion(), [weather](JsonDocument& doc){ weather->rainHistoryToJson(doc); });
     });
     server->on("/api/rain-history/", HTTP_GET, [weather](AsyncWebServerRequest *req){
       Serial.println("[API] GET /api/rain-history/ (trailing slash)");
-      JsonDocument doc;
-      weather->rainHistoryToJson(doc);
+      rainHistoryJson.send(req, weather->getVersion(), [weather](JsonDocument& doc){ weather->rainHistoryToJson(doc); });
+    });
+
+    // --- Historia pogody: okna opadu/średnie; ?hours=N (≤48), ?days=N (≤31) dokładają wiersze
+    server->on("/api/weather-history", HTTP_GET, [weather](AsyncWebServerRequest *req){
+      int hours = req->hasParam("hours") ? req->getParam("hours")->value().toInt() : 0;
+      int days  = req->hasParam("days")  ? req->getParam("days")->value().toInt()  : 0;
+      JsonDocument doc; weather->historyToJson(doc, hours, days);
+      String json; serializeJson(doc, json);
+      req->send(200, "application/json", json);
+    });
+
+    // --- Dane do wykresów, zredukowane do ~points punktów niezależnie od zakresu:
+    // ?metric=rain|temp|humidity|wind&from=&to=(UNIX)&points=200&mode=lttb|minmax&res=hour|day
+    server->on("/api/chart", HTTP_GET, [weather](AsyncWebServerRequest *req){
+      String name = req->hasParam("metric") ? req->getParam("metric")->value() : String("rain");
+      WeatherHistory::Metric metric;
+      if (!WeatherHistory::metricFromName(name, metric)) {
+        req->send(400, "application/json", "{\"ok\":false,\"error\":\"Nieznana seria\"}"); return;
+      }
+      time_t to   = req->hasParam("to")   ? (time_t)strtoul(req->getParam("to")->value().c_str(), nullptr, 10) : time(nullptr);
+      time_t from = req->hasParam("from") ? (time_t)strtoul(req->getParam("from")->value().c_str(), nullptr, 10) : to - 24 * 3600;
+      if (from > to) { req->send(400, "application/json", "{\"ok\":false,\"error\":\"from > to\"}"); return; }
+      int points = req->hasParam("points") ? req->getParam("points")->value().toInt() : 200;
+      points = constrain(points, 3, 1000);
+      const ChartWriter::Mode mode = (req->hasParam("mode") && req->getParam("mode")->value() == "minmax")
+                                     ? ChartWriter::MINMAX : ChartWriter::LTTB;
+      // Domyślnie godzinowo, dla zakresów dłuższych niż historia godzinowa – dziennie
+      const bool daily = req->hasParam("res") ? req->getParam("res")->value() == "day"
+                                              : (to - from) > (time_t)WeatherHistory::HOURS * 3600;
+      char head[128];
+      snprintf(head, sizeof(head), "{\"metric\":\"%s\",\"res\":\"%s\",\"from\":%lu,\"to\":%lu",
+               name.c_str(), daily ? "day" : "hour", (unsigned long)from, (unsigned long)to);
+      auto writer = std::make_shared<ChartWriter>(weather->chartSource(metric, daily, from, to), mode, points, head);
+      AsyncWebServerResponse* resp = req->beginChunkedResponse("application/json",
+        [writer](uint8_t* buf, size_t maxLen, size_t) -> size_t { return writer->fill(buf, maxLen); });
+      resp->addHeader("Cache-Control", "no-store");
+      req->send(resp);
+    });
+
+    // --- Koszt parsowania odpowiedzi OWM (musi być przed /api/weather)
+    server->on("/api/weather/stats", HTTP_GET, [weather](AsyncWebServerRequest *req){
+      JsonDocument doc; weather->statsToJson(doc);
       String json; serializeJson(doc, json);
       req->send(200, "application/json", json);
     });
@@ -573,36 +700,36 @@ namespace WebServerUI {
     // --- Watering percent (bez i z ukośnikiem)
     server->on("/api/watering-percent", HTTP_GET, [weather](AsyncWebServerRequest *req){
       Serial.println("[API] GET /api/watering-percent");
-      JsonDocument doc;
-      doc["percent"] = weather->getWateringPercent();
-      doc["rain_6h"] = weather->getLast6hRain();
-      // BIEŻĄCE wartości na potrzeby decyzji i UI:
-      doc["temp_now"] = weather->getCurrentTemp();
-      doc["humidity_now"] = weather->getCurrentHumidity();
-      // wyjaśnienie po polsku:
-      doc["explain"] = weather->getWateringDecisionExplain();
-      // zostawiamy też prognozy dzienne, jeśli front to gdzieś pokazuje:
-      doc["daily_max_temp"] = weather->getDailyMaxTemp();
-      doc["daily_humidity_forecast"] = weather->getDailyHumidityForecast();
-      String json; serializeJson(doc, json);
-      req->send(200, "application/json", json);
+      wateringJson.send(req, wateringKey(weather), [weather](JsonDocument& doc){
+        doc["percent"] = weather->getWateringPercent();
+        doc["rain_6h"] = weather->getLast6hRain();
+        // BIEŻĄCE wartości na potrzeby decyzji i UI:
+        doc["temp_now"] = weather->getCurrentTemp();
+        doc["humidity_now"] = weather->getCurrentHumidity();
+        // wyjaśnienie po polsku:
+        doc["explain"] = weather->getWateringDecisionExplain();
+        // zostawiamy też prognozy dzienne, jeśli front to gdzieś pokazuje:
+        doc["daily_max_temp"] = weather->getDailyMaxTemp();
+        doc["daily_humidity_forecast"] = weather->getDailyHumidityForecast();
+      });
     });
     server->on("/api/watering-percent/", HTTP_GET, [weather](AsyncWebServerRequest *req){
       Serial.println("[API] GET /api/watering-percent/ (trailing slash)");
-      JsonDocument doc;
-      doc["percent"] = weather->getWateringPercent();
-      doc["rain_6h"] = weather->getLast6hRain();
-      doc["temp_now"] = weather->getCurrentTemp();
-      doc["humidity_now"] = weather->getCurrentHumidity();
-      doc["explain"] = weather->getWateringDecisionExplain();
-      doc["daily_max_temp"] = weather->getDailyMaxTemp();
-      doc["daily_humidity_forecast"] = weather->getDailyHumidityForecast();
-      String json; serializeJson(doc, json);
-      req->send(200, "application/json", json);
+      wateringJson.send(req, wateringKey(weather), [weather](JsonDocument& doc){
+        doc["percent"] = weather->getWateringPercent();
+        doc["rain_6h"] = weather->getLast6hRain();
+        doc["temp_now"] = weather->getCurrentTemp();
+        doc["humidity_now"] = weather->getCurrentHumidity();
+        doc["explain"] = weather->getWateringDecisionExplain();
+        doc["daily_max_temp"] = weather->getDailyMaxTemp();
+        doc["daily_humidity_forecast"] = weather->getDailyHumidityForecast();
+      });
     });
 
     // --- onRequestBody do obsługi JSON POST/PUT (wifi/settings/zones/nazwy/programy)
-    server->onRequestBody([config, relays, programs, logs, weather, pushover](AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t, size_t) {
+    server->onRequestBody([config, relays, programs, logs, weather, pushover](AsyncWebServerRequest *request, uint8_t *chunk, size_t chunkLen, size_t index, size_t total) {
+      uint8_t* data; size_t len;
+      if (!collectBody(request, chunk, chunkLen, index, total, data, len)) return;
       String url = request->url();
       auto method = request->method();
 
@@ -616,7 +743,7 @@ namespace WebServerUI {
         JsonDocument cfg;
         cfg["ssid"] = ssid; cfg["pass"] = pass;
         config->saveFromJson(cfg);
-        if (logs) logs->add("Zmieniono ustawienia WiFi (SSID: " + ssid + ")");
+        if (logs) logs->add(LOG_WIFI_CHANGED);
         request->send(200, "application/json", "{\"ok\":true}");
         delay(1000);
         ESP.restart(); return;
@@ -629,8 +756,9 @@ namespace WebServerUI {
         config->saveFromJson(doc);
         setTimezoneFromWeb();
         weather->applySettings(config->getOwmApiKey(), config->getOwmLocation(), config->getEnableWeatherApi(), config->getWeatherUpdateIntervalMin());
+        relays->setBudget(config->getMaxConcurrentZones(), config->getSupplyCapacity());
         mqtt.updateConfig();
-        if (logs) logs->add("Zapisano ustawienia systemu");
+        if (logs) logs->add(LOG_SETTINGS_SAVED);
         request->send(200, "application/json", "{\"ok\":true}");
         return;
       }
@@ -641,14 +769,14 @@ namespace WebServerUI {
         if (deserializeJson(doc, (const char*)data, len)) { request->send(400, "application/json", "{\"ok\":false}"); return; }
         int id = doc["id"] | -1;
         bool toggle = doc["toggle"] | false;
-        if (id < 0 || id >= 8) { request->send(400, "application/json", "{\"ok\":false}"); return; }
+        if (id < 0 || id >= relays->getZoneCount()) { request->send(400, "application/json", "{\"ok\":false}"); return; }
         if (toggle) {
           bool wasActive = relays->getZoneState(id);
           relays->toggleZone(id);
           bool isActive = relays->getZoneState(id);
           if (logs) {
-            if (!wasActive && isActive) logs->add("Ręcznie włączono strefę #" + String(id+1));
-            else if (wasActive && !isActive) logs->add("Ręcznie wyłączono strefę #" + String(id+1));
+            if (!wasActive && isActive) logs->add(LOG_ZONE_MANUAL_ON, id);
+            else if (wasActive && !isActive) logs->add(LOG_ZONE_MANUAL_OFF, id);
           }
           // NOWE: Pushover dla ręcznego sterowania
           if (pushover && config && config->getEnablePushover()) {
@@ -662,6 +790,17 @@ namespace WebServerUI {
         return;
       }
 
+      // --- /api/zones-flow (przepływy stref w l/min dla budżetu hydraulicznego)
+      if (url == "/api/zones-flow" && method == HTTP_POST) {
+        JsonDocument doc;
+        if (deserializeJson(doc, (const char*)data, len) || !doc["flow"].is<JsonArray>()) {
+          request->send(400, "application/json", "{\"ok\":false,\"error\":\"Błąd JSON lub brak tablicy 'flow'\"}"); return;
+        }
+        relays->setAllFlows(doc["flow"].as<JsonArray>());
+        request->send(200, "application/json", "{\"ok\":true}");
+        return;
+      }
+
       // --- /api/zones-names
       if (url == "/api/zones-names" && method == HTTP_POST) {
         JsonDocument doc;
@@ -669,7 +808,7 @@ namespace WebServerUI {
           request->send(400, "application/json", "{\"ok\":false,\"error\":\"Błąd JSON lub brak tablicy 'names'\"}"); return;
         }
         relays->setAllZoneNames(doc["names"].as<JsonArray>());
-        if (logs) logs->add("Zmieniono nazwy stref");
+        if (logs) logs->add(LOG_ZONE_NAMES_CHANGED);
         request->send(200, "application/json", "{\"ok\":true}");
         return;
       }
@@ -717,9 +856,17 @@ namespace WebServerUI {
 
     // --- Weather
     server->on("/api/weather", HTTP_GET, [weather](AsyncWebServerRequest *req) {
-      JsonDocument doc; weather->toJson(doc);
-      String out; serializeJson(doc, out);
-      req->send(200, "application/json", out);
+      weatherJson.send(req, weather->getVersion(), [weather](JsonDocument& doc){ weather->toJson(doc); });
+    });
+
+    // --- Statystyki stref: sumy za ?days=N (domyślnie 7, ≤366) + rozbicie dzienne dla krótkich okresów
+    // (przed /api/zones – inaczej tamten handler przechwyci /api/zones/...)
+    server->on("/api/zones/stats", HTTP_GET, [relays](AsyncWebServerRequest *req){
+      int days = 7;
+      if (req->hasParam("days")) days = req->getParam("days")->value().toInt();
+      JsonDocument doc; relays->statsToJson(doc, days);
+      String json; serializeJson(doc, json);
+      req->send(200, "application/json", json);
     });
 
     // --- Zones
@@ -729,24 +876,34 @@ namespace WebServerUI {
       req->send(200, "application/json", out);
     });
 
-    // --- Zones names
-    server->on("/api/zones-names", HTTP_GET, [relays](AsyncWebServerRequest *req) {
-      JsonDocument doc; JsonArray names = doc["names"].to<JsonArray>();
-      relays->toJsonNames(names);
+    // --- Przepływy stref i budżet hydrauliczny
+    server->on("/api/zones-flow", HTTP_GET, [relays](AsyncWebServerRequest *req) {
+      JsonDocument doc; relays->flowToJson(doc);
       String out; serializeJson(doc, out);
       req->send(200, "application/json", out);
     });
 
-    // --- Programs GET/EXPORT/DELETE
-    server->on("/api/programs", HTTP_GET, [programs](AsyncWebServerRequest *req){
-      JsonDocument doc; programs->toJson(doc);
+    // --- Sterownik wyjść stref: liczba przełączeń, czas zapisu (µs)
+    server->on("/api/relays/stats", HTTP_GET, [relays](AsyncWebServerRequest *req){
+      JsonDocument doc; relays->driverToJson(doc);
       String json; serializeJson(doc, json);
       req->send(200, "application/json", json);
     });
+
+    // --- Zones names
+    server->on("/api/zones-names", HTTP_GET, [relays](AsyncWebServerRequest *req) {
+      zoneNamesJson.send(req, relays->getNamesVersion(), [relays](JsonDocument& doc){
+        JsonArray names = doc["names"].to<JsonArray>();
+        relays->toJsonNames(names);
+      });
+    });
+
+    // --- Programs GET/EXPORT/DELETE (export przed /api/programs – ta sama treść, wspólny cache)
     server->on("/api/programs/export", HTTP_GET, [programs](AsyncWebServerRequest *req){
-      JsonDocument doc; programs->toJson(doc);
-      String json; serializeJson(doc, json);
-      req->send(200, "application/json", json);
+      programsJson.send(req, programs->getVersion(), [programs](JsonDocument& doc){ programs->toJson(doc); });
+    });
+    server->on("/api/programs", HTTP_GET, [programs](AsyncWebServerRequest *req){
+      programsJson.send(req, programs->getVersion(), [programs](JsonDocument& doc){ programs->toJson(doc); });
     });
     server->on("/api/programs", HTTP_DELETE, [programs](AsyncWebServerRequest *req) {
       if (!req->hasParam("id")) { req->send(400, "application/json", "{\"ok\":false,\"error\":\"Brak parametru id\"}"); return; }
@@ -757,10 +914,20 @@ namespace WebServerUI {
 
     // --- LOGS
     if (logs) {
+      // Bez parametrów: ostatnie Logs::JSON_TAIL wpisów (jak dotąd).
+      // ?since=<seq>&limit=N: tylko wpisy od seq; "next" to kursor do kolejnego zapytania.
       server->on("/api/logs", HTTP_GET, [logs](AsyncWebServerRequest *req){
-        JsonDocument doc; logs->toJson(doc);
-        String json; serializeJson(doc, json);
-        req->send(200, "application/json", json);
+        const bool tail = !req->hasParam("since");
+        uint32_t since = tail ? 0 : strtoul(req->getParam("since")->value().c_str(), nullptr, 10);
+        int limit = req->hasParam("limit") ? req->getParam("limit")->value().toInt() : Logs::JSON_TAIL;
+        if (limit > Logs::MAX_LOGS) limit = Logs::MAX_LOGS;
+        uint32_t from, to;
+        logs->window(since, limit, tail, from, to);
+        auto writer = std::make_shared<LogJsonWriter>(logs, from, to, !tail && to < logs->getNextSeq());
+        AsyncWebServerResponse* resp = req->beginChunkedResponse("application/json",
+          [writer](uint8_t* buf, size_t maxLen, size_t) -> size_t { return writer->fill(buf, maxLen); });
+        resp->addHeader("Cache-Control", "no-store");
+        req->send(resp);
       });
       server->on("/api/logs", HTTP_DELETE, [logs](AsyncWebServerRequest *req){
         logs->clear();
@@ -770,16 +937,59 @@ namespace WebServerUI {
 
     // --- USTAWIENIA GET
     server->on("/api/settings", HTTP_GET, [config](AsyncWebServerRequest *req){
-      JsonDocument doc; config->toJson(doc);
+      settingsJson.send(req, config->getVersion(), [config](JsonDocument& doc){ config->toJson(doc); });
+    });
+
+    // --- Bufory odpowiedzi GET: przebudowy, trafienia, odpowiedzi 304
+    server->on("/api/cache/stats", HTTP_GET, [](AsyncWebServerRequest *req){
+      JsonDocument doc; CachedJson::toJson(doc);
+      String json; serializeJson(doc, json);
+      req->send(200, "application/json", json);
+    });
+
+    // --- Opóźnienia pętli sterującej (percentyle w µs); ?reset=1 zeruje okno pomiaru
+    server->on("/api/loop-stats", HTTP_GET, [](AsyncWebServerRequest *req){
+      JsonDocument doc; loopStats.toJson(doc);
+      if (req->hasParam("reset")) loopStats.reset();
+      String json; serializeJson(doc, json);
+      req->send(200, "application/json", json);
+    });
+
+    // --- Kolejka powiadomień Pushover (liczniki wysłanych/odrzuconych)
+    server->on("/api/pushover/stats", HTTP_GET, [pushover](AsyncWebServerRequest *req){
+      JsonDocument doc; pushover->toJson(doc);
+      String json; serializeJson(doc, json);
+      req->send(200, "application/json", json);
+    });
+
+    // --- Publikacje MQTT: bajty, pakiety, alokacje sterty w ostatnim cyklu
+    server->on("/api/mqtt/stats", HTTP_GET, [](AsyncWebServerRequest *req){
+      JsonDocument doc; mqtt.statsToJson(doc);
+      String json; serializeJson(doc, json);
+      req->send(200, "application/json", json);
+    });
+
+    // --- Pula HTTPS: liczba/czas handshake'ów i ponownych użyć połączeń
+    server->on("/api/https/stats", HTTP_GET, [](AsyncWebServerRequest *req){
+      JsonDocument doc; httpsPool.toJson(doc);
+      String json; serializeJson(doc, json);
+      req->send(200, "application/json", json);
+    });
+
+    // --- Push zmian stref/dziennika/pogody (SSE) i jego liczniki
+    server->on("/api/events/stats", HTTP_GET, [](AsyncWebServerRequest *req){
+      JsonDocument doc; liveEvents.toJson(doc);
       String json; serializeJson(doc, json);
       req->send(200, "application/json", json);
     });
+    liveEvents.begin(server, relays, weather, logs);
 
     // Serwowanie plików statycznych (LittleFS)
-    server->serveStatic("/", LittleFS, "/");
+    server->serveStatic("/", LittleFS, "/").setCacheControl(CACHE_REVALIDATE);
     server->begin();
     Serial.println("[HTTP] Serwer wystartował na porcie 80");
   }
 
-  void loop() { }
+  // Z pętli głównej: rozsyłanie zdarzeń do klientów /api/events
+  void loop() { liveEvents.loop(); }
 }
@@ -0,0 +1,279 @@
+#pragma once
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <LittleFS.h>
+#include <time.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
+// Dzienny bilans strefy
+struct ZoneDayStats {
+  uint32_t seconds = 0;     // faktyczny czas otwarcia zaworu (wszystkie źródła)
+  uint32_t liters10 = 0;    // zużycie w 0,1 l (gdy strefa ma ustawiony przepływ)
+  uint32_t plannedSec = 0;  // automat: czas z programu (przed korektą pogodową)
+  uint32_t scaledSec = 0;   // automat: czas po korekcie pogodowej
+  uint16_t runs = 0;        // otwarcia zaworu
+  uint8_t  skipped = 0;     // automat: odwołane (0%)
+  uint8_t  shortened = 0;   // automat: skrócone (<100%)
+};
+
+// Statystyki stref w dziennych kubełkach na rok wstecz.
+// /zone-stats.bin: nagłówek + DAYS bloków {uint32 dzień, ZoneDayStats[zones]},
+// blok dnia d w slocie d % DAYS (stary rok nadpisywany w miejscu). Bieżący
+// dzień jest w RAM i trafia do pliku co FLUSH_MS, przy zmianie dnia i tylko
+// gdy coś się zmieniło.
+class ZoneStats {
+public:
+  static const int DAYS = 366;
+  static const int MAX_ZONES = 48;
+  static const int DETAIL_CELLS = 256; // dni × strefy, do których JSON ma też rozbicie dzienne
+
+private:
+  static constexpr const char* PATH = "/zone-stats.bin";
+  static const uint32_t MAGIC = 0x3154535A; // "ZST1"
+  static const unsigned long FLUSH_MS = 60000;
+  static const time_t MIN_VALID_TIME = 1600000000;
+
+  struct Totals {
+    uint32_t seconds = 0, liters10 = 0, plannedSec = 0, scaledSec = 0;
+    uint32_t runs = 0, skipped = 0, shortened = 0;
+  };
+
+  struct Header {
+    uint32_t magic;
+    uint16_t recordSize;
+    uint16_t zones;
+    uint16_t days;
+    uint16_t reserved;
+  };
+
+  int zones = 0;
+  uint32_t today = 0;          // dni od 1970-01-01 (czas lokalny), 0 = czas nieznany
+  ZoneDayStats cur[MAX_ZONES];
+  bool dirty = false;
+  unsigned long lastFlush = 0;
+  uint32_t version = 0;
+
+  SemaphoreHandle_t mutex = nullptr;
+  struct Guard {
+    SemaphoreHandle_t m;
+    Guard(SemaphoreHandle_t s) : m(s) { if (m) xSemaphoreTake(m, portMAX_DELAY); }
+    ~Guard() { if (m) xSemaphoreGive(m); }
+  };
+
+  size_t blockSize() const { return sizeof(uint32_t) + (size_t)zones * sizeof(ZoneDayStats); }
+  size_t offsetOf(uint32_t day) const { return sizeof(Header) + (size_t)(day % DAYS) * blockSize(); }
+
+  // Numer dnia z daty (algorytm "days from civil", H. Hinnant)
+  static uint32_t daysFromCivil(int y, unsigned m, unsigned d) {
+    y -= m <= 2;
+    const int era = (y >= 0 ? y : y - 399) / 400;
+    const unsigned yoe = (unsigned)(y - era * 400);
+    const unsigned doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return (uint32_t)(era * 146097 + (int)doe - 719468);
+  }
+
+  static void civilFromDays(uint32_t z, char* buf, size_t cap) {
+    const int zz = (int)z + 719468;
+    const int era = zz / 146097;
+    const unsigned doe = (unsigned)(zz - era * 146097);
+    const unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    const unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    const unsigned mp = (5 * doy + 2) / 153;
+    const unsigned d = doy - (153 * mp + 2) / 5 + 1;
+    const unsigned m = mp < 10 ? mp + 3 : mp - 9;
+    const int y = (int)yoe + era * 400 + (m <= 2);
+    snprintf(buf, cap, "%04d-%02u-%02u", y, m, d);
+  }
+
+  static uint32_t dayOf(time_t t) {
+    if (t < MIN_VALID_TIME) return 0;
+    struct tm lt; localtime_r(&t, &lt);
+    return daysFromCivil(lt.tm_year + 1900, lt.tm_mon + 1, lt.tm_mday);
+  }
+
+  bool create() {
+    File f = LittleFS.open(PATH, "w");
+    if (!f) {
+      Serial.println("[Zones] Nie można utworzyć zone-stats.bin!");
+      return false;
+    }
+    Header h{MAGIC, (uint16_t)sizeof(ZoneDayStats), (uint16_t)zones, (uint16_t)DAYS, 0};
+    f.write((const uint8_t*)&h, sizeof(h));
+    // Pusty plik w kawałkach po jednym bloku (zera = dzień 0, czyli "brak")
+    uint8_t zero[64] = {0};
+    size_t left = (size_t)DAYS * blockSize();
+    while (left) {
+      size_t k = min(left, sizeof(zero));
+      f.write(zero, k);
+      left -= k;
+    }
+    f.close();
+    return true;
+  }
+
+  bool readBlock(File& f, uint32_t day, ZoneDayStats* out) {
+    uint32_t stored = 0;
+    if (!f.seek(offsetOf(day)) || f.read((uint8_t*)&stored, sizeof(stored)) != sizeof(stored) || stored != day) return false;
+    const size_t n = (size_t)zones * sizeof(ZoneDayStats);
+    return f.read((uint8_t*)out, n) == n;
+  }
+
+  void writeToday() {
+    File f = LittleFS.open(PATH, "r+");
+    if (!f) {
+      if (!create()) return;
+      f = LittleFS.open(PATH, "r+");
+      if (!f) return;
+    }
+    f.seek(offsetOf(today));
+    f.write((const uint8_t*)&today, sizeof(today));
+    f.write((const uint8_t*)cur, (size_t)zones * sizeof(ZoneDayStats));
+    f.close();
+    dirty = false;
+    lastFlush = millis();
+  }
+
+  // Zmiana dnia (albo pierwszy znany czas po starcie)
+  void roll(time_t now) {
+    const uint32_t d = dayOf(now);
+    if (!d || d == today) return;
+    if (today == 0) {
+      // Dopisz to, co nazbierało się przed NTP, do zapisanego już dnia
+      ZoneDayStats saved[MAX_ZONES];
+      File f = LittleFS.open(PATH, "r");
+      if (f && readBlock(f, d, saved)) {
+        for (int i = 0; i < zones; i++) {
+          cur[i].seconds += saved[i].seconds;  cur[i].liters10 += saved[i].liters10;
+          cur[i].plannedSec += saved[i].plannedSec; cur[i].scaledSec += saved[i].scaledSec;
+          cur[i].runs += saved[i].runs;  cur[i].skipped += saved[i].skipped;
+          cur[i].shortened += saved[i].shortened;
+        }
+      }
+      if (f) f.close();
+    } else {
+      if (dirty) writeToday();
+      for (int i = 0; i < zones; i++) cur[i] = ZoneDayStats();
+    }
+    today = d;
+    dirty = true; // zapisz blok nowego dnia (nadpisuje ten sprzed roku)
+    version++;
+  }
+
+  void totalsToJson(JsonObject o, const Totals& s) {
+    o["seconds"]    = s.seconds;
+    o["liters"]     = s.liters10 / 10.0f;
+    o["runs"]       = s.runs;
+    o["plannedSec"] = s.plannedSec;
+    o["scaledSec"]  = s.scaledSec;
+    o["skipped"]    = s.skipped;
+    o["shortened"]  = s.shortened;
+    // Ile procent czasu z programów zaoszczędziła korekta pogodowa
+    o["savedPct"]   = s.plannedSec ? (int)(100 - (int64_t)s.scaledSec * 100 / s.plannedSec) : 0;
+  }
+
+public:
+  void begin(int n) {
+    if (!mutex) mutex = xSemaphoreCreateMutex();
+    Guard g(mutex);
+    zones = constrain(n, 1, MAX_ZONES);
+    File f = LittleFS.open(PATH, "r");
+    Header h;
+    const bool ok = f && f.read((uint8_t*)&h, sizeof(h)) == sizeof(h) && h.magic == MAGIC
+                    && h.recordSize == sizeof(ZoneDayStats) && h.zones == zones && h.days == DAYS;
+    if (f) f.close();
+    if (!ok) {
+      Serial.println("[Zones] Nowy plik statystyk stref (brak lub inna liczba stref).");
+      create();
+    }
+    roll(time(nullptr));
+  }
+
+  // Zawór był otwarty `seconds` łącznie w `runs` otwarciach (liters10 = 0,1 l; 0 gdy przepływ nieznany)
+  void addOpen(int zone, uint32_t seconds, uint32_t liters10, uint16_t runs = 1) {
+    if (zone < 0 || zone >= zones) return;
+    Guard g(mutex);
+    cur[zone].seconds += seconds;
+    cur[zone].liters10 += liters10;
+    cur[zone].runs += runs;
+    dirty = true;
+    version++;
+  }
+
+  // Start automatu: czas z programu i po korekcie pogodowej (0 = odwołany)
+  void addAuto(int zone, uint32_t plannedSec, uint32_t scaledSec) {
+    if (zone < 0 || zone >= zones) return;
+    Guard g(mutex);
+    cur[zone].plannedSec += plannedSec;
+    cur[zone].scaledSec += scaledSec;
+    if (scaledSec == 0) { if (cur[zone].skipped < 255) cur[zone].skipped++; }
+    else if (scaledSec < plannedSec) { if (cur[zone].shortened < 255) cur[zone].shortened++; }
+    dirty = true;
+    version++;
+  }
+
+  // Z Zones::loop(): zmiana dnia i okresowy zapis
+  void loop() {
+    Guard g(mutex);
+    roll(time(nullptr));
+    if (dirty && today && millis() - lastFlush >= FLUSH_MS) writeToday();
+  }
+
+  uint32_t getVersion() const { return version; }
+
+  // Sumy za ostatnie `days` dni (z dzisiejszym); przy days × strefy ≤ DETAIL_CELLS
+  // również "daily": [{"date","zones":[[seconds,liters,runs,skipped,shortened],...]}]
+  // Mutex tylko na kopię bieżącego dnia i na każdy odczyt bloku z osobna –
+  // skan roku nie wstrzymuje addOpen()/addAuto() ani zapisu z loop().
+  void toJson(JsonDocument& doc, int days) {
+    days = constrain(days, 1, DAYS);
+    Totals total[MAX_ZONES];
+    ZoneDayStats todayStats[MAX_ZONES];
+    uint32_t day0;
+    {
+      Guard g(mutex);
+      day0 = today;
+      memcpy(todayStats, cur, sizeof(todayStats));
+    }
+
+    char date[24]; // "RRRR-MM-DD", zapas na najgorszy przypadek %04d/%02u
+    doc["zones"] = zones;
+    doc["days"] = days;
+    if (day0) { civilFromDays(day0, date, sizeof(date)); doc["today"] = date; }
+
+    JsonArray daily;
+    if (days * zones <= DETAIL_CELLS) daily = doc["daily"].to<JsonArray>();
+
+    File f = day0 ? LittleFS.open(PATH, "r") : File();
+    ZoneDayStats block[MAX_ZONES];
+    for (int k = 0; k < days; k++) {
+      const ZoneDayStats* s = nullptr;
+      if (k == 0) s = todayStats;
+      else if (f && day0 > (uint32_t)k) {
+        Guard g(mutex);
+        if (readBlock(f, day0 - k, block)) s = block;
+      }
+      if (!s) continue;
+      for (int i = 0; i < zones; i++) {
+        total[i].seconds += s[i].seconds;  total[i].liters10 += s[i].liters10;
+        total[i].plannedSec += s[i].plannedSec; total[i].scaledSec += s[i].scaledSec;
+        total[i].runs += s[i].runs;  total[i].skipped += s[i].skipped;
+        total[i].shortened += s[i].shortened;
+      }
+      if (daily.isNull()) continue;
+      JsonObject d = daily.add<JsonObject>();
+      if (day0) { civilFromDays(day0 - k, date, sizeof(date)); d["date"] = date; }
+      JsonArray zs = d["zones"].to<JsonArray>();
+      for (int i = 0; i < zones; i++) {
+        JsonArray z = zs.add<JsonArray>();
+        z.add(s[i].seconds); z.add(s[i].liters10 / 10.0f); z.add(s[i].runs);
+        z.add(s[i].skipped); z.add(s[i].shortened);
+      }
+    }
+    if (f) f.close();
+
+    JsonArray tot = doc["totals"].to<JsonArray>();
+    for (int i = 0; i < zones; i++) totalsToJson(tot.add<JsonObject>(), total[i]);
+  }
+};
@@ -2,37 +2,261 @@
 #include <Arduino.h>
 #include <ArduinoJson.h>
 #include <LittleFS.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "esp_timer.h"
+#include "RelayDriver.h"
+#include "ZoneStats.h"
 
+// Strefy + kolejka uruchomień. Każdy start (automat, WWW, MQTT) przechodzi
+// przez kolejkę: zawór otwiera się od razu tylko, gdy mieści się w budżecie
+// hydraulicznym (maxConcurrent stref naraz i – opcjonalnie – suma przepływów
+// stref ≤ supplyCapacity), inaczej czeka w FIFO i startuje w loop(), gdy
+// tylko zwolni się miejsce. Czas podlewania liczy się od faktycznego startu.
+// Wyjścia wystawia RelayDriver (GPIO / 74HC595 / MCP23017 / mock) – liczba
+// stref i sterownik pochodzą z ustawień.
+// Wyłączenie po czasie planuje jednorazowy esp_timer strefy: zawór zamyka
+// się o czasie nawet wtedy, gdy loop() stoi na WiFi/MQTT/HTTPS. Callback
+// (zadanie esp_timer) tylko przełącza wyjście i zapisuje zdarzenie; log
+// i reszta obsługi idą w loop(). loop() zostaje też jako zapas.
 class Zones {
-  int numZones;
-  bool states[8];
-  int pins[8] = {13,12,14,27,26,25,33,32};
-  unsigned long endTime[8] = {0}; // kiedy wyłączyć
+public:
+  static const int MAX_ZONES = RelayDriver::MAX_OUTPUTS;
+
+private:
+  static const int QUEUE_MAX = 16;
+
+  struct QueuedRun {
+    uint8_t  zone;
+    uint32_t durationSec;
+  };
+
+  int numZones = 0;
+  bool states[MAX_ZONES] = {false};
+  unsigned long endTime[MAX_ZONES] = {0}; // kiedy wyłączyć
+  unsigned long startMs[MAX_ZONES] = {0}; // faktyczne otwarcie (do statystyk)
+
+  // Dzienne czasy/zużycie stref
+  ZoneStats stats;
+  // Zamknięcia zaworów czekające na ZoneStats: deactivate() (także z timera)
+  // tylko dopisuje tu pod blokadą stref, a do statystyk trafiają w loop() –
+  // mutex statystyk (odczyty pliku dla /api/zones/stats) nie blokuje wyłączenia
+  struct PendingOpen { uint32_t seconds, liters10; uint16_t runs; };
+  PendingOpen pendingOpen[MAX_ZONES] = {};
+  volatile bool pendingAny = false;
+
+  // Wyjścia: bit i = strefa i; każda zmiana to jedno apply() sterownika
+  RelayDriver* driver = nullptr;
+  uint64_t outputs = 0;
+  uint32_t switchCount = 0;
+  uint32_t lastSwitchUs = 0, maxSwitchUs = 0;
+  bool applyFailed = false;        // sterownik nie przyjął stanu – loop() ponawia
+  uint32_t applyErrors = 0;
+  unsigned long lastApplyRetryMs = 0;
+
+  // Wyłączanie z timera
+  struct TimerCtx { Zones* self; uint8_t idx; };
+  TimerCtx timerCtx[MAX_ZONES];
+  esp_timer_handle_t timers[MAX_ZONES] = {nullptr};
+  int64_t offAtUs[MAX_ZONES] = {0};       // planowany czas wyłączenia (esp_timer_get_time)
+  int32_t stopLateUs[MAX_ZONES] = {0};    // spóźnienie ostatniego wyłączenia, do logu w loop()
+  volatile uint64_t timerStops = 0;       // strefy wyłączone przez timer, czekające na loop()
+  // Spóźnienie wyłączenia: faktyczny − planowany czas
+  uint32_t offCount = 0, loopOffCount = 0;
+  int64_t  overshootSumUs = 0;
+  int32_t  lastOvershootUs = 0, maxOvershootUs = 0;
 
   // Nazwy stref
-  String zoneNames[8];
+  String zoneNames[MAX_ZONES];
+  uint32_t namesVersion = 0; // cache /api/zones-names
+
+  // Budżet hydrauliczny
+  int   maxConcurrent = 1;
+  float supplyCapacity = 0;   // l/min, 0 = bez limitu przepływu
+  float flow[MAX_ZONES] = {0}; // l/min na strefę, 0 = nieznany (nie liczy się do limitu)
+
+  QueuedRun queue[QUEUE_MAX];
+  int queueLen = 0;
+
+  // Rośnie przy każdej zmianie widocznej w toJson() poza odliczaniem
+  // "remaining" (start/stop, kolejka, nazwy) – MQTT publikuje tylko po zmianie
+  volatile uint32_t version = 0;
+
+  // Wywołania z loop(), async_tcp (WWW) i MQTT – rekurencyjny, bo start
+  // z kolejki woła activate() z wnętrza innych metod
+  SemaphoreHandle_t lock = nullptr;
+  struct Guard {
+    SemaphoreHandle_t m;
+    Guard(SemaphoreHandle_t s) : m(s) { if (m) xSemaphoreTakeRecursive(m, portMAX_DELAY); }
+    ~Guard() { if (m) xSemaphoreGiveRecursive(m); }
+  };
+
+  int activeCount() const {
+    int n = 0;
+    for (int i = 0; i < numZones; i++) if (states[i]) n++;
+    return n;
+  }
+
+  bool fits(int idx) const {
+    const int active = activeCount();
+    if (active == 0) return true; // pojedyncza strefa zawsze może ruszyć
+    if (active >= maxConcurrent) return false;
+    if (supplyCapacity <= 0 || flow[idx] <= 0) return true;
+    float used = 0;
+    for (int i = 0; i < numZones; i++) if (states[i]) used += flow[i];
+    return used + flow[idx] <= supplyCapacity;
+  }
+
+  int queuedAt(int idx) const {
+    for (int i = 0; i < queueLen; i++) if (queue[i].zone == idx) return i;
+    return -1;
+  }
+
+  void dequeueAt(int pos) {
+    for (int i = pos; i < queueLen - 1; i++) queue[i] = queue[i + 1];
+    queueLen--;
+    version++;
+  }
+
+  void setOutput(int idx, bool on) {
+    const uint64_t next = on ? (outputs | (1ULL << idx)) : (outputs & ~(1ULL << idx));
+    if (next == outputs || !driver) { outputs = next; return; }
+    outputs = next;
+    const uint32_t t0 = micros();
+    applyOutputs();
+    lastSwitchUs = micros() - t0;
+    if (lastSwitchUs > maxSwitchUs) maxSwitchUs = lastSwitchUs;
+    switchCount++;
+  }
+
+  void applyOutputs() {
+    applyFailed = !driver->apply(outputs);
+    if (applyFailed) applyErrors++;
+    lastApplyRetryMs = millis();
+  }
+
+  void activate(int idx, uint32_t durationSec) {
+    Serial.printf("startZone(%d, %u)\n", idx, (unsigned)durationSec);
+    if (!states[idx]) startMs[idx] = millis(); // nowy czas aktywnej strefy to ten sam przebieg
+    states[idx] = true;
+    setOutput(idx, true);
+    endTime[idx] = millis() + durationSec*1000UL;
+    version++;
+    const uint64_t us = durationSec ? (uint64_t)durationSec * 1000000ULL : 1;
+    offAtUs[idx] = esp_timer_get_time() + us;
+    if (timers[idx]) {
+      esp_timer_stop(timers[idx]); // nowy czas dla aktywnej strefy
+      esp_timer_start_once(timers[idx], us);
+    }
+  }
+
+  void deactivate(int idx) {
+    if (timers[idx]) esp_timer_stop(timers[idx]);
+    const bool wasOn = states[idx];
+    states[idx] = false;
+    setOutput(idx, false); // najpierw zawór, potem rachunki
+    endTime[idx] = 0;
+    version++;
+    if (wasOn) {
+      const uint32_t sec = (millis() - startMs[idx] + 500) / 1000;
+      pendingOpen[idx].seconds += sec;
+      pendingOpen[idx].liters10 += (uint32_t)(sec * flow[idx] / 6.0f); // l/min → 0,1 l
+      pendingOpen[idx].runs++;
+      pendingAny = true;
+    }
+  }
+
+  // Z loop(): przenosi zebrane zamknięcia do ZoneStats poza blokadą stref
+  void flushPendingStats() {
+    if (!pendingAny) return;
+    PendingOpen batch[MAX_ZONES];
+    {
+      Guard g(lock);
+      memcpy(batch, pendingOpen, sizeof(batch));
+      memset(pendingOpen, 0, sizeof(pendingOpen));
+      pendingAny = false;
+    }
+    for (int i = 0; i < numZones; i++) {
+      if (batch[i].runs) stats.addOpen(i, batch[i].seconds, batch[i].liters10, batch[i].runs);
+    }
+  }
+
+  void recordOvershoot(int idx) {
+    int64_t late = esp_timer_get_time() - offAtUs[idx];
+    if (late < 0) late = 0;
+    if (late > INT32_MAX) late = INT32_MAX;
+    stopLateUs[idx] = (int32_t)late;
+    lastOvershootUs = stopLateUs[idx];
+    if (lastOvershootUs > maxOvershootUs) maxOvershootUs = lastOvershootUs;
+    overshootSumUs += late;
+    offCount++;
+  }
+
+  static void onTimer(void* arg) {
+    TimerCtx* c = (TimerCtx*)arg;
+    c->self->timerExpired(c->idx);
+  }
+
+  void timerExpired(int idx) {
+    Guard g(lock);
+    // Strefa mogła zostać w międzyczasie zatrzymana albo dostać nowy czas
+    if (!states[idx] || esp_timer_get_time() < offAtUs[idx]) return;
+    recordOvershoot(idx);
+    deactivate(idx);
+    timerStops |= 1ULL << idx;
+    dispatch();
+  }
+
+  // Ścisłe FIFO: następny rusza dopiero, gdy mieści się pierwszy w kolejce
+  void dispatch() {
+    while (queueLen > 0 && fits(queue[0].zone)) {
+      const QueuedRun r = queue[0];
+      dequeueAt(0);
+      activate(r.zone, r.durationSec);
+    }
+  }
+
+  void loadFlow() {
+    if (!LittleFS.exists("/zones-flow.json")) return;
+    File f = LittleFS.open("/zones-flow.json", "r");
+    if (!f) return;
+    JsonDocument doc;
+    DeserializationError err = deserializeJson(doc, f);
+    f.close();
+    if (err || !doc.is<JsonArray>()) return;
+    JsonArray arr = doc.as<JsonArray>();
+    for (int i = 0; i < numZones; ++i) flow[i] = i < (int)arr.size() ? arr[i].as<float>() : 0.0f;
+  }
+
+  void saveFlow() {
+    JsonDocument doc;
+    JsonArray arr = doc.to<JsonArray>();
+    for (int i = 0; i < numZones; ++i) arr.add(flow[i]);
+    File f = LittleFS.open("/zones-flow.json", "w");
+    if (f) { serializeJson(doc, f); f.close(); }
+  }
 
   void loadZoneNames() {
     if (!LittleFS.exists("/zones-names.json")) {
       // Ustaw domyślne
-      for (int i = 0; i < 8; ++i) zoneNames[i] = "Strefa " + String(i + 1);
+      for (int i = 0; i < MAX_ZONES; ++i) zoneNames[i] = "Strefa " + String(i + 1);
       saveZoneNames(); // od razu zapisz domyślne
       return;
     }
     File f = LittleFS.open("/zones-names.json", "r");
     if (!f) {
-      for (int i = 0; i < 8; ++i) zoneNames[i] = "Strefa " + String(i + 1);
+      for (int i = 0; i < MAX_ZONES; ++i) zoneNames[i] = "Strefa " + String(i + 1);
       return;
     }
     JsonDocument doc;
     DeserializationError err = deserializeJson(doc, f);
     f.close();
     if (err) {
-      for (int i = 0; i < 8; ++i) zoneNames[i] = "Strefa " + String(i + 1);
+      for (int i = 0; i < MAX_ZONES; ++i) zoneNames[i] = "Strefa " + String(i + 1);
       return;
     }
     JsonArray arr = doc.as<JsonArray>();
-    for (int i = 0; i < 8; ++i) {
+    for (int i = 0; i < numZones; ++i) {
       if (i < arr.size() && arr[i].is<const char*>()) {
         zoneNames[i] = arr[i].as<const char*>();
       } else {
@@ -42,22 +266,107 @@ class Zones {
   }
 
 public:
-  Zones(int n) : numZones(n) {
+  Zones() {
     // Domyślne
-    for (int i = 0; i < 8; ++i) zoneNames[i] = "Strefa " + String(i + 1);
+    for (int i = 0; i < MAX_ZONES; ++i) zoneNames[i] = "Strefa " + String(i + 1);
   }
 
-  void begin() {
+  // drv przechodzi na własność Zones; n obcinane do możliwości sterownika
+  void begin(RelayDriver* drv, int n) {
+    if (!lock) lock = xSemaphoreCreateRecursiveMutex();
+    driver = drv;
+    numZones = constrain(n, 1, MAX_ZONES);
+    if (driver) {
+      numZones = min(numZones, driver->capacity());
+      if (!driver->begin(numZones)) Serial.printf("[Zones] Sterownik %s – błąd inicjalizacji!\n", driver->name());
+      outputs = 0;
+      applyOutputs();
+    }
+    outputs = 0;
     for(int i=0; i<numZones; i++) {
-      pinMode(pins[i], OUTPUT);
-      digitalWrite(pins[i], LOW);
       states[i] = false;
       endTime[i] = 0;
+      if (!timers[i]) {
+        timerCtx[i] = TimerCtx{this, (uint8_t)i};
+        esp_timer_create_args_t args = {};
+        args.callback = &Zones::onTimer;
+        args.arg = &timerCtx[i];
+        args.dispatch_method = ESP_TIMER_TASK;
+        args.name = "zone_off";
+        if (esp_timer_create(&args, &timers[i]) != ESP_OK) {
+          timers[i] = nullptr; // zostaje wyłączanie z loop()
+          Serial.printf("[Zones] Brak timera dla strefy %d!\n", i);
+        }
+      }
     }
+    Serial.printf("[Zones] %d stref, sterownik: %s\n", numZones, driver ? driver->name() : "-");
     loadZoneNames();
+    loadFlow();
+    stats.begin(numZones);
+  }
+
+  int getZoneCount() const { return numZones; }
+  uint32_t getVersion() const { return version; }
+  uint32_t getNamesVersion() const { return namesVersion; }
+
+  bool hasActive() {
+    Guard g(lock);
+    return activeCount() > 0;
+  }
+
+  // Sterownik wyjść: liczba przełączeń i czas apply() w µs
+  void driverToJson(JsonDocument& doc) {
+    Guard g(lock);
+    doc["driver"] = driver ? driver->name() : "";
+    doc["zones"] = numZones;
+    doc["switches"] = switchCount;
+    doc["lastSwitchUs"] = lastSwitchUs;
+    doc["maxSwitchUs"] = maxSwitchUs;
+    doc["applyErrors"] = applyErrors;
+    doc["applyFailed"] = applyFailed;
+    JsonObject off = doc["shutoff"].to<JsonObject>();
+    off["count"] = offCount;
+    off["fromLoop"] = loopOffCount; // wyłączone przez zapasowe sprawdzenie w loop()
+    off["lastOvershootUs"] = lastOvershootUs;
+    off["maxOvershootUs"] = maxOvershootUs;
+    off["avgOvershootUs"] = offCount ? (int32_t)(overshootSumUs / offCount) : 0;
+  }
+
+  // --- Statystyki stref ---
+  // Automat: czas z programu i po korekcie pogodowej (0 = odwołany)
+  void recordAutoRun(int idx, uint32_t plannedSec, uint32_t scaledSec) { stats.addAuto(idx, plannedSec, scaledSec); }
+  void statsToJson(JsonDocument& doc, int days) { stats.toJson(doc, days); }
+  uint32_t getStatsVersion() const { return stats.getVersion(); }
+
+  // Z ustawień (maxConcurrentZones, supplyCapacity)
+  void setBudget(int maxZones, float capacity) {
+    Guard g(lock);
+    maxConcurrent = maxZones < 1 ? 1 : maxZones;
+    supplyCapacity = capacity < 0 ? 0 : capacity;
+    dispatch();
+  }
+
+  // --- Przepływy stref (l/min) ---
+  void flowToJson(JsonDocument& doc) {
+    Guard g(lock);
+    JsonArray arr = doc["flow"].to<JsonArray>();
+    for (int i = 0; i < numZones; i++) arr.add(flow[i]);
+    doc["maxConcurrentZones"] = maxConcurrent;
+    doc["supplyCapacity"] = supplyCapacity;
+  }
+
+  void setAllFlows(const JsonArray& arr) {
+    Guard g(lock);
+    for (int i = 0; i < numZones; ++i) {
+      float v = i < (int)arr.size() ? arr[i].as<float>() : 0.0f;
+      flow[i] = v > 0 ? v : 0;
+    }
+    saveFlow();
+    dispatch();
   }
 
   void toJson(JsonDocument& doc) {
+    Guard g(lock);
     for(int i=0;i<numZones;i++) {
       JsonObject z = doc.add<JsonObject>();
       z["id"] = i;
@@ -65,42 +374,82 @@ public:
       // POPRAWKA #1: zgodnie z frontendem zwracamy klucz "remaining" (sekundy)
       z["remaining"] = states[i] ? max(0, (int)((endTime[i] - millis())/1000)) : 0;
       z["name"] = zoneNames[i];
+      int q = queuedAt(i);
+      if (q >= 0) z["queued"] = q + 1; // pozycja w kolejce
     }
   }
 
+  // Start od razu albo do kolejki; aktywna strefa dostaje nowy czas
   void startZone(int idx, int durationSec) {
     if(idx<0||idx>=numZones) return;
-    Serial.printf("startZone(%d, %d)\n", idx, durationSec);
-    states[idx] = true;
-    digitalWrite(pins[idx], HIGH);
-    endTime[idx] = millis() + durationSec*1000UL;
+    if (durationSec < 0) durationSec = 0;
+    Guard g(lock);
+    if (states[idx]) { activate(idx, durationSec); return; }
+    int q = queuedAt(idx);
+    if (q >= 0) { queue[q].durationSec = durationSec; return; }
+    if (queueLen == 0 && fits(idx)) { activate(idx, durationSec); return; }
+    if (queueLen >= QUEUE_MAX) {
+      Serial.printf("startZone(%d) – kolejka pełna, pomijam\n", idx);
+      return;
+    }
+    queue[queueLen++] = QueuedRun{(uint8_t)idx, (uint32_t)durationSec};
+    version++;
+    Serial.printf("startZone(%d, %d) – w kolejce (%d)\n", idx, durationSec, queueLen);
   }
 
+  // Zatrzymuje strefę albo usuwa ją z kolejki
   void stopZone(int idx) {
     if(idx<0||idx>=numZones) return;
+    Guard g(lock);
+    int q = queuedAt(idx);
+    if (q >= 0) dequeueAt(q);
     Serial.printf("stopZone(%d)\n", idx);
-    states[idx] = false;
-    digitalWrite(pins[idx], LOW);
-    endTime[idx] = 0;
+    deactivate(idx);
+    dispatch();
   }
 
   void toggleZone(int idx) {
     if(idx<0||idx>=numZones) return;
+    Guard g(lock);
     Serial.printf("toggleZone(%d) - before: %d\n", idx, states[idx]);
-    if (states[idx]) stopZone(idx);
+    if (states[idx] || queuedAt(idx) >= 0) stopZone(idx);
     else startZone(idx, 600); // domyślnie 10 min w manualu
     Serial.printf("toggleZone(%d) - after: %d\n", idx, states[idx]);
   }
 
+  bool isQueued(int idx) {
+    Guard g(lock);
+    return queuedAt(idx) >= 0;
+  }
+
   void loop() {
+    flushPendingStats();
+    stats.loop(); // zapis do pliku poza blokadą stref
+    Guard g(lock);
+    // Zdarzenia z timera: tu, a nie w callbacku, bo Serial/logika mogą trwać
+    const uint64_t stopped = timerStops;
+    timerStops = 0;
+    for (int i = 0; i < numZones && stopped; i++) {
+      if (stopped & (1ULL << i)) Serial.printf("stopZone(%d) – timer, spóźnienie %ld us\n", i, (long)stopLateUs[i]);
+    }
+    // Nieudany zapis do sterownika: wyjścia mają nieznany stan – ponów co 1 s
+    if (applyFailed && driver && millis() - lastApplyRetryMs >= 1000) applyOutputs();
+    // Zapas: strefa bez timera albo timer nie zdążył (1 s po terminie)
     unsigned long now = millis();
     for(int i=0; i<numZones; i++) {
-      if(states[i] && now > endTime[i]) stopZone(i);
+      if (!states[i]) continue;
+      const long over = (long)(now - endTime[i]);
+      if (over > (timers[i] ? 1000 : 0)) {
+        recordOvershoot(i);
+        loopOffCount++;
+        stopZone(i);
+      }
     }
   }
 
   bool getZoneState(int idx) { 
     if(idx<0||idx>=numZones) return false; 
+    Guard g(lock);
     return states[idx]; 
   }
 
@@ -109,43 +458,70 @@ public:
   // Zwraca nazwę strefy o podanym indeksie
   String getZoneName(int idx) {
     if(idx<0||idx>=numZones) return "";
+    Guard g(lock);
     return zoneNames[idx];
   }
 
   // Zmienia nazwę strefy (nie zapisuje automatycznie!)
   void setZoneName(int idx, const String& name) {
     if(idx<0||idx>=numZones) return;
+    Guard g(lock);
     zoneNames[idx] = name;
+    version++;
+    namesVersion++;
   }
 
-  // Zapisuje aktualne nazwy do pliku
+  // Zapisuje aktualne nazwy do pliku (kopia pod blokadą, zapis bez niej)
   void saveZoneNames() {
     JsonDocument doc;
     JsonArray arr = doc.to<JsonArray>();
-    for (int i = 0; i < 8; ++i) arr.add(zoneNames[i]);
+    {
+      Guard g(lock);
+      for (int i = 0; i < numZones; ++i) arr.add(zoneNames[i]);
+    }
     File f = LittleFS.open("/zones-names.json", "w");
     if (f) { serializeJson(doc, f); f.close(); }
   }
 
   // Zwraca wszystkie nazwy jako tablicę JSON
   void toJsonNames(JsonArray& arr) {
-    for (int i = 0; i < 8; ++i) arr.add(zoneNames[i]);
+    Guard g(lock);
+    for (int i = 0; i < numZones; ++i) arr.add(zoneNames[i]);
   }
 
   // Ustawia wszystkie nazwy na raz (i od razu zapisuje)
   void setAllZoneNames(const JsonArray& arr) {
-    for (int i = 0; i < 8; ++i) {
-      if (i < arr.size() && arr[i].is<const char*>()) {
-        zoneNames[i] = arr[i].as<const char*>();
-      } else {
-        zoneNames[i] = "Strefa " + String(i + 1);
+    {
+      Guard g(lock);
+      for (int i = 0; i < numZones; ++i) {
+        if (i < arr.size() && arr[i].is<const char*>()) {
+          zoneNames[i] = arr[i].as<const char*>();
+        } else {
+          zoneNames[i] = "Strefa " + String(i + 1);
+        }
       }
+      version++;
+      namesVersion++;
     }
     saveZoneNames();
   }
 
+  // Stan strefy pod jedną blokadą (LiveEvents): aktywna?, pozostałe sekundy,
+  // pozycja w kolejce (0 = poza kolejką)
+  bool liveState(int idx, int& remaining, int& queuePos) {
+    remaining = 0; queuePos = 0;
+    if (idx<0 || idx>=numZones) return false;
+    Guard g(lock);
+    queuePos = queuedAt(idx) + 1;
+    if (!states[idx]) return false;
+    long rem = (long)((endTime[idx] - millis())/1000);
+    remaining = rem > 0 ? (int)rem : 0;
+    return true;
+  }
+
   int getRemainingSeconds(int idx) {
     if (idx<0 || idx>=numZones) return 0;
+    Guard g(lock);
     if (!states[idx]) return 0;
     long rem = (long)((endTime[idx] - millis())/1000);
     return rem > 0 ? (int)rem : 0;
@@ -8,18 +8,28 @@
 #include "Programs.h"
 #include "Weather.h"
 #include "Logs.h"
+#include "HttpsPool.h"
 #include "PushoverClient.h"
 #include "WebServerUI.h"
 #include "MQTTClient.h"
+#include "LoopStats.h"
 
 // --- Obiekty globalne ---
 Config config;
-Zones zones(8);
-Weather weather;
+Zones zones;
+HttpsPool httpsPool; // wspólne połączenia HTTPS (OWM, Pushover)
+Weather weather(&httpsPool);
 Logs logs;
-PushoverClient pushover(config.getSettingsPtr());
+PushoverClient pushover(config.getSettingsPtr(), &httpsPool);
 Programs programs;
-MQTTClient mqtt;  // JEDYNA definicja globalnego klienta MQTT
+MQTTClient mqtt;  // JEDYNA definicja globalnego klienta MQTT (własne zadanie)
+LoopStats loopStats; // opóźnienia pętli sterującej (/api/loop-stats)
+volatile uint32_t heapAllocCount = 0; // alokacje sterty (statystyki publikacji MQTT)
+
+#ifdef CONFIG_HEAP_USE_HOOKS
+// Hak ESP-IDF wołany przy każdej alokacji (wymaga CONFIG_HEAP_USE_HOOKS=y)
+extern "C" void esp_heap_trace_alloc_hook(void*, size_t, uint32_t) { heapAllocCount++; }
+#endif
 
 // Pomocnicza konwersja "+HH[:MM]" / "-HH[:MM]" -> POSIX "UTC-xx[:yy]"
 static String offsetToPosixTZ(const String& tz)
@@ -75,6 +85,7 @@ void setTimezone() {
   }
 
   tzset();
+  programs.invalidateSchedule(); // terminy programów są w czasie lokalnym
   Serial.print("Aktualny TZ z getenv: "); Serial.println(getenv("TZ"));
 
   time_t now = time(nullptr);
@@ -107,6 +118,12 @@ void setup() {
   delay(100);
   LittleFS.begin();
 
+#ifdef HTTPS_CA_BUNDLE
+  // Paczka CA osadzona w FW (board_build.embed_files = data/cert/x509_crt_bundle.bin)
+  extern const uint8_t rootca_crt_bundle_start[] asm("_binary_data_cert_x509_crt_bundle_bin_start");
+  httpsPool.setCaBundle(rootca_crt_bundle_start);
+#endif
+
   Serial.println("Pliki w LittleFS:");
   File root = LittleFS.open("/");
   File file = root.openNextFile();
@@ -121,9 +138,10 @@ void setup() {
 
   delay(2000);
 
-  zones.begin();
+  zones.begin(createRelayDriver(config.getRelayDriver(), config.getRelayPins()), config.getZoneCount());
+  zones.setBudget(config.getMaxConcurrentZones(), config.getSupplyCapacity());
 
-  // *** WAŻNE: wczytaj trwałe logi z /logs.json ***
+  // *** WAŻNE: wczytaj trwałe logi z /logs.bin ***
   logs.begin();
 
   // Weather: natychmiastowa próba, retry po 60s, potem co X min wg ustawień
@@ -154,9 +172,12 @@ void setup() {
 extern "C" void setTimezoneFromWeb() { setTimezone(); }
 
 void loop() {
-  config.wifiLoop();
-  zones.loop();
-  programs.loop();
-  weather.loop();
-  mqtt.loop();
+  loopStats.beginIteration();
+  config.wifiLoop();  loopStats.mark(LoopStats::WIFI);
+  zones.loop();       loopStats.mark(LoopStats::ZONES);
+  programs.loop();    loopStats.mark(LoopStats::PROGRAMS);
+  weather.loop();     loopStats.mark(LoopStats::WEATHER);
+  mqtt.loop();        loopStats.mark(LoopStats::MQTT);
+  WebServerUI::loop(); loopStats.mark(LoopStats::WEB);
+  loopStats.endIteration();
 }